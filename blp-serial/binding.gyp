@@ -2,7 +2,9 @@
     "targets": [{
         "target_name": "blp-serial",
         "sources": [
-            "src/serialport.cpp"
+            "src/serialport.cpp",
+            "src/capture.cpp",
+            "src/port_config.cpp"
         ],
         "include_dirs": [
             "<!(node -e \"require('nan')\")"
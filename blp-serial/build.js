@@ -6,22 +6,28 @@ const {
 } = require('child_process');
 
 const ARCH_64 = "x64";
-const TARGET = "19.0.12"; // process.versions.electron
+const TARGETS = [
+    // VS Code extension host
+    { runtime: 'electron', version: "19.0.12", distUrl: 'https://electronjs.org/headers' }, // process.versions.electron
+    // command line compiler and flasher running on plain node
+    { runtime: 'node', version: process.versions.node, distUrl: 'https://nodejs.org/dist' }
+];
 
-rimraf.sync('build');
-runNodeGyp(TARGET, ARCH_64)
-    .then((res) => {
-        console.log('Built native module for', res.arch);
-        let out_path = path.join('lib', 'bindings', 'native', 'blp-serial_' + process.platform + '_' + TARGET + '_' + res.arch + '.node');
-        fs.renameSync(res.path, out_path);
-        console.log('Generated', out_path);
-        return Promise.resolve();
-    });
+TARGETS.reduce((previous, target) => previous.then(() => {
+    rimraf.sync('build');
+    return runNodeGyp(target, ARCH_64)
+        .then((res) => {
+            console.log('Built native module for', target.runtime, target.version, res.arch);
+            let out_path = path.join('lib', 'bindings', 'native', 'blp-serial_' + process.platform + '_' + target.version + '_' + res.arch + '.node');
+            fs.renameSync(res.path, out_path);
+            console.log('Generated', out_path);
+        });
+}), Promise.resolve());
 
 function runNodeGyp(target, arch) {
     return new Promise((resolve, reject) => {
         let gyp = path.join('node_modules', '.bin', 'node-gyp');
-        exec(gyp + ' rebuild --target=' + target + ' --arch=' + arch + ' --dist-url=https://electronjs.org/headers', (err, stdout, stderr) => {
+        exec(gyp + ' rebuild --target=' + target.version + ' --arch=' + arch + ' --dist-url=' + target.distUrl, (err, stdout, stderr) => {
             if (err) {
                 reject(err);
                 return;
@@ -34,4 +40,4 @@ function runNodeGyp(target, arch) {
             });
         });
     });
-}
\ No newline at end of file
+}
@@ -0,0 +1,8 @@
+'use strict';
+const path = require('path');
+const binding = require('../native_loader').load(path.join(__dirname, 'native'));
+
+/**
+ * Memory mapped rolling log of received data, see src/capture.h for the file layout
+ */
+module.exports = binding.CaptureLog;
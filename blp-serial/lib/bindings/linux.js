@@ -4,6 +4,7 @@ const binding = require('../native_loader').load(path.join(__dirname, 'native'))
 const BaseBinding = require('./base');
 const linuxList = require('./linux-list');
 const Poller = require('./poller');
+const prepareConfig = require('./prepared-config');
 const promisify = require('../util').promisify;
 const unixRead = require('./unix-read');
 const unixWrite = require('./unix-write');
@@ -35,7 +36,7 @@ class LinuxBinding extends BaseBinding {
         return super.open(path, options)
             .then(() => {
                 this.openOptions = Object.assign({}, this.bindingOptions, options);
-                return promisify(binding.open)(path, this.openOptions);
+                return promisify(binding.open)(path, prepareConfig(this.openOptions));
             })
             .then((fd) => {
                 this.fd = fd;
@@ -70,8 +71,13 @@ class LinuxBinding extends BaseBinding {
     }
 
     update(options) {
+        // all options are applied at once, the settings not passed are kept from open()
+        const updateOptions = Object.assign({}, this.openOptions, options);
         return super.update(options)
-            .then(() => promisify(binding.update)(this.fd, options));
+            .then(() => promisify(binding.update)(this.fd, prepareConfig(updateOptions)))
+            .then(() => {
+                this.openOptions = updateOptions;
+            });
     }
 
     set(options) {
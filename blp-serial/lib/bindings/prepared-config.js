@@ -0,0 +1,33 @@
+'use strict';
+const path = require('path');
+const binding = require('../native_loader').load(path.join(__dirname, 'native'));
+
+// options which are part of a prepared config, see PortOptions in src/serialport.h
+const CONFIG_KEYS = ['baudRate', 'dataBits', 'parity', 'stopBits', 'rtscts', 'xon', 'xoff', 'xany', 'hupcl', 'lock',
+  'vmin', 'vtime'];
+const CACHE_SIZE = 8;
+const cache = new Map();
+
+/**
+ * Returns the native config of the port options, see src/port_config.h. The configs of the last used
+ * options are kept, switching between the terminal and the upload settings reuses them.
+ * @param {object} options port options as passed to binding.open()
+ * @returns {object} prepared config which is accepted by binding.open() and binding.update()
+ * @throws {Error} if the options are not supported
+ */
+function prepareConfig(options) {
+  const key = CONFIG_KEYS.map(name => options[name]).join(',');
+  let config = cache.get(key);
+  if (config) {
+    cache.delete(key);
+  } else {
+    config = binding.prepareConfig(options);
+    if (cache.size >= CACHE_SIZE) {
+      cache.delete(cache.keys().next().value);
+    }
+  }
+  cache.set(key, config);
+  return config;
+}
+
+module.exports = prepareConfig;
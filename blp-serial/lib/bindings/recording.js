@@ -0,0 +1,241 @@
+'use strict';
+const fs = require('fs');
+
+/**
+ * Recording file format: the magic 'BLPREC01' followed by the events. Each event is stored as
+ * [type u8][time since the previous event in microseconds, varint][payload length, varint][payload].
+ */
+const MAGIC = 'BLPREC01';
+const FLUSH_SIZE = 64 * 1024;
+const FLUSH_INTERVAL = 1000;
+
+const EVENTS = Object.freeze({
+  OPEN: 1, // payload: JSON of path and open options
+  CLOSE: 2,
+  RX: 3, // payload: received bytes
+  TX: 4, // payload: written bytes
+  SET: 5, // payload: u8 flags, see SET_FLAGS
+  UPDATE: 6, // payload: u32 baud rate
+  FLUSH: 7,
+  DRAIN: 8
+});
+
+const SET_FLAGS = Object.freeze({
+  brk: 1,
+  cts: 2,
+  dsr: 4,
+  dtr: 8,
+  rts: 16
+});
+
+function writeVarint(value, target) {
+  while (value > 0x7f) {
+    target.push((value & 0x7f) | 0x80);
+    value = Math.floor(value / 128);
+  }
+  target.push(value);
+}
+
+/**
+ * Appends timestamped events to a recording file. Events are buffered and written in blocks.
+ */
+class Recorder {
+  /**
+   * @param {string} path recording file
+   * @param {boolean} append add the events to an existing recording
+   */
+  constructor(path, append) {
+    this.fd = fs.openSync(path, append ? 'a' : 'w');
+    this.chunks = append ? [] : [Buffer.from(MAGIC, 'latin1')];
+    this.size = append ? 0 : MAGIC.length;
+    this.last = process.hrtime.bigint();
+    this.timer = setInterval(() => this.flush(), FLUSH_INTERVAL);
+    this.timer.unref();
+  }
+
+  /**
+   * Records an event
+   * @param {number} type one of EVENTS
+   * @param {Buffer=} payload data of the event
+   */
+  event(type, payload) {
+    if (this.fd === null) {
+      return;
+    }
+    const now = process.hrtime.bigint();
+    const head = [type];
+    writeVarint(Number((now - this.last) / 1000n), head);
+    writeVarint(payload ? payload.length : 0, head);
+    this.last = now;
+
+    this.chunks.push(Buffer.from(head));
+    this.size += head.length;
+    if (payload && payload.length) {
+      // the caller may reuse the buffer, e.g. the read pool
+      this.chunks.push(Buffer.from(payload));
+      this.size += payload.length;
+    }
+    if (this.size >= FLUSH_SIZE) {
+      this.flush();
+    }
+  }
+
+  flush() {
+    if (this.fd === null || !this.size) {
+      return;
+    }
+    fs.writeSync(this.fd, Buffer.concat(this.chunks, this.size));
+    this.chunks = [];
+    this.size = 0;
+  }
+
+  close() {
+    if (this.fd === null) {
+      return;
+    }
+    clearInterval(this.timer);
+    this.flush();
+    fs.closeSync(this.fd);
+    this.fd = null;
+  }
+}
+
+/**
+ * Reads all events of a recording file
+ * @param {string} path recording file
+ * @returns {Array<{type: number, time: number, data: Buffer}>} events with the time in milliseconds since the start of the recording
+ */
+function readRecording(path) {
+  const file = fs.readFileSync(path);
+  if (file.toString('latin1', 0, MAGIC.length) !== MAGIC) {
+    throw new Error(`"${path}" is not a serial port recording`);
+  }
+  const events = [];
+  let offset = MAGIC.length;
+  let time = 0;
+  const readVarint = () => {
+    let value = 0;
+    let factor = 1;
+    let byte;
+    do {
+      if (offset >= file.length) {
+        throw new Error(`Recording "${path}" is truncated`);
+      }
+      byte = file[offset++];
+      value += (byte & 0x7f) * factor;
+      factor *= 128;
+    } while (byte & 0x80);
+    return value;
+  };
+
+  // an event cut by a crash of the recording process is dropped
+  while (offset < file.length) {
+    try {
+      const type = file[offset++];
+      time += readVarint() / 1000;
+      const length = readVarint();
+      if (offset + length > file.length) {
+        break;
+      }
+      events.push({ type, time, data: file.subarray(offset, offset + length) });
+      offset += length;
+    } catch (err) {
+      break;
+    }
+  }
+  return events;
+}
+
+/**
+ * Extends a binding class with the recording of all port operations and the transferred data. The recording
+ * is enabled by the `record` binding option with the path of the recording file. Reopening the port appends
+ * another session to the recording.
+ * @param {BaseBinding} Binding binding class to extend
+ * @returns {BaseBinding} the recording binding class
+ */
+function recordBinding(Binding) {
+  return class RecordingBinding extends Binding {
+    constructor(opt) {
+      super(opt);
+      this.recordPath = (opt.bindingOptions || {}).record || null;
+      this.recorder = null;
+      this.sessions = 0;
+    }
+
+    open(path, options) {
+      return super.open(path, options)
+        .then(() => {
+          if (this.recordPath) {
+            this.recorder = new Recorder(this.recordPath, this.sessions++ > 0);
+            this.recorder.event(EVENTS.OPEN, Buffer.from(JSON.stringify({ path, options })));
+          }
+        });
+    }
+
+    close() {
+      return super.close()
+        .then(() => {
+          if (this.recorder) {
+            this.recorder.event(EVENTS.CLOSE);
+            this.recorder.close();
+            this.recorder = null;
+          }
+        });
+    }
+
+    read(buffer, offset, length) {
+      return super.read(buffer, offset, length)
+        .then((bytesRead) => {
+          if (this.recorder) {
+            this.recorder.event(EVENTS.RX, buffer.subarray(offset, offset + bytesRead));
+          }
+          return bytesRead;
+        });
+    }
+
+    write(buffer) {
+      if (this.recorder) {
+        this.recorder.event(EVENTS.TX, buffer);
+      }
+      return super.write(buffer);
+    }
+
+    update(options) {
+      return super.update(options)
+        .then(() => {
+          if (this.recorder) {
+            const payload = Buffer.alloc(4);
+            payload.writeUInt32LE(options.baudRate);
+            this.recorder.event(EVENTS.UPDATE, payload);
+          }
+        });
+    }
+
+    set(options) {
+      return super.set(options)
+        .then(() => {
+          if (this.recorder) {
+            const flags = Object.keys(SET_FLAGS).reduce((result, flag) => options[flag] ? result | SET_FLAGS[flag] : result, 0);
+            this.recorder.event(EVENTS.SET, Buffer.from([flags]));
+          }
+        });
+    }
+
+    flush() {
+      return super.flush()
+        .then(() => this.recorder && this.recorder.event(EVENTS.FLUSH));
+    }
+
+    drain() {
+      return super.drain()
+        .then(() => this.recorder && this.recorder.event(EVENTS.DRAIN));
+    }
+  };
+}
+
+module.exports = {
+  EVENTS,
+  SET_FLAGS,
+  readRecording,
+  recordBinding
+};
@@ -0,0 +1,170 @@
+'use strict';
+const BaseBinding = require('./base');
+const recording = require('./recording');
+
+const EVENTS = recording.EVENTS;
+
+const defaultBindingOptions = Object.freeze({
+  speed: 1
+});
+
+/**
+ * Binding which plays back a recording of a `RecordingBinding` instead of accessing a port. Each open replays
+ * the next session of the recording. Received data is served at the recorded times divided by the `speed`
+ * binding option, a speed of 0 serves it without delay. Data which the device sent after a write is served
+ * only after the application wrote as many bytes as recorded before it, so the replay follows the protocol
+ * of the application independent of its timing.
+ */
+class ReplayBinding extends BaseBinding {
+  static list() {
+    return Promise.resolve([]);
+  }
+
+  constructor(opt) {
+    super(opt);
+    this.bindingOptions = Object.assign({}, defaultBindingOptions, opt.bindingOptions || {});
+    if (typeof this.bindingOptions.replay !== 'string') {
+      throw new TypeError('"bindingOptions.replay" is not a recording file');
+    }
+    this.events = recording.readRecording(this.bindingOptions.replay);
+    // next event to replay and the bytes of it already served
+    this.index = 0;
+    this.dataOffset = 0;
+    // bytes written by the application which are not matched with recorded writes yet
+    this.written = 0;
+    // real time when the previous event was replayed
+    this.eventTime = 0;
+    this.pendingRead = null;
+    this.timer = null;
+    this.opened = false;
+    this.baudRate = 0;
+  }
+
+  get isOpen() {
+    return this.opened;
+  }
+
+  open(path, options) {
+    return super.open(path, options)
+      .then(() => {
+        const index = this.events.findIndex((event, i) => i >= this.index && event.type === EVENTS.OPEN);
+        if (index === -1) {
+          throw new Error('No further session in the recording');
+        }
+        this.index = index;
+        this.next();
+        this.written = 0;
+        this.baudRate = options.baudRate;
+        this.opened = true;
+      });
+  }
+
+  close() {
+    return super.close()
+      .then(() => {
+        this.opened = false;
+        clearTimeout(this.timer);
+        this.timer = null;
+        if (this.pendingRead) {
+          const err = new Error('Port is closed');
+          err.canceled = true;
+          this.pendingRead.reject(err);
+          this.pendingRead = null;
+        }
+      });
+  }
+
+  read(buffer, offset, length) {
+    return super.read(buffer, offset, length)
+      .then(() => new Promise((resolve, reject) => {
+        this.pendingRead = { buffer, offset, length, resolve, reject };
+        this.replay();
+      }));
+  }
+
+  write(buffer) {
+    return super.write(buffer)
+      .then(() => {
+        this.written += buffer.length;
+        this.replay();
+      });
+  }
+
+  update(options) {
+    return super.update(options)
+      .then(() => {
+        this.baudRate = options.baudRate;
+      });
+  }
+
+  get() {
+    return super.get()
+      .then(() => ({ cts: false, dsr: false, dcd: false }));
+  }
+
+  getBaudRate() {
+    return super.getBaudRate()
+      .then(() => ({ baudRate: this.baudRate }));
+  }
+
+  /**
+   * Replays the events until the replay has to wait for a read, a write of the application or the time of
+   * the next received data
+   */
+  replay() {
+    if (this.timer) {
+      return;
+    }
+    while (this.opened && this.index < this.events.length) {
+      const event = this.events[this.index];
+      if (event.type === EVENTS.OPEN) {
+        // end of the session
+        return;
+      }
+      if (event.type === EVENTS.TX) {
+        if (this.written < event.data.length) {
+          return;
+        }
+        this.written -= event.data.length;
+        this.next();
+        continue;
+      }
+      if (event.type !== EVENTS.RX) {
+        this.next();
+        continue;
+      }
+
+      if (!this.pendingRead) {
+        return;
+      }
+      const speed = this.bindingOptions.speed;
+      const delay = speed > 0 ? this.eventTime + (event.time - this.events[this.index - 1].time) / speed - Date.now() : 0;
+      if (delay > 0) {
+        this.timer = setTimeout(() => {
+          this.timer = null;
+          this.replay();
+        }, delay);
+        return;
+      }
+
+      const read = this.pendingRead;
+      this.pendingRead = null;
+      const count = Math.min(read.length, event.data.length - this.dataOffset);
+      event.data.copy(read.buffer, read.offset, this.dataOffset, this.dataOffset + count);
+      this.dataOffset += count;
+      if (this.dataOffset === event.data.length) {
+        this.next();
+      }
+      read.resolve(count);
+      return;
+    }
+  }
+
+  next() {
+    this.index++;
+    this.dataOffset = 0;
+    this.eventTime = Date.now();
+  }
+}
+
+module.exports = ReplayBinding;
@@ -2,6 +2,7 @@
 const path = require('path');
 const binding = require('../native_loader').load(path.join(__dirname, 'native'));
 const BaseBinding = require('./base');
+const prepareConfig = require('./prepared-config');
 const promisify = require('../util').promisify;
 
 /**
@@ -38,7 +39,7 @@ class WindowsBinding extends BaseBinding {
         return super.open(path, options)
             .then(() => {
                 this.openOptions = Object.assign({}, this.bindingOptions, options);
-                return promisify(binding.open)(path, this.openOptions);
+                return promisify(binding.open)(path, prepareConfig(this.openOptions));
             })
             .then((fd) => {
                 this.fd = fd;
@@ -75,8 +76,13 @@ class WindowsBinding extends BaseBinding {
     }
 
     update(options) {
+        // all options are applied at once, the settings not passed are kept from open()
+        const updateOptions = Object.assign({}, this.openOptions, options);
         return super.update(options)
-            .then(() => promisify(binding.update)(this.fd, options));
+            .then(() => promisify(binding.update)(this.fd, prepareConfig(updateOptions)))
+            .then(() => {
+                this.openOptions = updateOptions;
+            });
     }
 
     set(options) {
@@ -1,11 +1,24 @@
 'use strict';
 const SerialPort = require('./serialport');
 const Binding = require('./bindings/auto-detect');
+const recordBinding = require('./bindings/recording').recordBinding;
 
 /**
  * @type {BaseBinding}
  */
 SerialPort.Binding = Binding;
 
+/**
+ * Binding of the system which records the port traffic to the file in the `record` binding option
+ * @type {BaseBinding}
+ */
+SerialPort.RecordingBinding = recordBinding(Binding);
+
+/**
+ * Binding which replays the recording in the `replay` binding option
+ * @type {BaseBinding}
+ */
+SerialPort.ReplayBinding = require('./bindings/replay');
+
 
 module.exports = SerialPort;
@@ -3,6 +3,11 @@
 const path = require('path');
 const fs = require('fs');
 
+// version of the runtime the binaries are built for, see build.js
+const RUNTIME_VERSION = process.versions.electron || process.versions.node;
+
+const otherRuntime = (file) => path.basename(file).includes('_' + RUNTIME_VERSION + '_') ? 0 : 1;
+
 const loadLibrary = (parentFolder) => {
   const folderPath = parentFolder;
   //const folderPath = path.join(parentFolder, '../../../build/Release'); // DEBUGGING
@@ -11,7 +16,9 @@ const loadLibrary = (parentFolder) => {
     if (file.endsWith('.node')) {
       return path.join(folderPath, file);
     }
-  }).filter(path => path);
+  }).filter(path => path)
+    // the binary built for the running runtime first, the others fail to load on an ABI mismatch
+    .sort((a, b) => otherRuntime(a) - otherRuntime(b));
 
   var binding = null;
   files.find((file) => {
@@ -65,7 +65,8 @@ function allocNewReadPool(poolSize) {
  * @property {boolean} [autoOpen=true] Automatically opens the port on `nextTick`.
  * @property {number=} [baudRate=9600] The baud rate of the port to be opened. This should match one of the commonly available baud rates, such as 110, 300, 1200, 2400, 4800, 9600, 14400, 19200, 38400, 57600, or 115200. Custom rates are supported best effort per platform. The device connected to the serial port is not guaranteed to support the requested baud rate, even if the port itself supports that baud rate.
  * @property {number} [dataBits=8] Must be one of these: 8, 7, 6, or 5.
- * @property {number} [highWaterMark=65536] The size of the read and write buffers defaults to 64k.
+ * @property {number} [highWaterMark=65536] The size of the read and write buffers defaults to 64k. Reading from the port pauses while this much received data waits for a consumer.
+ * @property {number=} readPoolSize Size of the buffer pool the received data is read into, defaults to the `highWaterMark`. Small pools suit ports which receive short responses.
  * @property {boolean} [lock=true] Prevent other processes from opening the port. Windows does not currently support `false`.
  * @property {number} [stopBits=1] Must be one of these: 1 or 2.
  * @property {string} [parity=none] Must be one of these: 'none', 'even', 'mark', 'odd', 'space'.
@@ -130,6 +131,10 @@ function SerialPort(path, options, openCallback) {
     throw new TypeError(`"baudRate" must be a number: ${settings.baudRate}`);
   }
 
+  if (settings.readPoolSize !== undefined && typeof settings.readPoolSize !== 'number') {
+    throw new TypeError(`"readPoolSize" must be a number: ${settings.readPoolSize}`);
+  }
+
   if (DATABITS.indexOf(settings.dataBits) === -1) {
     throw new TypeError(`"databits" is invalid: ${settings.dataBits}`);
   }
@@ -169,8 +174,9 @@ function SerialPort(path, options, openCallback) {
 
   this.opening = false;
   this.closing = false;
-  this._pool = allocNewReadPool(this.settings.highWaterMark);
+  this._captureLog = null;
   this._kMinPoolSpace = 128;
+  this._pool = allocNewReadPool(this._readPoolSize());
 
   if (this.settings.autoOpen) {
     this.open(openCallback);
@@ -248,7 +254,7 @@ SerialPort.prototype.open = function (openCallback) {
 };
 
 /**
- * Changes the baud rate for an open port. Throws if you provide a bad argument. Emits an error or calls the callback if the baud rate isn't supported.
+ * Changes the baud rate for an open port. Throws if you provide a bad argument. Emits an error or calls the callback if the baud rate isn't supported. Data buffered by the port is kept, call `.flush` to discard it.
  * @param {object=} options Only supports `baudRate`.
  * @param {number=} [options.baudRate] The baud rate of the port to be opened. This should match one of the commonly available baud rates, such as 110, 300, 1200, 2400, 4800, 9600, 14400, 19200, 38400, 57600, or 115200. Custom rates are supported best effort per platform. The device connected to the serial port is not guaranteed to support the requested baud rate, even if the port itself supports that baud rate.
  * @param {errorCallback=} [callback] Called once the port's baud rate changes. If `.update` is called without a callback, and there is an error, an error event is emitted.
@@ -358,7 +364,7 @@ SerialPort.prototype._read = function (bytesToRead) {
 
   if (!this._pool || this._pool.length - this._pool.used < this._kMinPoolSpace) {
     debug('_read', 'discarding the read buffer pool');
-    this._pool = allocNewReadPool(this.settings.highWaterMark);
+    this._pool = allocNewReadPool(this._readPoolSize());
   }
 
   // Grab another reference to the pool in the case that while we're
@@ -380,7 +386,11 @@ SerialPort.prototype._read = function (bytesToRead) {
       return;
     }
     pool.used += bytesRead;
-    this.push(pool.slice(start, start + bytesRead));
+    const data = pool.slice(start, start + bytesRead);
+    if (this._captureLog) {
+      this._captureLog.write(data);
+    }
+    this.push(data);
   }, (err) => {
     debug('binding.read', `error`, err);
     if (!err.canceled) {
@@ -390,6 +400,32 @@ SerialPort.prototype._read = function (bytesToRead) {
   });
 };
 
+SerialPort.prototype._readPoolSize = function () {
+  return Math.max(this.settings.readPoolSize || this.settings.highWaterMark, this._kMinPoolSpace);
+};
+
+/**
+ * Writes the received data with timestamps to a memory mapped, size capped rolling log file. An existing log
+ * of the same size is continued. The capture stops when the port is closed.
+ * @param {string|null} path log file or null to stop the capture
+ * @param {number=} size size of the log data in bytes
+ * @throws {Error} When the log file can't be opened or mapped.
+ * @returns {undefined}
+ */
+SerialPort.prototype.capture = function (path, size) {
+  if (this._captureLog) {
+    debug('capture', 'stopped');
+    this._captureLog.close();
+    this._captureLog = null;
+  }
+  if (path) {
+    // loaded on demand to keep this module independent of the native bindings
+    const CaptureLog = require('./bindings/capture');
+    this._captureLog = new CaptureLog(path, size);
+    debug('capture', 'started', path);
+  }
+};
+
 SerialPort.prototype._disconnected = function (err) {
   if (!this.isOpen) {
     debug('disconnected aborted because already closed', err);
@@ -427,6 +463,7 @@ SerialPort.prototype.close = function (callback, disconnectError) {
   this.binding.close().then(() => {
     this.closing = false;
     debug('binding.close', 'finished');
+    this.capture(null);
     this.emit('close', disconnectError);
     if (callback) {
       callback.call(this, disconnectError)
@@ -0,0 +1,248 @@
+#include "./capture.h"
+#include "./serialport.h"
+#include <nan.h>
+
+#ifndef WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static void formatTimestamp(char *buffer) {
+#ifdef WIN32
+  SYSTEMTIME now;
+  GetLocalTime(&now);
+  snprintf(buffer, CAPTURE_TIMESTAMP_SIZE + 1, "%04d-%02d-%02d %02d:%02d:%02d.%03d ", now.wYear, now.wMonth,
+           now.wDay, now.wHour, now.wMinute, now.wSecond, now.wMilliseconds);
+#else
+  struct timeval tv;
+  struct tm      now;
+  gettimeofday(&tv, NULL);
+  localtime_r(&tv.tv_sec, &now);
+  snprintf(buffer, CAPTURE_TIMESTAMP_SIZE + 1, "%04d-%02d-%02d %02d:%02d:%02d.%03d ", now.tm_year + 1900,
+           now.tm_mon + 1, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec, static_cast<int>(tv.tv_usec / 1000));
+#endif
+}
+
+CaptureLog::CaptureLog() {}
+
+CaptureLog::~CaptureLog() {
+  close();
+}
+
+bool CaptureLog::open(const char *path, uint64_t capacity, char *errorString, size_t errorSize) {
+  mapSize = sizeof(CaptureHeader) + capacity;
+  void *map;
+#ifdef WIN32
+  file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
+                     FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    snprintf(errorString, errorSize, "Error %lu opening capture file %s", GetLastError(), path);
+    return false;
+  }
+  LARGE_INTEGER size;
+  size.QuadPart = static_cast<LONGLONG>(mapSize);
+  // the mapping grows the file to the mapped size
+  mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(size.HighPart), size.LowPart, NULL);
+  if (mapping == NULL) {
+    snprintf(errorString, errorSize, "Error %lu mapping capture file %s", GetLastError(), path);
+    close();
+    return false;
+  }
+  map = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, mapSize);
+  if (map == NULL) {
+    snprintf(errorString, errorSize, "Error %lu mapping capture file %s", GetLastError(), path);
+    close();
+    return false;
+  }
+#else
+  fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    snprintf(errorString, errorSize, "Error %s opening capture file %s", strerror(errno), path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (static_cast<size_t>(st.st_size) != mapSize && ftruncate(fd, mapSize) == -1)) {
+    snprintf(errorString, errorSize, "Error %s resizing capture file %s", strerror(errno), path);
+    close();
+    return false;
+  }
+  map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    snprintf(errorString, errorSize, "Error %s mapping capture file %s", strerror(errno), path);
+    close();
+    return false;
+  }
+#endif
+  header = static_cast<CaptureHeader *>(map);
+  data   = static_cast<uint8_t *>(map) + sizeof(CaptureHeader);
+
+  // continue an existing log of the same size, start a new one otherwise
+  if (memcmp(header->magic, CAPTURE_MAGIC, sizeof(header->magic)) != 0 || header->capacity != capacity) {
+    memset(header, 0, sizeof(CaptureHeader));
+    memcpy(header->magic, CAPTURE_MAGIC, sizeof(header->magic));
+    header->capacity = capacity;
+  } else if (header->inLine) {
+    // terminate the line the previous session was writing
+    copy(reinterpret_cast<const uint8_t *>("\n"), 1);
+    header->inLine = 0;
+  }
+  return true;
+}
+
+void CaptureLog::copy(const uint8_t *buffer, size_t length) {
+  while (length) {
+    size_t position = static_cast<size_t>(header->written % header->capacity);
+    size_t count    = length < header->capacity - position ? length : static_cast<size_t>(header->capacity - position);
+    memcpy(data + position, buffer, count);
+    header->written += count;
+    buffer += count;
+    length -= count;
+  }
+}
+
+void CaptureLog::write(const uint8_t *buffer, size_t length) {
+  static const size_t errorPrefixSize = strlen(CAPTURE_ERROR_PREFIX);
+  // all lines of the received chunk get the same timestamp
+  char   timestamp[CAPTURE_TIMESTAMP_SIZE + 1];
+  bool   stamped = false;
+  size_t offset  = 0;
+
+  while (offset < length) {
+    if (!header->inLine) {
+      if (!stamped) {
+        formatTimestamp(timestamp);
+        stamped = true;
+      }
+      header->lineStart  = header->written;
+      header->lineLength = 0;
+      header->inLine     = 1;
+      copy(reinterpret_cast<const uint8_t *>(timestamp), CAPTURE_TIMESTAMP_SIZE);
+    }
+
+    const uint8_t *end   = static_cast<const uint8_t *>(memchr(buffer + offset, '\n', length - offset));
+    size_t         count = end ? end - (buffer + offset) + 1 : length - offset;
+
+    // the beginning of the line is kept until it is long enough to detect an error message
+    if (header->lineLength < CAPTURE_PREFIX_SIZE) {
+      size_t prefixCount = CAPTURE_PREFIX_SIZE - header->lineLength;
+      prefixCount        = count < prefixCount ? count : prefixCount;
+      memcpy(header->linePrefix + header->lineLength, buffer + offset, prefixCount);
+      bool complete = header->lineLength < errorPrefixSize && header->lineLength + prefixCount >= errorPrefixSize;
+      header->lineLength += static_cast<uint32_t>(prefixCount);
+      if (complete && memcmp(header->linePrefix, CAPTURE_ERROR_PREFIX, errorPrefixSize) == 0) {
+        header->errors[header->errorCount % CAPTURE_INDEX_SIZE] = header->lineStart;
+        header->errorCount++;
+      }
+    }
+
+    copy(buffer + offset, count);
+    if (end) {
+      header->inLine = 0;
+    }
+    offset += count;
+  }
+}
+
+void CaptureLog::close() {
+#ifdef WIN32
+  if (header) {
+    FlushViewOfFile(header, 0);
+    UnmapViewOfFile(header);
+  }
+  if (mapping != NULL) {
+    CloseHandle(mapping);
+    mapping = NULL;
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (header) {
+    munmap(header, mapSize);
+  }
+  if (fd != -1) {
+    ::close(fd);
+    fd = -1;
+  }
+#endif
+  header = nullptr;
+  data   = nullptr;
+}
+
+NAN_MODULE_INIT(CaptureLog::Init) {
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("CaptureLog").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "write", write);
+  Nan::SetPrototypeMethod(tpl, "close", close);
+
+  constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
+  Nan::Set(target, Nan::New("CaptureLog").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+NAN_METHOD(CaptureLog::New) {
+  if (!info.IsConstructCall()) {
+    const int               argc       = 2;
+    v8::Local<v8::Value>    argv[argc] = {info[0], info[1]};
+    v8::Local<v8::Function> cons       = Nan::New(constructor());
+    info.GetReturnValue().Set(Nan::NewInstance(cons, argc, argv).ToLocalChecked());
+    return;
+  }
+
+  if (!info[0]->IsString()) {
+    Nan::ThrowTypeError("path must be a string");
+    return;
+  }
+  Nan::Utf8String path(info[0]);
+
+  if (!info[1]->IsNumber()) {
+    Nan::ThrowTypeError("size must be a number");
+    return;
+  }
+  double size = Nan::To<double>(info[1]).FromJust();
+  if (size < 1024 || static_cast<uint64_t>(size) > SIZE_MAX - sizeof(CaptureHeader)) {
+    Nan::ThrowRangeError("size is out of range");
+    return;
+  }
+
+  char        errorString[ERROR_STRING_SIZE];
+  CaptureLog *obj = new CaptureLog();
+  if (!obj->open(*path, static_cast<uint64_t>(size), errorString, sizeof(errorString))) {
+    delete obj;
+    Nan::ThrowError(errorString);
+    return;
+  }
+  obj->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(CaptureLog::write) {
+  CaptureLog *obj = Nan::ObjectWrap::Unwrap<CaptureLog>(info.Holder());
+  if (!obj->header) {
+    Nan::ThrowError("Capture log is closed");
+    return;
+  }
+  if (!node::Buffer::HasInstance(info[0])) {
+    Nan::ThrowTypeError("data must be a buffer");
+    return;
+  }
+  v8::Local<v8::Object> buffer = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+  obj->write(reinterpret_cast<const uint8_t *>(node::Buffer::Data(buffer)), node::Buffer::Length(buffer));
+}
+
+NAN_METHOD(CaptureLog::close) {
+  CaptureLog *obj = Nan::ObjectWrap::Unwrap<CaptureLog>(info.Holder());
+  obj->close();
+}
+
+inline Nan::Persistent<v8::Function> &CaptureLog::constructor() {
+  static Nan::Persistent<v8::Function> my_constructor;
+  return my_constructor;
+}
@@ -0,0 +1,65 @@
+#ifndef SRC_CAPTURE_H_
+#define SRC_CAPTURE_H_
+
+#include <nan.h>
+#include <stdint.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#define CAPTURE_MAGIC "BLPCAP01"
+#define CAPTURE_PREFIX_SIZE 8
+#define CAPTURE_INDEX_SIZE 1024
+#define CAPTURE_ERROR_PREFIX "?ERROR"
+#define CAPTURE_TIMESTAMP_SIZE 24
+
+/*
+ * Layout of the capture file: the header followed by the data area which is used as ring buffer.
+ * Positions are absolute byte counts since the creation of the file, the data of the position p is
+ * stored at p % capacity. Every line starts with a "YYYY-MM-DD HH:MM:SS.mmm " timestamp, the
+ * positions of the lines starting with ?ERROR are kept in the error index ring.
+ */
+struct CaptureHeader {
+  char magic[8];
+  uint64_t capacity;
+  uint64_t written;
+  // position of the timestamp of the current line
+  uint64_t lineStart;
+  // total number of indexed error lines
+  uint64_t errorCount;
+  uint32_t lineLength;
+  char linePrefix[CAPTURE_PREFIX_SIZE];
+  uint32_t inLine;
+  uint64_t errors[CAPTURE_INDEX_SIZE];
+};
+
+class CaptureLog : public Nan::ObjectWrap {
+public:
+  static NAN_MODULE_INIT(Init);
+
+private:
+  CaptureHeader *header = nullptr;
+  uint8_t *data = nullptr;
+  size_t mapSize = 0;
+#ifdef WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#else
+  int fd = -1;
+#endif
+
+  CaptureLog();
+  ~CaptureLog();
+  bool open(const char *path, uint64_t capacity, char *errorString, size_t errorSize);
+  void write(const uint8_t *buffer, size_t length);
+  void copy(const uint8_t *buffer, size_t length);
+  void close();
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(write);
+  static NAN_METHOD(close);
+  static inline Nan::Persistent<v8::Function> &constructor();
+};
+
+#endif // SRC_CAPTURE_H_
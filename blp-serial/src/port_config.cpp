@@ -0,0 +1,70 @@
+#include "./port_config.h"
+#include <nan.h>
+
+PortConfig::PortConfig() : options() {}
+
+NAN_MODULE_INIT(PortConfig::Init) {
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("PortConfig").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  type().Reset(tpl);
+  constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
+  Nan::SetMethod(target, "prepareConfig", Prepare);
+}
+
+const PortOptions *PortConfig::From(v8::Local<v8::Value> value) {
+  if (!value->IsObject() || !Nan::New(type())->HasInstance(value)) {
+    return NULL;
+  }
+  PortConfig *obj = Nan::ObjectWrap::Unwrap<PortConfig>(Nan::To<v8::Object>(value).ToLocalChecked());
+  return &obj->options;
+}
+
+NAN_METHOD(PortConfig::New) {
+  // instances are created by prepareConfig() only
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("Use prepareConfig() to create a port config");
+    return;
+  }
+  PortConfig *obj = new PortConfig();
+  obj->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(PortConfig::Prepare) {
+  if (!info[0]->IsObject()) {
+    Nan::ThrowTypeError("First argument must be an object");
+    return;
+  }
+  PortOptions options;
+  if (!parsePortOptions(Nan::To<v8::Object>(info[0]).ToLocalChecked(), &options)) {
+    return;
+  }
+  AsyncError error;
+  error.set(0, NULL);
+  if (-1 == preparePortOptions(&options, &error)) {
+    char message[ERROR_STRING_SIZE];
+    error.format(message, sizeof(message));
+    Nan::ThrowError(message);
+    return;
+  }
+
+  v8::Local<v8::Function> cons = Nan::New(constructor());
+  v8::Local<v8::Object>   instance;
+  if (!Nan::NewInstance(cons, 0, NULL).ToLocal(&instance)) {
+    return;
+  }
+  Nan::ObjectWrap::Unwrap<PortConfig>(instance)->options = options;
+  info.GetReturnValue().Set(instance);
+}
+
+inline Nan::Persistent<v8::Function> &PortConfig::constructor() {
+  static Nan::Persistent<v8::Function> my_constructor;
+  return my_constructor;
+}
+
+inline Nan::Persistent<v8::FunctionTemplate> &PortConfig::type() {
+  static Nan::Persistent<v8::FunctionTemplate> my_type;
+  return my_type;
+}
@@ -0,0 +1,29 @@
+#ifndef SRC_PORT_CONFIG_H_
+#define SRC_PORT_CONFIG_H_
+
+#include "./serialport.h"
+#include <nan.h>
+
+/*
+ * Port options validated and converted once by binding.prepareConfig(options). Passing the returned
+ * object to open() and update() skips the property lookups and the computation of the terminal
+ * attributes.
+ */
+class PortConfig : public Nan::ObjectWrap {
+public:
+  static NAN_MODULE_INIT(Init);
+  // returns the options of a prepared config or NULL if the value is not one
+  static const PortOptions *From(v8::Local<v8::Value> value);
+
+private:
+  PortOptions options;
+
+  PortConfig();
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Prepare);
+  static inline Nan::Persistent<v8::Function> &constructor();
+  static inline Nan::Persistent<v8::FunctionTemplate> &type();
+};
+
+#endif // SRC_PORT_CONFIG_H_
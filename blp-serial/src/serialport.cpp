@@ -1,4 +1,5 @@
 #include "./serialport.h"
+#include <vector>
 
 #define OBJECT_ITEM_COM_NAME "comName"
 #define OBJECT_ITEM_VENDOR_ID "vendorId"
@@ -8,6 +9,9 @@
 #define OBJECT_ITEM_SERIAL_NUMBER "serialNumber"
 #define OBJECT_ITEM_BCDDEVICE "bcdDevice"
 
+#include "./capture.h"
+#include "./port_config.h"
+
 #ifdef __APPLE__
 #include "./darwin_list.h"
 #endif
@@ -19,428 +23,394 @@
 #include "./poller.h"
 #endif
 
-v8::Local<v8::Value> getValueFromObject(v8::Local<v8::Object> options, std::string key) {
-  v8::Local<v8::String> v8str = Nan::New<v8::String>(key).ToLocalChecked();
-  return Nan::Get(options, v8str).ToLocalChecked();
+/*
+ * Property names used by the bindings. They are created once as internalized strings, the lookups
+ * compare them by identity instead of converting and hashing a new string on every call.
+ */
+enum OptionKey {
+  KEY_BAUD_RATE,
+  KEY_DATA_BITS,
+  KEY_PARITY,
+  KEY_STOP_BITS,
+  KEY_RTSCTS,
+  KEY_XON,
+  KEY_XOFF,
+  KEY_XANY,
+  KEY_HUPCL,
+  KEY_LOCK,
+  KEY_VMIN,
+  KEY_VTIME,
+  KEY_BRK,
+  KEY_RTS,
+  KEY_CTS,
+  KEY_DTR,
+  KEY_DSR,
+  KEY_DCD,
+  KEY_PARITY_NONE,
+  KEY_PARITY_EVEN,
+  KEY_PARITY_ODD,
+  KEY_PARITY_MARK,
+  KEY_PARITY_SPACE,
+  KEY_COUNT
+};
+
+static const char *const keyNames[KEY_COUNT] = {
+    "baudRate", "dataBits", "parity", "stopBits", "rtscts", "xon",  "xoff", "xany", "hupcl", "lock",
+    "vmin",     "vtime",    "brk",    "rts",      "cts",    "dtr",  "dsr",  "dcd",  "none",  "even",
+    "odd",      "mark",     "space"};
+
+static Nan::Persistent<v8::String> keys[KEY_COUNT];
+
+static void initKeys() {
+  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+  for (int i = 0; i < KEY_COUNT; i++) {
+    keys[i].Reset(v8::String::NewFromUtf8(isolate, keyNames[i], v8::NewStringType::kInternalized).ToLocalChecked());
+  }
 }
 
-int getIntFromObject(v8::Local<v8::Object> options, std::string key) {
-  return Nan::To<v8::Int32>(getValueFromObject(options, key)).ToLocalChecked()->Value();
+static inline v8::Local<v8::String> key(OptionKey name) {
+  return Nan::New(keys[name]);
 }
 
-bool getBoolFromObject(v8::Local<v8::Object> options, std::string key) {
-  return Nan::To<v8::Boolean>(getValueFromObject(options, key)).ToLocalChecked()->Value();
+v8::Local<v8::Value> getValueFromObject(v8::Local<v8::Object> options, OptionKey name) {
+  return Nan::Get(options, key(name)).ToLocalChecked();
 }
 
-v8::Local<v8::String> getStringFromObj(v8::Local<v8::Object> options, std::string key) {
-  return Nan::To<v8::String>(getValueFromObject(options, key)).ToLocalChecked();
+int getIntFromObject(v8::Local<v8::Object> options, OptionKey name) {
+  return Nan::To<v8::Int32>(getValueFromObject(options, name)).ToLocalChecked()->Value();
 }
 
-double getDoubleFromObject(v8::Local<v8::Object> options, std::string key) {
-  return Nan::To<double>(getValueFromObject(options, key)).FromMaybe(0);
+bool getBoolFromObject(v8::Local<v8::Object> options, OptionKey name) {
+  return Nan::To<v8::Boolean>(getValueFromObject(options, name)).ToLocalChecked()->Value();
 }
 
-NAN_METHOD(Open) {
-  // path
-  if (!info[0]->IsString()) {
-    Nan::ThrowTypeError("First argument must be a string");
-    return;
-  }
-
-  Nan::Utf8String path(info[0]);
-  int             len = path.length();
-  if (len <= 0) {
-    Nan::ThrowTypeError("First argument must be a non-empty string");
-    return;
-  }
-
-  // options
-  if (!info[1]->IsObject()) {
-    Nan::ThrowTypeError("Second argument must be an object");
-    return;
-  }
-  v8::Local<v8::Object> options = Nan::To<v8::Object>(info[1]).ToLocalChecked();
-
-  // callback
-  if (!info[2]->IsFunction()) {
-    Nan::ThrowTypeError("Third argument must be a function");
-    return;
-  }
-
-  OpenBaton *baton = new OpenBaton();
-  snprintf(baton->path, sizeof(baton->path), "%s", *path);
-  baton->baudRate = getIntFromObject(options, "baudRate");
-  baton->dataBits = getIntFromObject(options, "dataBits");
-  baton->parity   = ToParityEnum(getStringFromObj(options, "parity"));
-  baton->stopBits = ToStopBitEnum(getDoubleFromObject(options, "stopBits"));
-  baton->rtscts   = getBoolFromObject(options, "rtscts");
-  baton->xon      = getBoolFromObject(options, "xon");
-  baton->xoff     = getBoolFromObject(options, "xoff");
-  baton->xany     = getBoolFromObject(options, "xany");
-  baton->hupcl    = getBoolFromObject(options, "hupcl");
-  baton->lock     = getBoolFromObject(options, "lock");
-  baton->callback.Reset(info[2].As<v8::Function>());
-
-#ifndef WIN32
-  baton->vmin  = getIntFromObject(options, "vmin");
-  baton->vtime = getIntFromObject(options, "vtime");
-#endif
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-
-  uv_queue_work(uv_default_loop(), req, EIO_Open, (uv_after_work_cb)EIO_AfterOpen);
-}
-
-void EIO_AfterOpen(uv_work_t *req) {
-  Nan::HandleScope scope;
-
-  OpenBaton *data = static_cast<OpenBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[2];
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-    argv[1] = Nan::Undefined();
-  } else {
-    argv[0] = Nan::Null();
-    argv[1] = Nan::New<v8::Int32>(data->result);
-  }
-
-  Nan::Call(data->callback, 2, argv);
-  delete data;
-  delete req;
-}
-
-NAN_METHOD(Update) {
-  // file descriptor
-  if (!info[0]->IsInt32()) {
-    Nan::ThrowTypeError("First argument must be an int");
-    return;
-  }
-  int fd = Nan::To<int>(info[0]).FromJust();
-
-  // options
-  if (!info[1]->IsObject()) {
-    Nan::ThrowTypeError("Second argument must be an object");
-    return;
-  }
-  v8::Local<v8::Object> options = Nan::To<v8::Object>(info[1]).ToLocalChecked();
-
-  if (!Nan::Has(options, Nan::New<v8::String>("baudRate").ToLocalChecked()).FromMaybe(false)) {
-    Nan::ThrowTypeError("\"baudRate\" must be set on options object");
-    return;
-  }
-
-  // callback
-  if (!info[2]->IsFunction()) {
-    Nan::ThrowTypeError("Third argument must be a function");
-    return;
-  }
-
-  ConnectionOptionsBaton *baton = new ConnectionOptionsBaton();
-
-  baton->fd       = fd;
-  baton->baudRate = getIntFromObject(options, "baudRate");
-  baton->callback.Reset(info[2].As<v8::Function>());
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-
-  uv_queue_work(uv_default_loop(), req, EIO_Update, (uv_after_work_cb)EIO_AfterUpdate);
+double getDoubleFromObject(v8::Local<v8::Object> options, OptionKey name) {
+  return Nan::To<double>(getValueFromObject(options, name)).FromMaybe(0);
 }
 
-void EIO_AfterUpdate(uv_work_t *req) {
-  Nan::HandleScope scope;
-
-  ConnectionOptionsBaton *data = static_cast<ConnectionOptionsBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[1];
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-  } else {
-    argv[0] = Nan::Null();
-  }
-
-  Nan::Call(data->callback, 1, argv);
-
-  delete data;
-  delete req;
+static SerialPortParity getParityFromObject(v8::Local<v8::Object> options) {
+  v8::Local<v8::Value> value = getValueFromObject(options, KEY_PARITY);
+  // parity names passed as literals are internalized as well and match without a conversion
+  if (value->StrictEquals(key(KEY_PARITY_NONE))) {
+    return SERIALPORT_PARITY_NONE;
+  } else if (value->StrictEquals(key(KEY_PARITY_EVEN))) {
+    return SERIALPORT_PARITY_EVEN;
+  } else if (value->StrictEquals(key(KEY_PARITY_ODD))) {
+    return SERIALPORT_PARITY_ODD;
+  } else if (value->StrictEquals(key(KEY_PARITY_MARK))) {
+    return SERIALPORT_PARITY_MARK;
+  } else if (value->StrictEquals(key(KEY_PARITY_SPACE))) {
+    return SERIALPORT_PARITY_SPACE;
+  }
+  return ToParityEnum(Nan::To<v8::String>(value).ToLocalChecked());
 }
 
-NAN_METHOD(Close) {
-  // file descriptor
-  if (!info[0]->IsInt32()) {
-    Nan::ThrowTypeError("First argument must be an int");
-    return;
-  }
-
-  // callback
-  if (!info[1]->IsFunction()) {
-    Nan::ThrowTypeError("Second argument must be a function");
-    return;
-  }
-
-  VoidBaton *baton = new VoidBaton();
-  baton->fd        = Nan::To<v8::Int32>(info[0]).ToLocalChecked()->Value();
-  baton->callback.Reset(info[1].As<v8::Function>());
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-  uv_queue_work(uv_default_loop(), req, EIO_Close, (uv_after_work_cb)EIO_AfterClose);
+bool parsePortOptions(v8::Local<v8::Object> object, PortOptions *options) {
+  *options          = PortOptions();
+  options->baudRate = getIntFromObject(object, KEY_BAUD_RATE);
+  options->dataBits = getIntFromObject(object, KEY_DATA_BITS);
+  options->parity   = getParityFromObject(object);
+  options->stopBits = ToStopBitEnum(getDoubleFromObject(object, KEY_STOP_BITS));
+  options->rtscts   = getBoolFromObject(object, KEY_RTSCTS);
+  options->xon      = getBoolFromObject(object, KEY_XON);
+  options->xoff     = getBoolFromObject(object, KEY_XOFF);
+  options->xany     = getBoolFromObject(object, KEY_XANY);
+  options->hupcl    = getBoolFromObject(object, KEY_HUPCL);
+  options->lock     = getBoolFromObject(object, KEY_LOCK);
+#ifndef WIN32
+  options->vmin  = getIntFromObject(object, KEY_VMIN);
+  options->vtime = getIntFromObject(object, KEY_VTIME);
+#endif
+  return true;
 }
 
-void EIO_AfterClose(uv_work_t *req) {
-  Nan::HandleScope scope;
-  VoidBaton *      data = static_cast<VoidBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[1];
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-  } else {
-    argv[0] = Nan::Null();
+void AsyncError::format(char *message, size_t size) const {
+  int length = text ? snprintf(message, size, context, text) : snprintf(message, size, context, value);
+  if (code && length >= 0 && static_cast<size_t>(length) + 2 < size) {
+    snprintf(message + length, size - length, ": ");
+    formatSystemError(code, message + length + 2, size - length - 2);
   }
-  Nan::Call(data->callback, 1, argv);
-
-  delete data;
-  delete req;
 }
 
-NAN_METHOD(Flush) {
-  // file descriptor
+// finished operations are kept for reuse up to this number per operation type
+#define ASYNC_OP_POOL_SIZE 4
+
+/*
+ * Runs an operation in the libuv thread pool and passes the result to a JS callback. The operation
+ * is described by its traits:
+ *   Baton              data of the operation, filled by parse() and read by the worker thread
+ *   callbackIndex      index of the callback argument
+ *   resultCount        number of values passed to the callback after the error
+ *   parse(info, data, err) reads the JS arguments, returns false after throwing a JS error. Errors
+ *                      set in err are passed to the callback without running the operation.
+ *   execute(data, err) runs in the worker thread
+ *   results(data, argv) creates the callback values of a successful operation
+ * Operation objects are pooled, modem line polling reuses them instead of allocating on every call.
+ */
+template <typename Op> class AsyncOp {
+public:
+  static NAN_METHOD(Run) {
+    if (!info[Op::callbackIndex]->IsFunction()) {
+      Nan::ThrowTypeError(Op::callbackError);
+      return;
+    }
+    AsyncOp *op = acquire();
+    if (!Op::parse(info, &op->data, &op->error)) {
+      release(op);
+      return;
+    }
+    op->callback.Reset(info[Op::callbackIndex].template As<v8::Function>());
+    uv_queue_work(uv_default_loop(), &op->req, Work, After);
+  }
+
+private:
+  uv_work_t req;
+  Nan::Callback callback;
+  typename Op::Baton data;
+  AsyncError error;
+
+  static std::vector<AsyncOp *> &pool() {
+    static std::vector<AsyncOp *> ops;
+    return ops;
+  }
+
+  // called in the main thread only
+  static AsyncOp *acquire() {
+    AsyncOp *op;
+    if (pool().empty()) {
+      op           = new AsyncOp();
+      op->req.data = op;
+    } else {
+      op = pool().back();
+      pool().pop_back();
+    }
+    op->data = typename Op::Baton();
+    op->error.set(0, NULL);
+    return op;
+  }
+
+  static void release(AsyncOp *op) {
+    op->callback.Reset();
+    if (pool().size() < ASYNC_OP_POOL_SIZE) {
+      pool().push_back(op);
+    } else {
+      delete op;
+    }
+  }
+
+  static void Work(uv_work_t *req) {
+    AsyncOp *op = static_cast<AsyncOp *>(req->data);
+    if (!op->error.failed()) {
+      Op::execute(&op->data, &op->error);
+    }
+  }
+
+  static void After(uv_work_t *req, int) {
+    Nan::HandleScope scope;
+    AsyncOp *op = static_cast<AsyncOp *>(req->data);
+
+    v8::Local<v8::Value> argv[1 + Op::resultCount];
+    if (op->error.failed()) {
+      char message[ERROR_STRING_SIZE];
+      op->error.format(message, sizeof(message));
+      argv[0] = v8::Exception::Error(Nan::New<v8::String>(message).ToLocalChecked());
+      for (int i = 1; i <= Op::resultCount; i++) {
+        argv[i] = Nan::Undefined();
+      }
+    } else {
+      argv[0] = Nan::Null();
+      Op::results(&op->data, argv + 1);
+    }
+
+    Nan::Call(op->callback, 1 + Op::resultCount, argv);
+    release(op);
+  }
+};
+
+static bool parseFd(const Nan::FunctionCallbackInfo<v8::Value> &info, int *fd) {
   if (!info[0]->IsInt32()) {
     Nan::ThrowTypeError("First argument must be an int");
-    return;
-  }
-  int fd = Nan::To<int>(info[0]).FromJust();
-
-  // callback
-  if (!info[1]->IsFunction()) {
-    Nan::ThrowTypeError("Second argument must be a function");
-    return;
-  }
-  v8::Local<v8::Function> callback = info[1].As<v8::Function>();
-
-  VoidBaton *baton = new VoidBaton();
-  baton->fd        = fd;
-  baton->callback.Reset(callback);
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-  uv_queue_work(uv_default_loop(), req, EIO_Flush, (uv_after_work_cb)EIO_AfterFlush);
-}
-
-void EIO_AfterFlush(uv_work_t *req) {
-  Nan::HandleScope scope;
-
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[1];
-
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-  } else {
-    argv[0] = Nan::Null();
+    return false;
   }
-
-  Nan::Call(data->callback, 1, argv);
-
-  delete data;
-  delete req;
+  *fd = Nan::To<int>(info[0]).FromJust();
+  return true;
 }
 
-NAN_METHOD(Set) {
-  // file descriptor
-  if (!info[0]->IsInt32()) {
-    Nan::ThrowTypeError("First argument must be an int");
-    return;
-  }
-  int fd = Nan::To<int>(info[0]).FromJust();
-
-  // options
+static bool parseOptions(const Nan::FunctionCallbackInfo<v8::Value> &info, v8::Local<v8::Object> *options) {
   if (!info[1]->IsObject()) {
     Nan::ThrowTypeError("Second argument must be an object");
-    return;
-  }
-  v8::Local<v8::Object> options = Nan::To<v8::Object>(info[1]).ToLocalChecked();
-
-  // callback
-  if (!info[2]->IsFunction()) {
-    Nan::ThrowTypeError("Third argument must be a function");
-    return;
+    return false;
   }
-  v8::Local<v8::Function> callback = info[2].As<v8::Function>();
-
-  SetBaton *baton = new SetBaton();
-  baton->fd       = fd;
-  baton->callback.Reset(callback);
-  baton->brk = getBoolFromObject(options, "brk");
-  baton->rts = getBoolFromObject(options, "rts");
-  baton->cts = getBoolFromObject(options, "cts");
-  baton->dtr = getBoolFromObject(options, "dtr");
-  baton->dsr = getBoolFromObject(options, "dsr");
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-  uv_queue_work(uv_default_loop(), req, EIO_Set, (uv_after_work_cb)EIO_AfterSet);
+  *options = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+  return true;
 }
 
-void EIO_AfterSet(uv_work_t *req) {
-  Nan::HandleScope scope;
-
-  SetBaton *data = static_cast<SetBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[1];
-
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-  } else {
-    argv[0] = Nan::Null();
-  }
-  Nan::Call(data->callback, 1, argv);
-
-  delete data;
-  delete req;
-}
-
-NAN_METHOD(Get) {
-  // file descriptor
-  if (!info[0]->IsInt32()) {
-    Nan::ThrowTypeError("First argument must be an int");
-    return;
-  }
-  int fd = Nan::To<int>(info[0]).FromJust();
-
-  // callback
-  if (!info[1]->IsFunction()) {
-    Nan::ThrowTypeError("Second argument must be a function");
-    return;
-  }
-
-  GetBaton *baton = new GetBaton();
-  baton->fd       = fd;
-  baton->cts      = false;
-  baton->dsr      = false;
-  baton->dcd      = false;
-  baton->callback.Reset(info[1].As<v8::Function>());
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-  uv_queue_work(uv_default_loop(), req, EIO_Get, (uv_after_work_cb)EIO_AfterGet);
+/*
+ * Reads the options argument, either a config from prepareConfig() or a plain options object which is
+ * prepared for this call only
+ */
+static bool parseConfig(const Nan::FunctionCallbackInfo<v8::Value> &info, PortOptions *options, AsyncError *error) {
+  const PortOptions *prepared = PortConfig::From(info[1]);
+  if (prepared) {
+    *options = *prepared;
+    return true;
+  }
+  v8::Local<v8::Object> object;
+  if (!parseOptions(info, &object) || !parsePortOptions(object, options)) {
+    return false;
+  }
+  preparePortOptions(options, error);
+  return true;
 }
 
-void EIO_AfterGet(uv_work_t *req) {
-  Nan::HandleScope scope;
-
-  GetBaton *data = static_cast<GetBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[2];
-
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-    argv[1] = Nan::Undefined();
-  } else {
+struct OpenOp {
+  typedef OpenBaton Baton;
+  static const int  callbackIndex = 2;
+  static const int  resultCount   = 1;
+  static const char callbackError[];
+
+  static bool parse(const Nan::FunctionCallbackInfo<v8::Value> &info, OpenBaton *data, AsyncError *error) {
+    if (!info[0]->IsString()) {
+      Nan::ThrowTypeError("First argument must be a string");
+      return false;
+    }
+    Nan::Utf8String path(info[0]);
+    if (path.length() <= 0) {
+      Nan::ThrowTypeError("First argument must be a non-empty string");
+      return false;
+    }
+    snprintf(data->path, sizeof(data->path), "%s", *path);
+    return parseConfig(info, data, error);
+  }
+
+  static void execute(OpenBaton *data, AsyncError *error) { EIO_Open(data, error); }
+
+  static void results(OpenBaton *data, v8::Local<v8::Value> *argv) { argv[0] = Nan::New<v8::Int32>(data->result); }
+};
+const char OpenOp::callbackError[] = "Third argument must be a function";
+
+struct UpdateOp {
+  typedef ConnectionOptionsBaton Baton;
+  static const int  callbackIndex = 2;
+  static const int  resultCount   = 0;
+  static const char callbackError[];
+
+  static bool parse(const Nan::FunctionCallbackInfo<v8::Value> &info, ConnectionOptionsBaton *data, AsyncError *) {
+    if (!parseFd(info, &data->fd)) {
+      return false;
+    }
+    // a prepared config replaces all options, a plain object changes the baud rate only
+    const PortOptions *prepared = PortConfig::From(info[1]);
+    if (prepared) {
+      data->prepared = true;
+      data->options  = *prepared;
+      data->baudRate = prepared->baudRate;
+      return true;
+    }
+    v8::Local<v8::Object> options;
+    if (!parseOptions(info, &options)) {
+      return false;
+    }
+    if (!Nan::Has(options, key(KEY_BAUD_RATE)).FromMaybe(false)) {
+      Nan::ThrowTypeError("\"baudRate\" must be set on options object");
+      return false;
+    }
+    data->baudRate = getIntFromObject(options, KEY_BAUD_RATE);
+    return true;
+  }
+
+  static void execute(ConnectionOptionsBaton *data, AsyncError *error) { EIO_Update(data, error); }
+
+  static void results(ConnectionOptionsBaton *, v8::Local<v8::Value> *) {}
+};
+const char UpdateOp::callbackError[] = "Third argument must be a function";
+
+struct SetOp {
+  typedef SetBaton Baton;
+  static const int  callbackIndex = 2;
+  static const int  resultCount   = 0;
+  static const char callbackError[];
+
+  static bool parse(const Nan::FunctionCallbackInfo<v8::Value> &info, SetBaton *data, AsyncError *) {
+    v8::Local<v8::Object> options;
+    if (!parseFd(info, &data->fd) || !parseOptions(info, &options)) {
+      return false;
+    }
+    data->brk = getBoolFromObject(options, KEY_BRK);
+    data->rts = getBoolFromObject(options, KEY_RTS);
+    data->cts = getBoolFromObject(options, KEY_CTS);
+    data->dtr = getBoolFromObject(options, KEY_DTR);
+    data->dsr = getBoolFromObject(options, KEY_DSR);
+    return true;
+  }
+
+  static void execute(SetBaton *data, AsyncError *error) { EIO_Set(data, error); }
+
+  static void results(SetBaton *, v8::Local<v8::Value> *) {}
+};
+const char SetOp::callbackError[] = "Third argument must be a function";
+
+struct GetOp {
+  typedef GetBaton Baton;
+  static const int  callbackIndex = 1;
+  static const int  resultCount   = 1;
+  static const char callbackError[];
+
+  static bool parse(const Nan::FunctionCallbackInfo<v8::Value> &info, GetBaton *data, AsyncError *) {
+    return parseFd(info, &data->fd);
+  }
+
+  static void execute(GetBaton *data, AsyncError *error) { EIO_Get(data, error); }
+
+  static void results(GetBaton *data, v8::Local<v8::Value> *argv) {
     v8::Local<v8::Object> results = Nan::New<v8::Object>();
-    Nan::Set(results, Nan::New<v8::String>("cts").ToLocalChecked(), Nan::New<v8::Boolean>(data->cts));
-    Nan::Set(results, Nan::New<v8::String>("dsr").ToLocalChecked(), Nan::New<v8::Boolean>(data->dsr));
-    Nan::Set(results, Nan::New<v8::String>("dcd").ToLocalChecked(), Nan::New<v8::Boolean>(data->dcd));
-
-    argv[0] = Nan::Null();
-    argv[1] = results;
+    Nan::Set(results, key(KEY_CTS), Nan::New<v8::Boolean>(data->cts));
+    Nan::Set(results, key(KEY_DSR), Nan::New<v8::Boolean>(data->dsr));
+    Nan::Set(results, key(KEY_DCD), Nan::New<v8::Boolean>(data->dcd));
+    argv[0] = results;
   }
-  Nan::Call(data->callback, 2, argv);
-
-  delete data;
-  delete req;
-}
+};
+const char GetOp::callbackError[] = "Second argument must be a function";
 
-NAN_METHOD(GetBaudRate) {
-  // file descriptor
-  if (!info[0]->IsInt32()) {
-    Nan::ThrowTypeError("First argument must be an int");
-    return;
-  }
-  int fd = Nan::To<int>(info[0]).FromJust();
+struct GetBaudRateOp {
+  typedef GetBaudRateBaton Baton;
+  static const int  callbackIndex = 1;
+  static const int  resultCount   = 1;
+  static const char callbackError[];
 
-  // callback
-  if (!info[1]->IsFunction()) {
-    Nan::ThrowTypeError("Second argument must be a function");
-    return;
+  static bool parse(const Nan::FunctionCallbackInfo<v8::Value> &info, GetBaudRateBaton *data, AsyncError *) {
+    return parseFd(info, &data->fd);
   }
 
-  GetBaudRateBaton *baton = new GetBaudRateBaton();
-  baton->fd               = fd;
-  baton->baudRate         = 0;
-  baton->callback.Reset(info[1].As<v8::Function>());
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-  uv_queue_work(uv_default_loop(), req, EIO_GetBaudRate, (uv_after_work_cb)EIO_AfterGetBaudRate);
-}
-
-void EIO_AfterGetBaudRate(uv_work_t *req) {
-  Nan::HandleScope scope;
-
-  GetBaudRateBaton *data = static_cast<GetBaudRateBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[2];
+  static void execute(GetBaudRateBaton *data, AsyncError *error) { EIO_GetBaudRate(data, error); }
 
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-    argv[1] = Nan::Undefined();
-  } else {
+  static void results(GetBaudRateBaton *data, v8::Local<v8::Value> *argv) {
     v8::Local<v8::Object> results = Nan::New<v8::Object>();
-    Nan::Set(results, Nan::New<v8::String>("baudRate").ToLocalChecked(),
-                 Nan::New<v8::Integer>(data->baudRate));
-
-    argv[0] = Nan::Null();
-    argv[1] = results;
+    Nan::Set(results, key(KEY_BAUD_RATE), Nan::New<v8::Integer>(data->baudRate));
+    argv[0] = results;
   }
-  Nan::Call(data->callback, 2, argv);
-
-  delete data;
-  delete req;
-}
+};
+const char GetBaudRateOp::callbackError[] = "Second argument must be a function";
 
-NAN_METHOD(Drain) {
-  // file descriptor
-  if (!info[0]->IsInt32()) {
-    Nan::ThrowTypeError("First argument must be an int");
-    return;
-  }
-  int fd = Nan::To<int>(info[0]).FromJust();
+/*
+ * Operations which only take the file descriptor and report success or failure
+ */
+template <void (*Execute)(VoidBaton *, AsyncError *)> struct VoidOp {
+  typedef VoidBaton Baton;
+  static const int  callbackIndex = 1;
+  static const int  resultCount   = 0;
+  static const char callbackError[];
 
-  // callback
-  if (!info[1]->IsFunction()) {
-    Nan::ThrowTypeError("Second argument must be a function");
-    return;
+  static bool parse(const Nan::FunctionCallbackInfo<v8::Value> &info, VoidBaton *data, AsyncError *) {
+    return parseFd(info, &data->fd);
   }
 
-  VoidBaton *baton = new VoidBaton();
-  baton->fd        = fd;
-  baton->callback.Reset(info[1].As<v8::Function>());
-
-  uv_work_t *req = new uv_work_t();
-  req->data      = baton;
-  uv_queue_work(uv_default_loop(), req, EIO_Drain, (uv_after_work_cb)EIO_AfterDrain);
-}
+  static void execute(VoidBaton *data, AsyncError *error) { Execute(data, error); }
 
-void EIO_AfterDrain(uv_work_t *req) {
-  Nan::HandleScope scope;
-
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
-  v8::Local<v8::Value> argv[1];
-
-  if (data->errorString[0]) {
-    argv[0] = v8::Exception::Error(Nan::New<v8::String>(data->errorString).ToLocalChecked());
-  } else {
-    argv[0] = Nan::Null();
-  }
-  Nan::Call(data->callback, 1, argv);
-
-  delete data;
-  delete req;
-}
+  static void results(VoidBaton *, v8::Local<v8::Value> *) {}
+};
+template <void (*Execute)(VoidBaton *, AsyncError *)>
+const char VoidOp<Execute>::callbackError[] = "Second argument must be a function";
 
 SerialPortParity NAN_INLINE(ToParityEnum(const v8::Local<v8::String> &v8str)) {
   Nan::HandleScope scope;
@@ -474,14 +444,17 @@ SerialPortStopBits NAN_INLINE(ToStopBitEnum(double stopBits)) {
 extern "C" {
 void init(v8::Local<v8::Object> target) {
   Nan::HandleScope scope;
-  Nan::SetMethod(target, "set", Set);
-  Nan::SetMethod(target, "get", Get);
-  Nan::SetMethod(target, "getBaudRate", GetBaudRate);
-  Nan::SetMethod(target, "open", Open);
-  Nan::SetMethod(target, "update", Update);
-  Nan::SetMethod(target, "close", Close);
-  Nan::SetMethod(target, "flush", Flush);
-  Nan::SetMethod(target, "drain", Drain);
+  initKeys();
+  Nan::SetMethod(target, "set", AsyncOp<SetOp>::Run);
+  Nan::SetMethod(target, "get", AsyncOp<GetOp>::Run);
+  Nan::SetMethod(target, "getBaudRate", AsyncOp<GetBaudRateOp>::Run);
+  Nan::SetMethod(target, "open", AsyncOp<OpenOp>::Run);
+  Nan::SetMethod(target, "update", AsyncOp<UpdateOp>::Run);
+  Nan::SetMethod(target, "close", AsyncOp<VoidOp<EIO_Close> >::Run);
+  Nan::SetMethod(target, "flush", AsyncOp<VoidOp<EIO_Flush> >::Run);
+  Nan::SetMethod(target, "drain", AsyncOp<VoidOp<EIO_Drain> >::Run);
+  CaptureLog::Init(target);
+  PortConfig::Init(target);
 
 #ifdef __APPLE__
   Nan::SetMethod(target, "list", List);
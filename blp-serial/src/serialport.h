@@ -6,39 +6,45 @@
 #include <string.h>
 #include <string>
 
-#define ERROR_STRING_SIZE 1024
-
-NAN_METHOD(Open);
-void EIO_Open(uv_work_t *req);
-void EIO_AfterOpen(uv_work_t *req);
-
-NAN_METHOD(Update);
-void EIO_Update(uv_work_t *req);
-void EIO_AfterUpdate(uv_work_t *req);
-
-NAN_METHOD(Close);
-void EIO_Close(uv_work_t *req);
-void EIO_AfterClose(uv_work_t *req);
-
-NAN_METHOD(Flush);
-void EIO_Flush(uv_work_t *req);
-void EIO_AfterFlush(uv_work_t *req);
-
-NAN_METHOD(Set);
-void EIO_Set(uv_work_t *req);
-void EIO_AfterSet(uv_work_t *req);
+#ifndef WIN32
+#include "./serialport_unix.h"
+#endif
 
-NAN_METHOD(Get);
-void EIO_Get(uv_work_t *req);
-void EIO_AfterGet(uv_work_t *req);
+#define ERROR_STRING_SIZE 1024
 
-NAN_METHOD(GetBaudRate);
-void EIO_GetBaudRate(uv_work_t *req);
-void EIO_AfterGetBaudRate(uv_work_t *req);
+/*
+ * Error of an asynchronous operation. Only the system error code and a description of the failed
+ * step are stored in the worker thread, the message is formatted when the error is passed to JS.
+ */
+struct AsyncError {
+  // errno or GetLastError() value, 0 if the error was not reported by the system
+  int code;
+  // printf format of the failed step, formatted with either text or value
+  const char *context;
+  const char *text;
+  int value;
+
+  bool failed() const { return context != NULL; }
+
+  void set(int code, const char *context, int value = 0) {
+    this->code    = code;
+    this->context = context;
+    this->text    = NULL;
+    this->value   = value;
+  }
+
+  void set(int code, const char *context, const char *text) {
+    this->code    = code;
+    this->context = context;
+    this->text    = text;
+    this->value   = 0;
+  }
+
+  void format(char *message, size_t size) const;
+};
 
-NAN_METHOD(Drain);
-void EIO_Drain(uv_work_t *req);
-void EIO_AfterDrain(uv_work_t *req);
+// platform specific text of a system error code
+void formatSystemError(int code, char *message, size_t size);
 
 enum SerialPortParity {
   SERIALPORT_PARITY_NONE = 1,
@@ -57,12 +63,11 @@ enum SerialPortStopBits {
 SerialPortParity ToParityEnum(const v8::Local<v8::String> &str);
 SerialPortStopBits ToStopBitEnum(double stopBits);
 
-struct OpenBaton {
-  char errorString[ERROR_STRING_SIZE];
-  Nan::Callback callback;
-  char path[1024];
-  int fd;
-  int result;
+/*
+ * Validated options of a port. On unix the terminal attributes are computed once when the options are
+ * prepared and applied as a whole when the port is opened or updated.
+ */
+struct PortOptions {
   int baudRate;
   int dataBits;
   bool rtscts;
@@ -77,21 +82,31 @@ struct OpenBaton {
 #ifndef WIN32
   uint8_t vmin;
   uint8_t vtime;
+  TermiosImage termios;
 #endif
 };
 
+// reads the options from a JS object, returns false after throwing a JS error
+bool parsePortOptions(v8::Local<v8::Object> object, PortOptions *options);
+// platform specific validation and precomputation of the options
+int preparePortOptions(PortOptions *options, AsyncError *error);
+
+struct OpenBaton : PortOptions {
+  char path[1024];
+  int fd;
+  int result;
+};
+
 struct ConnectionOptionsBaton {
-  char errorString[ERROR_STRING_SIZE];
-  Nan::Callback callback;
   int fd;
   int baudRate;
+  // apply all options instead of only changing the baud rate
+  bool prepared;
+  PortOptions options;
 };
 
 struct SetBaton {
   int fd;
-  Nan::Callback callback;
-  int result;
-  char errorString[ERROR_STRING_SIZE];
   bool rts;
   bool cts;
   bool dtr;
@@ -101,8 +116,6 @@ struct SetBaton {
 
 struct GetBaton {
   int fd;
-  Nan::Callback callback;
-  char errorString[ERROR_STRING_SIZE];
   bool cts;
   bool dsr;
   bool dcd;
@@ -110,17 +123,27 @@ struct GetBaton {
 
 struct GetBaudRateBaton {
   int fd;
-  Nan::Callback callback;
-  char errorString[ERROR_STRING_SIZE];
   int baudRate;
 };
 
 struct VoidBaton {
   int fd;
-  Nan::Callback callback;
-  char errorString[ERROR_STRING_SIZE];
 };
 
-int setup(int fd, OpenBaton *data);
-int setBaudRate(ConnectionOptionsBaton *data);
+// the operations run in the thread pool, see AsyncOp in serialport.cpp
+void EIO_Open(OpenBaton *data, AsyncError *error);
+void EIO_Update(ConnectionOptionsBaton *data, AsyncError *error);
+void EIO_Close(VoidBaton *data, AsyncError *error);
+void EIO_Flush(VoidBaton *data, AsyncError *error);
+void EIO_Set(SetBaton *data, AsyncError *error);
+void EIO_Get(GetBaton *data, AsyncError *error);
+void EIO_GetBaudRate(GetBaudRateBaton *data, AsyncError *error);
+void EIO_Drain(VoidBaton *data, AsyncError *error);
+
+int setup(int fd, OpenBaton *data, AsyncError *error);
+int setBaudRate(int fd, int baudRate, AsyncError *error);
+#ifndef WIN32
+int applyTermios(int fd, const TermiosImage *image, AsyncError *error);
+#endif
+
 #endif // SRC_SERIALPORT_H_
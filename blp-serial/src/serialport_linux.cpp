@@ -2,38 +2,61 @@
 
 #include <asm/ioctls.h>
 #include <asm/termbits.h>
+#include <string.h>
 #include <sys/ioctl.h>
 
-// Uses the termios2 interface to set nonstandard baud rates
-int linuxSetCustomBaudRate(const int fd, const unsigned int baudrate) {
+#include "serialport_linux.h"
+
+// Uses termios2 interface to retrieve system reported baud rate
+int linuxGetSystemBaudRate(const int fd, int *const outbaud) {
   struct termios2 t;
 
   if (ioctl(fd, TCGETS2, &t)) {
     return -1;
   }
 
-  t.c_cflag &= ~CBAUD;
-  t.c_cflag |= BOTHER;
-  t.c_ospeed = t.c_ispeed = baudrate;
-
-  if (ioctl(fd, TCSETS2, &t)) {
-    return -2;
-  }
+  *outbaud = static_cast<int>(t.c_ospeed);
 
   return 0;
 }
 
-// Uses termios2 interface to retrieve system reported baud rate
-int linuxGetSystemBaudRate(const int fd, int *const outbaud) {
+// Reads the terminal attributes with the speed moved out of the control flags
+int linuxReadTermios(const int fd, TermiosImage *image) {
   struct termios2 t;
 
   if (ioctl(fd, TCGETS2, &t)) {
     return -1;
   }
 
-  *outbaud = static_cast<int>(t.c_ospeed);
+  memset(image, 0, sizeof(*image));
+  image->iflag = t.c_iflag;
+  image->oflag = t.c_oflag;
+  image->cflag = t.c_cflag & ~(CBAUD | CIBAUD);
+  image->lflag = t.c_lflag;
+  memcpy(image->cc, t.c_cc, sizeof(t.c_cc) < sizeof(image->cc) ? sizeof(t.c_cc) : sizeof(image->cc));
+  if ((t.c_cflag & CBAUD) == BOTHER) {
+    image->speed = B38400;
+    image->customSpeed = t.c_ospeed;
+  } else {
+    image->speed = t.c_cflag & CBAUD;
+  }
 
   return 0;
 }
 
+// Sets all terminal attributes including a nonstandard baud rate with one TCSETS2 call
+int linuxApplyTermios(const int fd, const TermiosImage *image) {
+  struct termios2 t;
+  memset(&t, 0, sizeof(t));
+
+  t.c_iflag = image->iflag;
+  t.c_oflag = image->oflag;
+  t.c_cflag = image->cflag | (image->customSpeed ? BOTHER : image->speed);
+  t.c_lflag = image->lflag;
+  memcpy(t.c_cc, image->cc, sizeof(t.c_cc) < sizeof(image->cc) ? sizeof(t.c_cc) : sizeof(image->cc));
+  t.c_ospeed = t.c_ispeed = image->customSpeed;
+
+  return ioctl(fd, TCSETS2, &t);
+}
+
 #endif
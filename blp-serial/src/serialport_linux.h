@@ -1,8 +1,12 @@
 #ifndef SRC_SERIALPORT_LINUX_H_
 #define SRC_SERIALPORT_LINUX_H_
 
-int linuxSetCustomBaudRate(const int fd, const unsigned int baudrate);
+#include "serialport_unix.h"
+
+int linuxReadTermios(const int fd, TermiosImage *image);
 
 int linuxGetSystemBaudRate(const int fd, int *const outbaud);
 
+int linuxApplyTermios(const int fd, const TermiosImage *image);
+
 #endif // SRC_SERIALPORT_LINUX_H_
@@ -2,11 +2,15 @@
 #include "serialport.h"
 
 #include <errno.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/file.h>
 #include <termios.h>
 #include <unistd.h>
 
+#include <map>
+#include <mutex>
+
 #ifdef __APPLE__
 #include <AvailabilityMacros.h>
 #include <sys/param.h>
@@ -113,19 +117,75 @@ int ToDataBitsConstant(int dataBits) {
   return -1;
 }
 
-void EIO_Open(uv_work_t *req) {
-  OpenBaton *data = static_cast<OpenBaton *>(req->data);
+void formatSystemError(int code, char *message, size_t size) {
+  snprintf(message, size, "%s", strerror(code));
+}
+
+/*
+ * Last state written to each open port. Changes are compared with it and only the differing parts
+ * are written, the state is dropped when the port is closed.
+ */
+struct PortShadow {
+  bool         termiosValid;
+  TermiosImage termios;
+  // modem lines as set by TIOCMSET
+  bool modemValid;
+  int  modemBits;
+  bool brkValid;
+  bool brk;
+};
+
+// operations of the same port may run in parallel in the thread pool
+static std::mutex                shadowMutex;
+static std::map<int, PortShadow> shadows;
+
+// returns a copy of the state of the port, all parts are invalid for unknown ports
+static PortShadow readShadow(int fd) {
+  std::lock_guard<std::mutex>               lock(shadowMutex);
+  std::map<int, PortShadow>::const_iterator it = shadows.find(fd);
+  return it == shadows.end() ? PortShadow() : it->second;
+}
+
+// stores the attributes of the port, NULL if they are unknown
+static void writeShadowTermios(int fd, const TermiosImage *image) {
+  std::lock_guard<std::mutex> lock(shadowMutex);
+  PortShadow                 &shadow = shadows[fd];
+  shadow.termiosValid               = image != NULL;
+  if (image) {
+    shadow.termios = *image;
+  }
+}
+
+static void writeShadowModem(int fd, bool valid, int bits) {
+  std::lock_guard<std::mutex> lock(shadowMutex);
+  PortShadow                 &shadow = shadows[fd];
+  shadow.modemValid                 = valid;
+  shadow.modemBits                  = bits;
+}
+
+static void writeShadowBreak(int fd, bool valid, bool brk) {
+  std::lock_guard<std::mutex> lock(shadowMutex);
+  PortShadow                 &shadow = shadows[fd];
+  shadow.brkValid                   = valid;
+  shadow.brk                        = brk;
+}
+
+static void dropShadow(int fd) {
+  std::lock_guard<std::mutex> lock(shadowMutex);
+  shadows.erase(fd);
+}
 
+void EIO_Open(OpenBaton *data, AsyncError *error) {
   int flags = (O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC | O_SYNC);
   int fd = open(data->path, flags);
 
   if (-1 == fd) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, cannot open %s", strerror(errno), data->path);
+    error->set(errno, "Cannot open %s", data->path);
     return;
   }
 
-  if (-1 == setup(fd, data)) {
+  if (-1 == setup(fd, data, error)) {
+    dropShadow(fd);
     close(fd);
     return;
   }
@@ -133,226 +193,227 @@ void EIO_Open(uv_work_t *req) {
   data->result = fd;
 }
 
-int setBaudRate(ConnectionOptionsBaton *data) {
-  // lookup the standard baudrates from the table
-  int baudRate = ToBaudConstant(data->baudRate);
-  int fd = data->fd;
-
-  // get port options
-  struct termios options;
-  if (-1 == tcgetattr(fd, &options)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s setting custom baud rate of %d", strerror(errno),
-             data->baudRate);
+// sets the speed fields of the image, custom baud rates use B38400 as placeholder
+static int setTermiosSpeed(TermiosImage *image, int baudRate, AsyncError *error) {
+  int speed = ToBaudConstant(baudRate);
+  image->customSpeed = 0;
+  if (-1 == speed) {
+#if (defined(__linux__) && defined(ASYNC_SPD_CUST)) ||                          \
+    (defined(MAC_OS_X_VERSION_10_4) &&                                         \
+     (MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_4))
+    speed = B38400;
+    image->customSpeed = baudRate;
+#else
+    error->set(0, "Baud rate of %d is not supported on your platform", baudRate);
     return -1;
+#endif
   }
+  image->speed = speed;
+  return 0;
+}
 
-// If there is a custom baud rate on linux you can do the following trick with
-// B38400
-#if defined(__linux__) && defined(ASYNC_SPD_CUST)
-  if (baudRate == -1) {
-    int err = linuxSetCustomBaudRate(fd, data->baudRate);
-
-    if (err == -1) {
-      snprintf(data->errorString, sizeof(data->errorString),
-               "Error: %s || while retrieving termios2 info", strerror(errno));
-      return -1;
-    } else if (err == -2) {
-      snprintf(data->errorString, sizeof(data->errorString),
-               "Error: %s || while setting custom baud rate of %d",
-               strerror(errno), data->baudRate);
-      return -1;
-    }
-
-    return 1;
+// reads the current attributes of a port which were not written by the bindings
+static int readTermios(int fd, TermiosImage *image) {
+#if defined(__linux__)
+  return linuxReadTermios(fd, image);
+#else
+  struct termios attributes;
+  if (-1 == tcgetattr(fd, &attributes)) {
+    return -1;
   }
+  memset(image, 0, sizeof(*image));
+  image->iflag = attributes.c_iflag;
+  image->oflag = attributes.c_oflag;
+  image->cflag = attributes.c_cflag;
+  image->lflag = attributes.c_lflag;
+  image->speed = cfgetospeed(&attributes);
+  memcpy(image->cc, attributes.c_cc,
+         sizeof(attributes.c_cc) < sizeof(image->cc) ? sizeof(attributes.c_cc) : sizeof(image->cc));
+  return 0;
 #endif
+}
 
-// On OS X, starting with Tiger, we can set a custom baud rate with ioctl
-#if defined(MAC_OS_X_VERSION_10_4) &&                                          \
-    (MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_4)
-  if (-1 == baudRate) {
-    speed_t speed = data->baudRate;
-    if (-1 == ioctl(fd, IOSSIOSPEED, &speed)) {
-      snprintf(data->errorString, sizeof(data->errorString),
-               "Error: %s calling ioctl(.., IOSSIOSPEED, %ld )",
-               strerror(errno), speed);
-      return -1;
-    } else {
-      tcflush(fd, TCIOFLUSH);
-      return 1;
-    }
+// applies the image unless it equals the attributes last written to the port
+static int updateTermios(int fd, const TermiosImage *image, AsyncError *error) {
+  PortShadow shadow = readShadow(fd);
+  if (shadow.termiosValid && 0 == memcmp(&shadow.termios, image, sizeof(TermiosImage))) {
+    return 1;
   }
-#endif
-
-  if (-1 == baudRate) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error baud rate of %d is not supported on your platform",
-             data->baudRate);
+  if (-1 == applyTermios(fd, image, error)) {
+    // the attributes may have been changed partially
+    writeShadowTermios(fd, NULL);
     return -1;
   }
-
-  // If we have a good baud rate set it and lets go
-  cfsetospeed(&options, baudRate);
-  cfsetispeed(&options, baudRate);
-  // throw away all the buffered data
-  tcflush(fd, TCIOFLUSH);
-  // make the changes now
-  tcsetattr(fd, TCSANOW, &options);
+  writeShadowTermios(fd, image);
   return 1;
 }
 
-void EIO_Update(uv_work_t *req) {
-  ConnectionOptionsBaton *data =
-      static_cast<ConnectionOptionsBaton *>(req->data);
-  setBaudRate(data);
-}
-
-int setup(int fd, OpenBaton *data) {
-  int dataBits = ToDataBitsConstant(data->dataBits);
-  if (-1 == dataBits) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Invalid data bits setting %d", data->dataBits);
+int setBaudRate(int fd, int customBaudRate, AsyncError *error) {
+  // the attributes are read from the port only if they are not known yet
+  PortShadow shadow = readShadow(fd);
+  TermiosImage image = shadow.termios;
+  if (!shadow.termiosValid && -1 == readTermios(fd, &image)) {
+    error->set(errno, "Cannot set baud rate of %d", customBaudRate);
     return -1;
   }
-
-  // Snow Leopard doesn't have O_CLOEXEC
-  if (-1 == fcntl(fd, F_SETFD, FD_CLOEXEC)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error %s Cannot open %s", strerror(errno), data->path);
+  if (-1 == setTermiosSpeed(&image, customBaudRate, error)) {
     return -1;
   }
+  return updateTermios(fd, &image, error);
+}
 
-  // Get port configuration for modification
-  struct termios options;
-  tcgetattr(fd, &options);
-
-  // IGNPAR: ignore bytes with parity errors
-  options.c_iflag = IGNPAR;
-
-  // ICRNL: map CR to NL (otherwise a CR input on the other computer will not
-  // terminate input) Future potential option options.c_iflag = ICRNL; otherwise
-  // make device raw (no other input processing)
-
-  // Specify data bits
-  options.c_cflag &= ~CSIZE;
-  options.c_cflag |= dataBits;
-
-  options.c_cflag &= ~(CRTSCTS);
+void EIO_Update(ConnectionOptionsBaton *data, AsyncError *error) {
+  // buffered data is kept, the caller flushes the port if it was transferred with the old settings
+  if (data->prepared) {
+    updateTermios(data->fd, &data->options.termios, error);
+  } else {
+    setBaudRate(data->fd, data->baudRate, error);
+  }
+}
 
-  if (data->rtscts) {
-    options.c_cflag |= CRTSCTS;
-    // evaluate specific flow control options
+int preparePortOptions(PortOptions *options, AsyncError *error) {
+  if (options->dataBits < 5 || options->dataBits > 8) {
+    error->set(0, "Invalid data bits setting %d", options->dataBits);
+    return -1;
   }
 
-  options.c_iflag &= ~(IXON | IXOFF | IXANY);
+  struct termios attributes;
+  memset(&attributes, 0, sizeof(attributes));
 
-  if (data->xon) {
-    options.c_iflag |= IXON;
+  // IGNPAR: ignore bytes with parity errors, no other input processing
+  attributes.c_iflag = IGNPAR;
+  if (options->xon) {
+    attributes.c_iflag |= IXON;
   }
-
-  if (data->xoff) {
-    options.c_iflag |= IXOFF;
+  if (options->xoff) {
+    attributes.c_iflag |= IXOFF;
+  }
+  if (options->xany) {
+    attributes.c_iflag |= IXANY;
   }
 
-  if (data->xany) {
-    options.c_iflag |= IXANY;
+  // CLOCAL: ignore status lines, CREAD: enable receiver
+  attributes.c_cflag = ToDataBitsConstant(options->dataBits) | CLOCAL | CREAD;
+  if (options->rtscts) {
+    attributes.c_cflag |= CRTSCTS;
   }
 
-  switch (data->parity) {
+  switch (options->parity) {
   case SERIALPORT_PARITY_NONE:
-    options.c_cflag &= ~PARENB;
-    // options.c_cflag &= ~CSTOPB;
-    // options.c_cflag &= ~CSIZE;
-    // options.c_cflag |= CS8;
     break;
   case SERIALPORT_PARITY_ODD:
-    options.c_cflag |= PARENB;
-    options.c_cflag |= PARODD;
-    // options.c_cflag &= ~CSTOPB;
-    // options.c_cflag &= ~CSIZE;
-    // options.c_cflag |= CS7;
+    attributes.c_cflag |= PARENB | PARODD;
     break;
   case SERIALPORT_PARITY_EVEN:
-    options.c_cflag |= PARENB;
-    options.c_cflag &= ~PARODD;
-    // options.c_cflag &= ~CSTOPB;
-    // options.c_cflag &= ~CSIZE;
-    // options.c_cflag |= CS7;
+    attributes.c_cflag |= PARENB;
     break;
   default:
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Invalid parity setting %d", data->parity);
+    error->set(0, "Invalid parity setting %d", options->parity);
     return -1;
   }
 
-  switch (data->stopBits) {
+  switch (options->stopBits) {
   case SERIALPORT_STOPBITS_ONE:
-    options.c_cflag &= ~CSTOPB;
     break;
   case SERIALPORT_STOPBITS_TWO:
-    options.c_cflag |= CSTOPB;
+    attributes.c_cflag |= CSTOPB;
     break;
   default:
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Invalid stop bits setting %d", data->stopBits);
+    error->set(0, "Invalid stop bits setting %d", options->stopBits);
     return -1;
   }
 
-  options.c_cflag |= CLOCAL; // ignore status lines
-  options.c_cflag |= CREAD;  // enable receiver
-  if (data->hupcl) {
-    options.c_cflag |= HUPCL; // drop DTR (i.e. hangup) on close
+  if (options->hupcl) {
+    attributes.c_cflag |= HUPCL; // drop DTR (i.e. hangup) on close
   }
 
-  // Raw output
-  options.c_oflag = 0;
-
-  // ICANON makes partial lines not readable. It should be optional.
-  // It works with ICRNL.
-  options.c_lflag = 0; // ICANON;
-  options.c_cc[VMIN] = data->vmin;
-  options.c_cc[VTIME] = data->vtime;
+  // raw output, ICANON would make partial lines not readable
+  attributes.c_oflag = 0;
+  attributes.c_lflag = 0;
+  attributes.c_cc[VSTART] = 0x11;
+  attributes.c_cc[VSTOP] = 0x13;
+  attributes.c_cc[VMIN] = options->vmin;
+  attributes.c_cc[VTIME] = options->vtime;
+
+  // the speed is kept apart from the control flags, see TermiosImage
+  TermiosImage *image = &options->termios;
+  memset(image, 0, sizeof(*image));
+  image->iflag = attributes.c_iflag;
+  image->oflag = attributes.c_oflag;
+  image->cflag = attributes.c_cflag;
+  image->lflag = attributes.c_lflag;
+  memcpy(image->cc, attributes.c_cc,
+         sizeof(attributes.c_cc) < sizeof(image->cc) ? sizeof(attributes.c_cc) : sizeof(image->cc));
+  return setTermiosSpeed(image, options->baudRate, error);
+}
 
-  // Note that tcsetattr() returns success if any of the requested changes could
-  // be successfully carried out. Therefore, when making multiple changes it may
-  // be necessary to follow this call with a further call to tcgetattr() to
-  // check that all changes have been performed successfully. This also fails on
-  // OSX
-  tcsetattr(fd, TCSANOW, &options);
+// sets all terminal attributes of the image, on linux with a single ioctl
+int applyTermios(int fd, const TermiosImage *image, AsyncError *error) {
+#if defined(__linux__)
+  if (-1 == linuxApplyTermios(fd, image)) {
+    error->set(errno, "Cannot set terminal attributes");
+    return -1;
+  }
+#else
+  struct termios attributes;
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.c_iflag = image->iflag;
+  attributes.c_oflag = image->oflag;
+  attributes.c_cflag = image->cflag;
+  attributes.c_lflag = image->lflag;
+  memcpy(attributes.c_cc, image->cc,
+         sizeof(attributes.c_cc) < sizeof(image->cc) ? sizeof(attributes.c_cc) : sizeof(image->cc));
+  cfsetospeed(&attributes, image->speed);
+  cfsetispeed(&attributes, image->speed);
+  if (-1 == tcsetattr(fd, TCSANOW, &attributes)) {
+    error->set(errno, "Cannot set terminal attributes");
+    return -1;
+  }
+#endif
 
-  if (data->lock) {
-    if (-1 == flock(fd, LOCK_EX | LOCK_NB)) {
-      snprintf(data->errorString, sizeof(data->errorString),
-               "Error %s Cannot lock port", strerror(errno));
+// On OS X, starting with Tiger, the custom baud rate is set with ioctl
+#if defined(MAC_OS_X_VERSION_10_4) &&                                          \
+    (MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_4)
+  if (image->customSpeed) {
+    speed_t speed = image->customSpeed;
+    if (-1 == ioctl(fd, IOSSIOSPEED, &speed)) {
+      error->set(errno, "Calling ioctl(.., IOSSIOSPEED, %d)", static_cast<int>(image->customSpeed));
       return -1;
     }
   }
+#endif
+  return 1;
+}
 
-  // Copy the connection options into the ConnectionOptionsBaton to set the baud
-  // rate
-  ConnectionOptionsBaton *connectionOptions = new ConnectionOptionsBaton();
-  connectionOptions->fd = fd;
-  connectionOptions->baudRate = data->baudRate;
+int setup(int fd, OpenBaton *data, AsyncError *error) {
+  // Snow Leopard doesn't have O_CLOEXEC
+  if (-1 == fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+    error->set(errno, "Cannot open %s", data->path);
+    return -1;
+  }
 
-  if (-1 == setBaudRate(connectionOptions)) {
-    strncpy(data->errorString, connectionOptions->errorString,
-            sizeof(data->errorString));
-    delete (connectionOptions);
+  // the number may belong to a port closed without the bindings
+  dropShadow(fd);
+  // the attributes were computed when the options were prepared
+  if (-1 == updateTermios(fd, &data->termios, error)) {
     return -1;
   }
-  delete (connectionOptions);
 
-  // flush all unread and wrote data up to this point because it could have been
-  // received or sent with bad settings Not needed since setBaudRate does this
-  // for us tcflush(fd, TCIOFLUSH);
+  if (data->lock) {
+    if (-1 == flock(fd, LOCK_EX | LOCK_NB)) {
+      error->set(errno, "Cannot lock port");
+      return -1;
+    }
+  }
+
+  // flush all unread and written data up to this point because it could have been
+  // received or sent with bad settings
+  tcflush(fd, TCIOFLUSH);
 
   return 1;
 }
 
-void EIO_Close(uv_work_t *req) {
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
+void EIO_Close(VoidBaton *data, AsyncError *error) {
 #ifdef __APPLE__
   // update baud rate before closing to exit bootloader mode (needed only for
   // OSX for some reason) ignore all possible errors and close the port anyway
@@ -365,63 +426,71 @@ void EIO_Close(uv_work_t *req) {
   tcsetattr(data->fd, TCSANOW, &options);
 #endif
 
+  dropShadow(data->fd);
   if (-1 == close(data->fd)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, unable to close fd %d", strerror(errno), data->fd);
+    error->set(errno, "Unable to close fd %d", data->fd);
   }
 }
 
-void EIO_Set(uv_work_t *req) {
-  SetBaton *data = static_cast<SetBaton *>(req->data);
+void EIO_Set(SetBaton *data, AsyncError *error) {
+  PortShadow shadow = readShadow(data->fd);
 
-  int bits;
-  ioctl(data->fd, TIOCMGET, &bits);
+  if (!shadow.brkValid || shadow.brk != data->brk) {
+    int result = 0;
+    if (data->brk) {
+      result = ioctl(data->fd, TIOCSBRK, NULL);
+    } else {
+      result = ioctl(data->fd, TIOCCBRK, NULL);
+    }
+
+    if (-1 == result) {
+      writeShadowBreak(data->fd, false, false);
+      error->set(errno, "Cannot set");
+      return;
+    }
+    writeShadowBreak(data->fd, true, data->brk);
+  }
 
-  bits &= ~(TIOCM_RTS | TIOCM_CTS | TIOCM_DTR | TIOCM_DSR);
+  // the lines are read from the port only if they are not known yet
+  int bits = shadow.modemBits;
+  if (!shadow.modemValid && -1 == ioctl(data->fd, TIOCMGET, &bits)) {
+    error->set(errno, "Cannot set");
+    return;
+  }
+
+  int requested = bits & ~(TIOCM_RTS | TIOCM_CTS | TIOCM_DTR | TIOCM_DSR);
 
   if (data->rts) {
-    bits |= TIOCM_RTS;
+    requested |= TIOCM_RTS;
   }
 
   if (data->cts) {
-    bits |= TIOCM_CTS;
+    requested |= TIOCM_CTS;
   }
 
   if (data->dtr) {
-    bits |= TIOCM_DTR;
+    requested |= TIOCM_DTR;
   }
 
   if (data->dsr) {
-    bits |= TIOCM_DSR;
-  }
-
-  int result = 0;
-  if (data->brk) {
-    result = ioctl(data->fd, TIOCSBRK, NULL);
-  } else {
-    result = ioctl(data->fd, TIOCCBRK, NULL);
-  }
-
-  if (-1 == result) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, cannot set", strerror(errno));
-    return;
+    requested |= TIOCM_DSR;
   }
 
-  if (-1 == ioctl(data->fd, TIOCMSET, &bits)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, cannot set", strerror(errno));
-    return;
+  // CTS and DSR are inputs, only a change of the outputs needs to be written
+  if ((requested ^ bits) & (TIOCM_RTS | TIOCM_DTR)) {
+    if (-1 == ioctl(data->fd, TIOCMSET, &requested)) {
+      writeShadowModem(data->fd, false, 0);
+      error->set(errno, "Cannot set");
+      return;
+    }
   }
+  writeShadowModem(data->fd, true, requested);
 }
 
-void EIO_Get(uv_work_t *req) {
-  GetBaton *data = static_cast<GetBaton *>(req->data);
-
+void EIO_Get(GetBaton *data, AsyncError *error) {
   int bits;
   if (-1 == ioctl(data->fd, TIOCMGET, &bits)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, cannot get", strerror(errno));
+    error->set(errno, "Cannot get");
     return;
   }
 
@@ -430,14 +499,12 @@ void EIO_Get(uv_work_t *req) {
   data->dcd = bits & TIOCM_CD;
 }
 
-void EIO_GetBaudRate(uv_work_t *req) {
-  GetBaudRateBaton *data = static_cast<GetBaudRateBaton *>(req->data);
-  int outbaud;
+void EIO_GetBaudRate(GetBaudRateBaton *data, AsyncError *error) {
+  int outbaud = 0;
 
 #if defined(__linux__) && defined(ASYNC_SPD_CUST)
   if (-1 == linuxGetSystemBaudRate(data->fd, &outbaud)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, cannot get baud rate", strerror(errno));
+    error->set(errno, "Cannot get baud rate");
     return;
   }
 #endif
@@ -445,30 +512,23 @@ void EIO_GetBaudRate(uv_work_t *req) {
 // TODO(Fumon) implement on mac
 #if defined(MAC_OS_X_VERSION_10_4) &&                                          \
     (MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_4)
-  snprintf(data->errorString, sizeof(data->errorString),
-           "Error: System baud rate check not implemented on darwin");
+  error->set(0, "System baud rate check not implemented on darwin");
   return;
 #endif
 
   data->baudRate = outbaud;
 }
 
-void EIO_Flush(uv_work_t *req) {
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
+void EIO_Flush(VoidBaton *data, AsyncError *error) {
   if (-1 == tcflush(data->fd, TCIOFLUSH)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, cannot flush", strerror(errno));
+    error->set(errno, "Cannot flush");
     return;
   }
 }
 
-void EIO_Drain(uv_work_t *req) {
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
+void EIO_Drain(VoidBaton *data, AsyncError *error) {
   if (-1 == tcdrain(data->fd)) {
-    snprintf(data->errorString, sizeof(data->errorString),
-             "Error: %s, cannot drain", strerror(errno));
+    error->set(errno, "Cannot drain");
     return;
   }
 }
@@ -5,4 +5,23 @@ int ToBaudConstant(int baudRate);
 
 int ToDataBitsConstant(int dataBits);
 
+#define TERMIOS_IMAGE_CC_SIZE 32
+
+/*
+ * Terminal attributes computed from the port options, kept free of <termios.h> types so the image can
+ * also be applied through the Linux termios2 interface. The speed is not part of cflag, images are
+ * compared bytewise to skip unchanged updates.
+ */
+struct TermiosImage {
+  unsigned int iflag;
+  unsigned int oflag;
+  unsigned int cflag;
+  unsigned int lflag;
+  unsigned char cc[TERMIOS_IMAGE_CC_SIZE];
+  // Bxxx constant of the baud rate
+  unsigned int speed;
+  // baud rate without a Bxxx constant, 0 for standard rates
+  unsigned int customSpeed;
+};
+
 #endif // SRC_SERIALPORT_UNIX_H_
@@ -24,150 +24,157 @@ typedef BOOL(WINAPI *CancelIoExType)(HANDLE hFile, LPOVERLAPPED lpOverlapped);
 
 std::list<int> g_closingHandles;
 
-void ErrorCodeToString(const char *prefix, int errorCode, char *errorStr) {
-  switch (errorCode) {
+void formatSystemError(int code, char *message, size_t size) {
+  switch (code) {
   case ERROR_FILE_NOT_FOUND:
-    _snprintf_s(errorStr, ERROR_STRING_SIZE, _TRUNCATE, "%s: File not found",
-                prefix);
+    _snprintf_s(message, size, _TRUNCATE, "File not found");
     break;
   case ERROR_INVALID_HANDLE:
-    _snprintf_s(errorStr, ERROR_STRING_SIZE, _TRUNCATE, "%s: Invalid handle",
-                prefix);
+    _snprintf_s(message, size, _TRUNCATE, "Invalid handle");
     break;
   case ERROR_ACCESS_DENIED:
-    _snprintf_s(errorStr, ERROR_STRING_SIZE, _TRUNCATE, "%s: Access denied",
-                prefix);
+    _snprintf_s(message, size, _TRUNCATE, "Access denied");
     break;
   case ERROR_OPERATION_ABORTED:
-    _snprintf_s(errorStr, ERROR_STRING_SIZE, _TRUNCATE, "%s: Operation aborted",
-                prefix);
+    _snprintf_s(message, size, _TRUNCATE, "Operation aborted");
     break;
   case ERROR_INVALID_PARAMETER:
-    _snprintf_s(errorStr, ERROR_STRING_SIZE, _TRUNCATE,
-                "%s: The parameter is incorrect", prefix);
+    _snprintf_s(message, size, _TRUNCATE, "The parameter is incorrect");
     break;
   default:
-    _snprintf_s(errorStr, ERROR_STRING_SIZE, _TRUNCATE,
-                "%s: Unknown error code %d", prefix, errorCode);
+    _snprintf_s(message, size, _TRUNCATE, "Unknown error code %d", code);
     break;
   }
 }
 
+void ErrorCodeToString(const char *prefix, int errorCode, char *errorStr) {
+  AsyncError error;
+  error.set(errorCode, "%s", prefix);
+  error.format(errorStr, ERROR_STRING_SIZE);
+}
+
 void AsyncCloseCallback(uv_handle_t *handle) {
   uv_async_t *async = reinterpret_cast<uv_async_t *>(handle);
   delete async;
 }
 
-void EIO_Open(uv_work_t *req) {
-  OpenBaton *data = static_cast<OpenBaton *>(req->data);
-
-  char originalPath[1024];
-  strncpy_s(originalPath, sizeof(originalPath), data->path, _TRUNCATE);
-  // data->path is char[1024] but on Windows it has the form "COMx\0" or
-  // "COMxx\0" We want to prepend "\\\\.\\" to it before we call CreateFile
-  strncpy(data->path + 20, data->path, 10);
-  strncpy(data->path, "\\\\.\\", 4);
-  strncpy(data->path + 4, data->path + 20, 10);
-
-  int shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE;
-  if (data->lock) {
-    shareMode = 0;
-  }
-
-  HANDLE file = CreateFile(
-      data->path, GENERIC_READ | GENERIC_WRITE,
-      shareMode, // dwShareMode 0 Prevents other processes from opening if they
-                 // request delete, read, or write access
-      NULL, OPEN_EXISTING,
-      FILE_FLAG_OVERLAPPED, // allows for reading and writing at the same time
-                            // and sets the handle for asynchronous I/O
-      NULL);
-
-  if (file == INVALID_HANDLE_VALUE) {
-    DWORD errorCode = GetLastError();
-    char temp[100];
-    _snprintf_s(temp, sizeof(temp), _TRUNCATE, "Opening %s", originalPath);
-    ErrorCodeToString(temp, errorCode, data->errorString);
-    return;
-  }
-
-  DCB dcb = {0};
-  SecureZeroMemory(&dcb, sizeof(DCB));
-  dcb.DCBlength = sizeof(DCB);
-
-  if (!GetCommState(file, &dcb)) {
-    ErrorCodeToString("Open (GetCommState)", GetLastError(), data->errorString);
-    CloseHandle(file);
-    return;
+int preparePortOptions(PortOptions *options, AsyncError *error) {
+  // there are no terminal attributes on Windows, the DCB is filled from the options when they are applied
+  if (options->dataBits < 5 || options->dataBits > 8) {
+    error->set(0, "Invalid data bits setting %d", options->dataBits);
+    return -1;
   }
+  return 0;
+}
 
-  if (data->hupcl) {
-    dcb.fDtrControl = DTR_CONTROL_ENABLE;
+static void configureDcb(DCB *dcb, const PortOptions *options) {
+  if (options->hupcl) {
+    dcb->fDtrControl = DTR_CONTROL_ENABLE;
   } else {
-    dcb.fDtrControl = DTR_CONTROL_DISABLE; // disable DTR to avoid reset
+    dcb->fDtrControl = DTR_CONTROL_DISABLE; // disable DTR to avoid reset
   }
 
-  dcb.Parity = NOPARITY;
-  dcb.ByteSize = 8;
-  dcb.StopBits = ONESTOPBIT;
+  dcb->Parity = NOPARITY;
+  dcb->ByteSize = 8;
+  dcb->StopBits = ONESTOPBIT;
 
-  dcb.fOutxDsrFlow = FALSE;
-  dcb.fOutxCtsFlow = FALSE;
+  dcb->fOutxDsrFlow = FALSE;
+  dcb->fOutxCtsFlow = FALSE;
 
-  if (data->xon) {
-    dcb.fOutX = TRUE;
+  if (options->xon) {
+    dcb->fOutX = TRUE;
   } else {
-    dcb.fOutX = FALSE;
+    dcb->fOutX = FALSE;
   }
 
-  if (data->xoff) {
-    dcb.fInX = TRUE;
+  if (options->xoff) {
+    dcb->fInX = TRUE;
   } else {
-    dcb.fInX = FALSE;
+    dcb->fInX = FALSE;
   }
 
-  if (data->rtscts) {
-    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+  if (options->rtscts) {
+    dcb->fRtsControl = RTS_CONTROL_ENABLE;
   } else {
-    dcb.fRtsControl = RTS_CONTROL_DISABLE;
+    dcb->fRtsControl = RTS_CONTROL_DISABLE;
   }
 
-  dcb.fBinary = true;
-  dcb.BaudRate = data->baudRate;
-  dcb.ByteSize = data->dataBits;
+  dcb->fBinary = true;
+  dcb->BaudRate = options->baudRate;
+  dcb->ByteSize = options->dataBits;
 
-  switch (data->parity) {
+  switch (options->parity) {
   case SERIALPORT_PARITY_NONE:
-    dcb.Parity = NOPARITY;
+    dcb->Parity = NOPARITY;
     break;
   case SERIALPORT_PARITY_MARK:
-    dcb.Parity = MARKPARITY;
+    dcb->Parity = MARKPARITY;
     break;
   case SERIALPORT_PARITY_EVEN:
-    dcb.Parity = EVENPARITY;
+    dcb->Parity = EVENPARITY;
     break;
   case SERIALPORT_PARITY_ODD:
-    dcb.Parity = ODDPARITY;
+    dcb->Parity = ODDPARITY;
     break;
   case SERIALPORT_PARITY_SPACE:
-    dcb.Parity = SPACEPARITY;
+    dcb->Parity = SPACEPARITY;
     break;
   }
 
-  switch (data->stopBits) {
+  switch (options->stopBits) {
   case SERIALPORT_STOPBITS_ONE:
-    dcb.StopBits = ONESTOPBIT;
+    dcb->StopBits = ONESTOPBIT;
     break;
   case SERIALPORT_STOPBITS_ONE_FIVE:
-    dcb.StopBits = ONE5STOPBITS;
+    dcb->StopBits = ONE5STOPBITS;
     break;
   case SERIALPORT_STOPBITS_TWO:
-    dcb.StopBits = TWOSTOPBITS;
+    dcb->StopBits = TWOSTOPBITS;
     break;
   }
+}
+
+void EIO_Open(OpenBaton *data, AsyncError *error) {
+  // data->path is char[1024] but on Windows it has the form "COMx\0" or
+  // "COMxx\0" We want to prepend "\\\\.\\" to it before we call CreateFile
+  strncpy(data->path + 20, data->path, 10);
+  strncpy(data->path, "\\\\.\\", 4);
+  strncpy(data->path + 4, data->path + 20, 10);
+
+  int shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE;
+  if (data->lock) {
+    shareMode = 0;
+  }
+
+  HANDLE file = CreateFile(
+      data->path, GENERIC_READ | GENERIC_WRITE,
+      shareMode, // dwShareMode 0 Prevents other processes from opening if they
+                 // request delete, read, or write access
+      NULL, OPEN_EXISTING,
+      FILE_FLAG_OVERLAPPED, // allows for reading and writing at the same time
+                            // and sets the handle for asynchronous I/O
+      NULL);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    // the original port name follows the prefix
+    error->set(GetLastError(), "Opening %s", data->path + 4);
+    return;
+  }
+
+  DCB dcb = {0};
+  SecureZeroMemory(&dcb, sizeof(DCB));
+  dcb.DCBlength = sizeof(DCB);
+
+  if (!GetCommState(file, &dcb)) {
+    error->set(GetLastError(), "Open (GetCommState)");
+    CloseHandle(file);
+    return;
+  }
+
+  configureDcb(&dcb, data);
 
   if (!SetCommState(file, &dcb)) {
-    ErrorCodeToString("Open (SetCommState)", GetLastError(), data->errorString);
+    error->set(GetLastError(), "Open (SetCommState)");
     CloseHandle(file);
     return;
   }
@@ -185,8 +192,7 @@ void EIO_Open(uv_work_t *req) {
       0; // Variable part of write timeout (per byte)
 
   if (!SetCommTimeouts(file, &commTimeouts)) {
-    ErrorCodeToString("Open (SetCommTimeouts)", GetLastError(),
-                      data->errorString);
+    error->set(GetLastError(), "Open (SetCommTimeouts)");
     CloseHandle(file);
     return;
   }
@@ -198,32 +204,29 @@ void EIO_Open(uv_work_t *req) {
   data->result = (int)file; // NOLINT
 }
 
-void EIO_Update(uv_work_t *req) {
-  ConnectionOptionsBaton *data =
-      static_cast<ConnectionOptionsBaton *>(req->data);
-
+void EIO_Update(ConnectionOptionsBaton *data, AsyncError *error) {
   DCB dcb = {0};
   SecureZeroMemory(&dcb, sizeof(DCB));
   dcb.DCBlength = sizeof(DCB);
 
   if (!GetCommState((HANDLE)data->fd, &dcb)) {
-    ErrorCodeToString("Update (GetCommState)", GetLastError(),
-                      data->errorString);
+    error->set(GetLastError(), "Update (GetCommState)");
     return;
   }
 
-  dcb.BaudRate = data->baudRate;
+  if (data->prepared) {
+    configureDcb(&dcb, &data->options);
+  } else {
+    dcb.BaudRate = data->baudRate;
+  }
 
   if (!SetCommState((HANDLE)data->fd, &dcb)) {
-    ErrorCodeToString("Update (SetCommState)", GetLastError(),
-                      data->errorString);
+    error->set(GetLastError(), "Update (SetCommState)");
     return;
   }
 }
 
-void EIO_Set(uv_work_t *req) {
-  SetBaton *data = static_cast<SetBaton *>(req->data);
-
+void EIO_Set(SetBaton *data, AsyncError *error) {
   if (data->rts) {
     EscapeCommFunction((HANDLE)data->fd, SETRTS);
   } else {
@@ -257,20 +260,16 @@ void EIO_Set(uv_work_t *req) {
   }
 
   if (!SetCommMask((HANDLE)data->fd, bits)) {
-    ErrorCodeToString("Setting options on COM port (SetCommMask)",
-                      GetLastError(), data->errorString);
+    error->set(GetLastError(), "Setting options on COM port (SetCommMask)");
     return;
   }
 }
 
-void EIO_Get(uv_work_t *req) {
-  GetBaton *data = static_cast<GetBaton *>(req->data);
-
+void EIO_Get(GetBaton *data, AsyncError *error) {
   DWORD bits = 0;
   if (!GetCommModemStatus((HANDLE)data->fd, &bits)) {
-    ErrorCodeToString(
-        "Getting control settings on COM port (GetCommModemStatus)",
-        GetLastError(), data->errorString);
+    error->set(GetLastError(),
+               "Getting control settings on COM port (GetCommModemStatus)");
     return;
   }
 
@@ -279,16 +278,13 @@ void EIO_Get(uv_work_t *req) {
   data->dcd = bits & MS_RLSD_ON;
 }
 
-void EIO_GetBaudRate(uv_work_t *req) {
-  GetBaudRateBaton *data = static_cast<GetBaudRateBaton *>(req->data);
-
+void EIO_GetBaudRate(GetBaudRateBaton *data, AsyncError *error) {
   DCB dcb = {0};
   SecureZeroMemory(&dcb, sizeof(DCB));
   dcb.DCBlength = sizeof(DCB);
 
   if (!GetCommState((HANDLE)data->fd, &dcb)) {
-    ErrorCodeToString("Getting baud rate (GetCommState)", GetLastError(),
-                      data->errorString);
+    error->set(GetLastError(), "Getting baud rate (GetCommState)");
     return;
   }
 
@@ -616,9 +612,7 @@ void EIO_AfterRead(uv_async_t *req) {
   delete baton;
 }
 
-void EIO_Close(uv_work_t *req) {
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
+void EIO_Close(VoidBaton *data, AsyncError *error) {
   g_closingHandles.push_back(data->fd);
 
   HMODULE hKernel32 = LoadLibrary("kernel32.dll");
@@ -637,21 +631,18 @@ void EIO_Close(uv_work_t *req) {
     dcb.DCBlength = sizeof(DCB);
 
     if (!GetCommState((HANDLE)data->fd, &dcb)) {
-      ErrorCodeToString(
-        "Close (GetCommState)", GetLastError(), data->errorString);
+      error->set(GetLastError(), "Close (GetCommState)");
       return;
     }
 
     dcb.BaudRate = 9600;
 
     if (!SetCommState((HANDLE)data->fd, &dcb)) {
-      ErrorCodeToString(
-        "Close (SetCommState)", GetLastError(), data->errorString);
+      error->set(GetLastError(), "Close (SetCommState)");
       return;
     }*/
   if (!CloseHandle((HANDLE)data->fd)) {
-    ErrorCodeToString("Closing connection (CloseHandle)", GetLastError(),
-                      data->errorString);
+    error->set(GetLastError(), "Closing connection (CloseHandle)");
     return;
   }
 }
@@ -785,24 +776,18 @@ void EIO_AfterList(uv_work_t *req) {
   delete req;
 }
 
-void EIO_Flush(uv_work_t *req) {
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
+void EIO_Flush(VoidBaton *data, AsyncError *error) {
   DWORD purge_all =
       PURGE_RXABORT | PURGE_RXCLEAR | PURGE_TXABORT | PURGE_TXCLEAR;
   if (!PurgeComm((HANDLE)data->fd, purge_all)) {
-    ErrorCodeToString("Flushing connection (PurgeComm)", GetLastError(),
-                      data->errorString);
+    error->set(GetLastError(), "Flushing connection (PurgeComm)");
     return;
   }
 }
 
-void EIO_Drain(uv_work_t *req) {
-  VoidBaton *data = static_cast<VoidBaton *>(req->data);
-
+void EIO_Drain(VoidBaton *data, AsyncError *error) {
   if (!FlushFileBuffers((HANDLE)data->fd)) {
-    ErrorCodeToString("Draining connection (FlushFileBuffers)", GetLastError(),
-                      data->errorString);
+    error->set(GetLastError(), "Draining connection (FlushFileBuffers)");
     return;
   }
 }
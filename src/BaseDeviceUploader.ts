@@ -1,7 +1,9 @@
 'use strict';
 // tslint:disable: no-console no-bitwise no-unused-expression
 
-import { IDevice, IDevUploader, ISerialPort, ISerialPortFactory, ISerialPortInfo } from './Common';
+import { performance } from 'perf_hooks';
+import { IDevice, IDevUploader, ISerialPort, ISerialPortFactory, ISerialPortInfo, IUploadRecorder } from './Common';
+import { PAGE_SIZE } from './ImageCache';
 
 const DEBUG = false;
 
@@ -18,6 +20,7 @@ export enum CMD {
 }
 
 export abstract class BaseDeviceUploader implements IDevUploader {
+    public recorder?: IUploadRecorder;
     protected portFactory: ISerialPortFactory;
     protected deviceInfo: IDevice;
     protected portInfo: ISerialPortInfo;
@@ -66,29 +69,38 @@ export abstract class BaseDeviceUploader implements IDevUploader {
         });
     }
 
-    public sendData(data: Uint8Array): Promise<void> {
+    /**
+     * Writes the image to the device in pages of 256 bytes
+     * @param data - image to write
+     * @param pages - indexes of the pages to write, all pages if not provided
+     */
+    public sendData(data: Uint8Array, pages?: number[]): Promise<void> {
         return new Promise(async (resolve, reject) => {
-            const nrPackets = Math.trunc((data.length + 255) / 256);
+            const nrPackets = Math.trunc((data.length + PAGE_SIZE - 1) / PAGE_SIZE);
+            const indexes = pages || Array.from({ length: nrPackets }, (value, index) => index);
 
-            DEBUG && console.log('[UPLOAD] Sending total', nrPackets, 'packets');
+            DEBUG && console.log('[UPLOAD] Sending', indexes.length, 'of total', nrPackets, 'packets');
 
             const packet = {
                 cmd: CMD.CMD_WRITE,
-                data: new Uint8Array(256 + 4)
+                data: new Uint8Array(PAGE_SIZE + 4)
             };
 
-            for (let index = 0; index < nrPackets; index++) {
-                const offset = index * 256;
+            for (const index of indexes) {
+                const offset = index * PAGE_SIZE;
                 const dv = new DataView(packet.data.buffer);
-                dv.setUint32(0, index * 256, true);
-                packet.data.set(data.slice(offset, offset + 256), 4);
+                dv.setUint32(0, offset, true);
+                packet.data.set(data.slice(offset, offset + PAGE_SIZE), 4);
 
                 DEBUG && console.log('[UPLOAD] Sending packet', index);
+                const start = performance.now();
                 try {
                     await this.sendPacket(packet);
                 } catch (error) {
                     reject(error);
+                    return;
                 }
+                this.recorder && this.recorder.record('packet', start, Math.min(PAGE_SIZE, data.length - offset));
                 DEBUG && console.log('[UPLOAD] Sent packet', index);
             }
 
@@ -101,16 +113,21 @@ export abstract class BaseDeviceUploader implements IDevUploader {
             DEBUG && console.log('[UPLOAD] sendPacket');
 
             const data = this.createPacketData(packet, this.seqNr);
+            let start = performance.now();
 
             this.write(data)
                 .then(() => {
                     DEBUG && console.log('[UPLOAD] sendPacket. Data written, reading response');
+                    this.recorder && this.recorder.record('write', start, data.length);
+                    start = performance.now();
                     return this.read();
                 })
                 .then((response: Uint8Array) => {
                     let dv;
                     let crc = 0;
 
+                    this.recorder && this.recorder.record('ack', start);
+
                     DEBUG && console.log('[UPLOAD] sendPacket. Got response');
                     dv = new DataView(response.buffer);
 
@@ -0,0 +1,182 @@
+'use strict';
+// tslint:disable: no-bitwise
+
+/**
+ * Tokens of the LED Basic code image as generated by the code tokenizer
+ */
+export enum TOKEN {
+    END = 0x83,
+    VALUE = 0x88,
+    STRING = 0x89,
+    VAR = 0x8A,
+    ASSIGN = 0x8B,
+    PRINT = 0x8C,
+    IF = 0x8D,
+    THEN = 0x8E,
+    ELSE = 0x8F,
+    FOR = 0x90,
+    TO = 0x91,
+    DOWNTO = 0x92,
+    STEP = 0x93,
+    NEXT = 0x94,
+    GOTO = 0x95,
+    GOSUB = 0x96,
+    RETURN = 0x97,
+    DELAY = 0x98,
+    COMMA = 0x99,
+    SEMICOLON = 0x9A,
+    PAREN_OPEN = 0x9B,
+    PAREN_CLOSE = 0x9C,
+    ADD = 0x9D,
+    SUB = 0x9E,
+    BAND = 0x9F,
+    BOR = 0xA0,
+    MUL = 0xA1,
+    DIV = 0xA2,
+    MOD = 0xA3,
+    LT = 0xA4,
+    GT = 0xA5,
+    EQ = 0xA6,
+    LE = 0xA7,
+    GE = 0xA8,
+    NE = 0xA9,
+    RANDOM = 0xAB,
+    LIB_LED = 0xAC,
+    LIB_IO = 0xAD,
+    DATA = 0xAE,
+    READ = 0xAF,
+    AND = 0xB0,
+    OR = 0xB1,
+    LIB_MATRIX = 0xB4
+}
+
+/**
+ * Kind of an entry in the code image
+ */
+export enum ENTRY {
+    LABEL,
+    LINE,
+    DATA
+}
+
+export interface ICodeEntry {
+    kind: ENTRY;
+    // offset of the entry in the code image
+    offset: number;
+    // total size of the entry in bytes
+    size: number;
+    // label number for labels, source line number otherwise
+    number: number;
+    // range of the token bytes (statement tokens or data values)
+    start: number;
+    end: number;
+}
+
+export interface ICodeToken {
+    token: number;
+    offset: number;
+    size: number;
+}
+
+const END_OF_CODE = 0xFFFF;
+
+/**
+ * Returns the number of operand bytes following the token at the provided offset
+ * @param code - code image
+ * @param offset - offset of the token
+ */
+export function operandSize(code: Uint8Array, offset: number): number {
+    switch (code[offset]) {
+        case TOKEN.VALUE:
+        case TOKEN.GOTO:
+        case TOKEN.GOSUB:
+        case TOKEN.READ:
+            return 2;
+        case TOKEN.STRING:
+            return 1 + code[offset + 1];
+        case TOKEN.VAR:
+        case TOKEN.ASSIGN:
+        case TOKEN.IF:
+        case TOKEN.FOR:
+        case TOKEN.NEXT:
+        case TOKEN.LIB_LED:
+        case TOKEN.LIB_IO:
+        case TOKEN.LIB_MATRIX:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Splits a code image into labels, statement lines and data lines.
+ * @param code - code image without the LBO header
+ */
+export function decodeEntries(code: Uint8Array): ICodeEntry[] {
+    const result: ICodeEntry[] = [];
+    let offset = 0;
+
+    while (offset + 1 < code.length) {
+        const word = code[offset] | (code[offset + 1] << 8);
+        if (word === END_OF_CODE) {
+            break;
+        }
+
+        if (word & 0x8000) {
+            result.push({
+                kind: ENTRY.LABEL,
+                offset,
+                size: 3,
+                number: word - 0x8000,
+                start: offset + 3,
+                end: offset + 3
+            });
+            offset += 3;
+            continue;
+        }
+
+        const length = code[offset + 2];
+        const start = offset + 3;
+        const isData = code[start] === TOKEN.DATA;
+        result.push({
+            kind: isData ? ENTRY.DATA : ENTRY.LINE,
+            offset,
+            size: length + 3,
+            number: word,
+            start: isData ? start + 1 : start,
+            end: start + length
+        });
+        offset += length + 3;
+    }
+
+    return result;
+}
+
+/**
+ * Splits the token bytes of a statement line into single tokens with their operands
+ * @param code - code image
+ * @param entry - statement line entry
+ */
+export function decodeTokens(code: Uint8Array, entry: ICodeEntry): ICodeToken[] {
+    const result: ICodeToken[] = [];
+    let offset = entry.start;
+    while (offset < entry.end) {
+        const size = 1 + operandSize(code, offset);
+        result.push({
+            token: code[offset],
+            offset,
+            size
+        });
+        offset += size;
+    }
+    return result;
+}
+
+/**
+ * Reads the 16 bit operand of a value, goto, gosub or read token
+ * @param code - code image
+ * @param offset - offset of the token
+ */
+export function readOperand(code: Uint8Array, offset: number): number {
+    return code[offset + 1] | (code[offset + 2] << 8);
+}
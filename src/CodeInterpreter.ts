@@ -0,0 +1,974 @@
+'use strict';
+// tslint:disable: no-bitwise
+
+import { decodeEntries, ENTRY, ICodeEntry, readOperand, TOKEN } from './CodeImage';
+import { COLOUR_ORDER, decodeLboHeader, DEFAULT_FRAME_RATE, ICostTable, IDeviceError, ILboHeader, LibMap } from './Common';
+import { callCost, statementCost } from './CostEstimator';
+
+// results of a compiled statement besides the index of the line to continue with
+const END = -1;
+const NEXT_LINE = -2;
+
+const MAX_GOSUB = 4;
+const MAX_FOR = 4;
+const REGISTERS = 10;
+const PRINT_LENGTH = 256;
+// the real-time clock of the interpreter starts at 2000-01-01 00:00:00
+const RTC_EPOCH = Date.UTC(2000, 0, 1);
+
+// error codes reported by the device, see ERROR_MAP in Common.ts
+const ERR_UNKNOWN_TOKEN = 11;
+const ERR_WRONG_ADDRESS = 12;
+const ERR_GOSUB_DEPTH = 13;
+const ERR_RETURN = 14;
+const ERR_ZERO = 15;
+const ERR_FOR_DEPTH = 16;
+const ERR_FOR_RANGE = 17;
+const ERR_NEXT = 18;
+const ERR_LED_VALUE = 19;
+
+type Expression = () => number;
+type Statement = () => number;
+export type LibFunction = (...args: number[]) => number | void;
+
+/**
+ * Runtime error of a program, formatted like the error messages of the device
+ */
+export class InterpreterError extends Error implements IDeviceError {
+    public readonly msg: string;
+
+    constructor(public readonly code: number, public readonly line: number) {
+        super('?ERROR ' + code + ' IN LINE ' + line);
+        this.msg = this.message;
+    }
+}
+
+export interface IInterpreterOptions {
+    // replacements of the IO functions by name, e.g. { getkey: () => 1 }
+    io?: { [name: string]: LibFunction };
+    // execution times of the device, without a cost table only delays and LED.show() take time
+    costs?: ICostTable;
+    // seed of the random number generator
+    seed?: number;
+    // receives the lines of print statements and error messages
+    onPrint?: (text: string) => void;
+    // called after each LED.show() with the updated framebuffer
+    onFrame?: (framebuffer: LedFramebuffer) => void;
+    // receives the execution events for profiling, slows down the execution
+    trace?: IExecutionTrace;
+}
+
+/**
+ * Receiver of execution events. Times are device times in microseconds.
+ */
+export interface IExecutionTrace {
+    // statement line with the index in code order was executed, time includes the waits of the line
+    line(index: number, time: number): void;
+    // library call with the id (token << 8) | function was executed
+    call(id: number, time: number): void;
+    gosub(label: number): void;
+    return(): void;
+    // LED.show() displayed a frame at the provided device time
+    frame(time: number): void;
+}
+
+export interface IRunLimits {
+    // number of executed statement lines
+    maxSteps?: number;
+    // number of displayed frames
+    maxFrames?: number;
+    // device time in microseconds
+    maxTime?: number;
+}
+
+export interface IRunResult {
+    reason: 'end' | 'steps' | 'frames' | 'time' | 'error';
+    error?: InterpreterError;
+    // totals since the start of the program
+    steps: number;
+    frames: number;
+    time: number;
+}
+
+/**
+ * LED colours of a device. The LED commands write RGB(W) values, show() converts them into the colour
+ * order and brightness of the LED stripe.
+ */
+export class LedFramebuffer {
+    // 4 for RGBW LEDs, 3 otherwise
+    public readonly channels: number;
+    // colours set by the program in RGB(W) order
+    public readonly pixels: Uint8Array;
+    // colours sent to the LEDs by the last show() in the configured colour order
+    public readonly output: Uint8Array;
+    // brightness in percent
+    public brightness: number;
+    // colour index registers, RGB order
+    public readonly registers = new Uint8Array(REGISTERS * 3);
+
+    constructor(public readonly ledcnt: number, public readonly colourOrder: COLOUR_ORDER, white: boolean, brightness: number) {
+        this.channels = white ? 4 : 3;
+        this.pixels = new Uint8Array(ledcnt * this.channels);
+        this.output = new Uint8Array(ledcnt * this.channels);
+        this.brightness = brightness;
+    }
+
+    public setRgb(led: number, r: number, g: number, b: number) {
+        const offset = led * this.channels;
+        this.pixels[offset] = r;
+        this.pixels[offset + 1] = g;
+        this.pixels[offset + 2] = b;
+    }
+
+    public copy(from: number, to: number) {
+        this.pixels.copyWithin(to * this.channels, from * this.channels, (from + 1) * this.channels);
+    }
+
+    /**
+     * Returns the colour of a LED as set by the program
+     */
+    public rgb(led: number): number[] {
+        const offset = led * this.channels;
+        return Array.from(this.pixels.subarray(offset, offset + this.channels));
+    }
+
+    public clear() {
+        this.pixels.fill(0);
+    }
+
+    public show() {
+        const scale = Math.min(100, this.brightness) / 100;
+        const grb = this.colourOrder === COLOUR_ORDER.GRB;
+        for (let offset = 0; offset < this.pixels.length; offset += this.channels) {
+            const r = this.pixels[offset];
+            const g = this.pixels[offset + 1];
+            this.output[offset] = (grb ? g : r) * scale;
+            this.output[offset + 1] = (grb ? r : g) * scale;
+            this.output[offset + 2] = this.pixels[offset + 2] * scale;
+            if (this.channels === 4) {
+                this.output[offset + 3] = this.pixels[offset + 3] * scale;
+            }
+        }
+    }
+}
+
+/**
+ * Converts a HSV colour with hue 0..359 and saturation and value 0..255 into RGB
+ */
+function hsvToRgb(h: number, s: number, v: number): [number, number, number] {
+    h = ((h % 360) + 360) % 360;
+    const region = Math.floor(h / 60);
+    const f = (h % 60) / 60;
+    const p = Math.round(v * (255 - s) / 255);
+    const q = Math.round(v * (255 - s * f) / 255);
+    const t = Math.round(v * (255 - s * (1 - f)) / 255);
+    switch (region) {
+        case 0: return [v, t, p];
+        case 1: return [q, v, p];
+        case 2: return [p, v, t];
+        case 3: return [p, q, v];
+        case 4: return [t, p, v];
+        default: return [v, p, q];
+    }
+}
+
+function byte(value: number): number {
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+function int16(value: number): number {
+    return (value << 16) >> 16;
+}
+
+/**
+ * Thrown while compiling a line which the device would reject as unknown token
+ */
+class MalformedLine extends Error {
+}
+
+/**
+ * Executes code images on the host. Each statement line is compiled once into a chain of closures,
+ * running a program calls them one after the other without decoding tokens again. The clock of the
+ * interpreter advances with the estimated execution times of the device, delays and the frame rate,
+ * so programs run many times faster than on the device.
+ */
+export class CodeInterpreter {
+    public readonly header: ILboHeader;
+    public readonly framebuffer: LedFramebuffer;
+    public readonly variables = new Int16Array(256);
+    public readonly eeprom = new Map<number, number>();
+    // state of the output ports set by IO.setport and IO.clrport
+    public ports = 0;
+    // device time in microseconds
+    public time = 0;
+    public frames = 0;
+    public steps = 0;
+
+    private readonly code: Uint8Array;
+    private readonly statements: Statement[] = [];
+    // source line and estimated execution time of each statement
+    private readonly lineNumbers: Int32Array;
+    private readonly lineCosts: Float64Array;
+    // statement index of each label and line offset in the code
+    private readonly addresses = new Map<number, number>();
+    // values of the data lines by the address used by read
+    private readonly dataTables = new Map<number, Int16Array>();
+    private readonly lib = new Map<number, LibFunction>();
+    // label numbers by the code offset, reported to the trace
+    private readonly labels = new Map<number, number>();
+    private readonly frameInterval: number;
+    private readonly print: boolean;
+
+    private pc = 0;
+    private nextFrame = 0;
+    private random: number;
+    private gosubStack = new Int32Array(MAX_GOSUB);
+    private gosubDepth = 0;
+    private forVariable = new Int32Array(MAX_FOR);
+    private forEnd = new Int32Array(MAX_FOR);
+    private forStep = new Int32Array(MAX_FOR);
+    private forBody = new Int32Array(MAX_FOR);
+    private forDepth = 0;
+
+    /**
+     * @param image - code image with the LBO header as created by parseResultToArray
+     * @param options - IO replacements, cost table and callbacks
+     */
+    constructor(image: Uint8Array, private options: IInterpreterOptions = {}) {
+        this.header = decodeLboHeader(image);
+        this.code = image.subarray(this.header.headerSize, this.header.headerSize + this.header.codeLength);
+        this.framebuffer = new LedFramebuffer(this.header.ledcnt, this.header.colour_order, !!(this.header.cfg & 0x01),
+            this.header.mbr || 100);
+        this.frameInterval = 1000000 / (this.header.frame_rate || DEFAULT_FRAME_RATE);
+        this.print = !!(this.header.cfg & 0x02);
+        this.random = (options.seed || 1) >>> 0 || 1;
+        this.initLibrary();
+
+        const entries = decodeEntries(this.code);
+        const lines = entries.filter((entry) => entry.kind === ENTRY.LINE);
+        this.lineNumbers = new Int32Array(lines.length + 1);
+        this.lineCosts = new Float64Array(lines.length + 1);
+
+        let index = 0;
+        entries.forEach((entry) => {
+            // labels and data lines continue with the next statement
+            this.addresses.set(entry.offset, index);
+            if (entry.kind === ENTRY.LABEL) {
+                this.labels.set(entry.offset, entry.number);
+            } else if (entry.kind === ENTRY.DATA) {
+                const values = new Int16Array(Math.floor((entry.end - entry.start) / 2));
+                const dv = new DataView(this.code.buffer, this.code.byteOffset + entry.start, values.length * 2);
+                values.forEach((_, i) => values[i] = dv.getInt16(i * 2, true));
+                // read addresses the length byte of the data line
+                this.dataTables.set(entry.offset + 2, values);
+            } else if (entry.kind === ENTRY.LINE) {
+                this.lineNumbers[index] = entry.number;
+                if (options.costs) {
+                    this.lineCosts[index] = statementCost(this.code, entry, options.costs, this.header.ledcnt);
+                }
+                const statement = this.compileLine(entry, index);
+                this.statements.push(options.trace ? this.traceLine(statement, index, options.trace) : statement);
+                index++;
+            }
+        });
+        // running past the last line ends the program
+        this.statements.push(() => END);
+    }
+
+    /**
+     * Runs the program until it ends, fails or reaches one of the limits. A following call continues
+     * the program.
+     * @param limits - limits of this run, counted from the start of the program
+     */
+    public run(limits: IRunLimits = {}): IRunResult {
+        const maxSteps = limits.maxSteps === undefined ? Infinity : limits.maxSteps;
+        const maxFrames = limits.maxFrames === undefined ? Infinity : limits.maxFrames;
+        const maxTime = limits.maxTime === undefined ? Infinity : limits.maxTime;
+        const statements = this.statements;
+        const costs = this.lineCosts;
+        let reason: IRunResult['reason'] = 'end';
+        let error: InterpreterError | undefined;
+        let pc = this.pc;
+
+        try {
+            while (pc !== END) {
+                if (this.steps >= maxSteps) {
+                    reason = 'steps';
+                    break;
+                } else if (this.frames >= maxFrames) {
+                    reason = 'frames';
+                    break;
+                } else if (this.time >= maxTime) {
+                    reason = 'time';
+                    break;
+                }
+                this.pc = pc;
+                this.time += costs[pc];
+                this.steps++;
+                const next = statements[pc]();
+                pc = next === NEXT_LINE ? pc + 1 : next;
+            }
+        } catch (e) {
+            if (!(e instanceof InterpreterError)) {
+                throw e;
+            }
+            // library functions do not know the line they are called from
+            error = new InterpreterError(e.code, this.lineNumbers[this.pc]);
+            reason = 'error';
+            pc = END;
+            this.options.onPrint && this.options.onPrint(error.message);
+        }
+        this.pc = pc;
+        return { reason, error, steps: this.steps, frames: this.frames, time: this.time };
+    }
+
+    /**
+     * Returns the source line of the statement executed next, 0 after the end of the program
+     */
+    public currentLine(): number {
+        return this.pc >= 0 ? this.lineNumbers[this.pc] : 0;
+    }
+
+    private fail(code: number): never {
+        throw new InterpreterError(code, 0);
+    }
+
+    private compileLine(entry: ICodeEntry, index: number): Statement {
+        const compiler = new LineCompiler(this, this.code, entry.start, entry.end, index);
+        try {
+            const statement = compiler.statement();
+            if (!compiler.atEnd()) {
+                throw new MalformedLine();
+            }
+            return statement;
+        } catch (e) {
+            if (!(e instanceof MalformedLine)) {
+                throw e;
+            }
+            // the device reports the error when the line is executed
+            return () => this.fail(ERR_UNKNOWN_TOKEN);
+        }
+    }
+
+    // ----- runtime support of the compiled statements -----
+
+    /** @internal */
+    public jump(address: number): number {
+        const target = this.addresses.get(address);
+        return target === undefined ? this.fail(ERR_WRONG_ADDRESS) : target;
+    }
+
+    /** @internal */
+    public gosub(address: number, returnTo: number): number {
+        if (this.gosubDepth >= MAX_GOSUB) {
+            this.fail(ERR_GOSUB_DEPTH);
+        }
+        const target = this.jump(address);
+        this.gosubStack[this.gosubDepth++] = returnTo;
+        this.options.trace && this.options.trace.gosub(this.labels.get(address) || 0);
+        return target;
+    }
+
+    /** @internal */
+    public gosubReturn(): number {
+        if (!this.gosubDepth) {
+            this.fail(ERR_RETURN);
+        }
+        this.options.trace && this.options.trace.return();
+        return this.gosubStack[--this.gosubDepth];
+    }
+
+    /** @internal */
+    public startLoop(variable: number, start: number, end: number, step: number, down: boolean, body: number) {
+        if (down ? start < end : start > end) {
+            this.fail(ERR_FOR_RANGE);
+        }
+        if (step === 0) {
+            this.fail(ERR_ZERO);
+        }
+        // restarting a loop drops it and the loops inside of it
+        for (let i = 0; i < this.forDepth; i++) {
+            if (this.forVariable[i] === variable) {
+                this.forDepth = i;
+                break;
+            }
+        }
+        if (this.forDepth >= MAX_FOR) {
+            this.fail(ERR_FOR_DEPTH);
+        }
+        const depth = this.forDepth++;
+        this.variables[variable] = start;
+        this.forVariable[depth] = variable;
+        this.forEnd[depth] = end;
+        this.forStep[depth] = down ? -step : step;
+        this.forBody[depth] = body;
+    }
+
+    /** @internal */
+    public nextLoop(variable: number): number {
+        const depth = this.forDepth - 1;
+        if (depth < 0 || this.forVariable[depth] !== variable) {
+            this.fail(ERR_NEXT);
+        }
+        const step = this.forStep[depth];
+        const value = this.variables[variable] + step;
+        this.variables[variable] = value;
+        if (step > 0 ? value <= this.forEnd[depth] : value >= this.forEnd[depth]) {
+            return this.forBody[depth];
+        }
+        this.forDepth = depth;
+        return NEXT_LINE;
+    }
+
+    /** @internal */
+    public read(address: number, index: number): number {
+        const values = this.dataTables.get(address);
+        if (!values) {
+            return this.fail(ERR_WRONG_ADDRESS);
+        }
+        // reading past the last value returns 0
+        return index >= 0 && index < values.length ? values[index] : 0;
+    }
+
+    /** @internal */
+    public nextRandom(): number {
+        // xorshift32
+        let x = this.random;
+        x ^= x << 13;
+        x ^= x >>> 17;
+        x ^= x << 5;
+        this.random = x >>> 0;
+        return this.random & 0x7FFF;
+    }
+
+    /** @internal */
+    public delay(ms: number) {
+        if (ms > 0) {
+            this.time += ms * 1000;
+        }
+    }
+
+    /** @internal */
+    public printLine(text: string) {
+        if (this.print && this.options.onPrint) {
+            this.options.onPrint(text.substring(0, PRINT_LENGTH));
+        }
+    }
+
+    /** @internal */
+    public libFunction(token: number, func: number): LibFunction | undefined {
+        return this.lib.get((token << 8) | func);
+    }
+
+    private showFrame() {
+        // the LEDs are updated with the frame rate, show() waits for the next frame
+        this.time = Math.max(this.time, this.nextFrame);
+        this.nextFrame = this.time + this.frameInterval;
+        this.framebuffer.show();
+        this.frames++;
+        this.options.trace && this.options.trace.frame(this.time);
+        this.options.onFrame && this.options.onFrame(this.framebuffer);
+    }
+
+    private initLibrary() {
+        const fb = this.framebuffer;
+        const ledcnt = this.header.ledcnt;
+        const led = (index: number) => index >= 0 && index < ledcnt ? index : this.fail(ERR_LED_VALUE);
+        const register = (index: number) => index >= 0 && index < REGISTERS ? index * 3 : this.fail(ERR_LED_VALUE);
+        const range = (beg: number, end: number) => {
+            led(beg);
+            led(end);
+            if (end < beg) {
+                this.fail(ERR_LED_VALUE);
+            }
+        };
+        const setRegister = (idx: number, rgb: number[]) => fb.registers.set(rgb.map(byte), register(idx));
+        const fromRegister = (idx: number, index: number) => {
+            const offset = register(idx);
+            fb.setRgb(index, fb.registers[offset], fb.registers[offset + 1], fb.registers[offset + 2]);
+        };
+        // colour numbers 0..7 of setled and setall, bit 0 red, bit 1 green, bit 2 blue
+        const colour = (index: number, value: number) =>
+            fb.setRgb(index, value & 1 ? 255 : 0, value & 2 ? 255 : 0, value & 4 ? 255 : 0);
+        const none = () => 0;
+
+        const functions: { [name: string]: LibFunction } = {
+            'led.show': () => this.showFrame(),
+            'led.lrgb': (l, r, g, b) => fb.setRgb(led(l), byte(r), byte(g), byte(b)),
+            'led.lhsv': (l, h, s, v) => {
+                const rgb = hsvToRgb(h, byte(s), byte(v));
+                fb.setRgb(led(l), rgb[0], rgb[1], rgb[2]);
+            },
+            'led.irgb': (idx, r, g, b) => setRegister(idx, [r, g, b]),
+            'led.ihsv': (idx, h, s, v) => setRegister(idx, hsvToRgb(h, byte(s), byte(v))),
+            'led.iled': (idx, l) => fromRegister(idx, led(l)),
+            'led.iall': (idx) => {
+                for (let i = 0; i < ledcnt; i++) {
+                    fromRegister(idx, i);
+                }
+            },
+            'led.irange': (idx, beg, end) => {
+                range(beg, end);
+                for (let i = beg; i <= end; i++) {
+                    fromRegister(idx, i);
+                }
+            },
+            'led.rainbow': (h, s, v, beg, end, inc) => {
+                range(beg, end);
+                for (let i = beg; i <= end; i++) {
+                    const rgb = hsvToRgb(h + (i - beg) * inc, byte(s), byte(v));
+                    fb.setRgb(i, rgb[0], rgb[1], rgb[2]);
+                }
+            },
+            'led.copy': (from, to) => fb.copy(led(from), led(to)),
+            'led.repeat': (beg, end, count) => {
+                range(beg, end);
+                const length = end - beg + 1;
+                for (let i = 0; i < length * count && end + 1 + i < ledcnt; i++) {
+                    fb.copy(beg + i % length, end + 1 + i);
+                }
+            },
+            'led.shift': (beg, end, to) => {
+                range(beg, end);
+                led(to);
+                fb.pixels.copyWithin(to * fb.channels, beg * fb.channels, Math.min(end + 1, ledcnt - to + beg) * fb.channels);
+            },
+            'led.mirror': (beg, end, to) => {
+                range(beg, end);
+                led(to);
+                for (let i = 0; i <= end - beg && to + i < ledcnt; i++) {
+                    fb.copy(end - i, to + i);
+                }
+            },
+            'led.blackout': () => {
+                // the LEDs are switched off at once without waiting for a frame
+                fb.clear();
+                fb.show();
+            },
+            'led.setled': (l, value) => colour(led(l), value),
+            'led.setall': (value) => {
+                for (let i = 0; i < ledcnt; i++) {
+                    colour(i, value);
+                }
+            },
+            'led.bright': (value) => {
+                fb.brightness = byte(value);
+            },
+            'io.setport': (port) => {
+                this.ports |= port;
+            },
+            'io.clrport': (port) => {
+                this.ports &= ~port;
+            },
+            'io.getrtc': (idx) => this.rtc(idx),
+            'io.eeread': (adr) => this.eeprom.get(adr) || 0,
+            'io.eewrite': (adr, data) => {
+                this.eeprom.set(adr, int16(data));
+            }
+        };
+
+        // 7-segment displays, matrix displays and the remaining IO functions are stubs
+        Object.keys(LibMap).forEach((lib) => {
+            const entry = LibMap[lib];
+            Object.keys(entry.functions).forEach((name) => {
+                const override = lib === 'io' && this.options.io && this.options.io[name];
+                const id = (entry.token << 8) | entry.functions[name];
+                const fn = override || functions[lib + '.' + name] || none;
+                this.lib.set(id, this.options.trace ? this.traceCall(fn, id, lib + '.' + name, this.options.trace) : fn);
+            });
+        });
+    }
+
+    /**
+     * Reports the time of a statement line to the trace. The estimated time of the line is added
+     * before the line is executed, waits of delay and LED.show() while it executes.
+     */
+    private traceLine(statement: Statement, index: number, trace: IExecutionTrace): Statement {
+        return () => {
+            const start = this.time - this.lineCosts[index];
+            const result = statement();
+            trace.line(index, this.time - start);
+            return result;
+        };
+    }
+
+    private traceCall(fn: LibFunction, id: number, name: string, trace: IExecutionTrace): LibFunction {
+        const cost = this.options.costs ? callCost(name, this.options.costs, this.header.ledcnt) : 0;
+        return (...args: number[]) => {
+            const start = this.time;
+            const result = fn(...args);
+            trace.call(id, this.time - start + cost);
+            return result;
+        };
+    }
+
+    private rtc(idx: number): number {
+        const date = new Date(RTC_EPOCH + Math.floor(this.time / 1000));
+        const year = date.getUTCFullYear();
+        const leap = (year % 4 === 0 && year % 100 !== 0) || year % 400 === 0;
+        switch (idx) {
+            case 0: return date.getUTCSeconds();
+            case 1: return date.getUTCMinutes();
+            case 2: return date.getUTCHours();
+            case 3: return date.getUTCDate();
+            case 4: return date.getUTCMonth() + 1;
+            case 5: return year;
+            case 6: return Math.floor((date.getTime() - Date.UTC(year, 0, 1)) / 86400000) + 1;
+            case 7: return date.getUTCDay();
+            case 8: return leap ? 1 : 0;
+        }
+        return 0;
+    }
+}
+
+/**
+ * Compiles the tokens of a statement line into closures. Expressions are parsed with the operator
+ * precedence of the grammar, from the logical or down to the values.
+ */
+class LineCompiler {
+    private pos: number;
+
+    constructor(private vm: CodeInterpreter, private code: Uint8Array, start: number, private end: number,
+                private index: number) {
+        this.pos = start;
+    }
+
+    public atEnd(): boolean {
+        return this.pos >= this.end;
+    }
+
+    public statement(): Statement {
+        const vm = this.vm;
+        const token = this.take();
+        switch (token) {
+            case TOKEN.ASSIGN: {
+                const variable = this.take();
+                const value = this.expression();
+                const variables = vm.variables;
+                return () => {
+                    variables[variable] = value();
+                    return NEXT_LINE;
+                };
+            }
+            case TOKEN.IF:
+                return this.condition();
+            case TOKEN.FOR:
+                return this.loop();
+            case TOKEN.NEXT: {
+                const variable = this.take();
+                return () => vm.nextLoop(variable);
+            }
+            case TOKEN.GOTO: {
+                const address = this.operand();
+                return () => vm.jump(address);
+            }
+            case TOKEN.GOSUB: {
+                const address = this.operand();
+                const returnTo = this.index + 1;
+                return () => vm.gosub(address, returnTo);
+            }
+            case TOKEN.RETURN:
+                return () => vm.gosubReturn();
+            case TOKEN.DELAY: {
+                const value = this.expression();
+                return () => {
+                    vm.delay(value());
+                    return NEXT_LINE;
+                };
+            }
+            case TOKEN.PRINT:
+                return this.printStatement();
+            case TOKEN.END:
+                return () => END;
+            case TOKEN.LIB_LED:
+            case TOKEN.LIB_IO:
+            case TOKEN.LIB_MATRIX: {
+                const call = this.call(token);
+                return () => {
+                    call();
+                    return NEXT_LINE;
+                };
+            }
+        }
+        throw new MalformedLine();
+    }
+
+    private take(): number {
+        if (this.pos >= this.end) {
+            throw new MalformedLine();
+        }
+        return this.code[this.pos++];
+    }
+
+    private peek(): number {
+        return this.pos < this.end ? this.code[this.pos] : -1;
+    }
+
+    private operand(): number {
+        const value = readOperand(this.code, this.pos - 1);
+        this.pos += 2;
+        return value;
+    }
+
+    private expect(token: number) {
+        if (this.take() !== token) {
+            throw new MalformedLine();
+        }
+    }
+
+    private condition(): Statement {
+        // the operand is the offset of the else token, 0 without else
+        this.take();
+        const condition = this.expression();
+        this.expect(TOKEN.THEN);
+        const then = this.statement();
+        let otherwise: Statement | null = null;
+        if (this.peek() === TOKEN.ELSE) {
+            this.pos++;
+            otherwise = this.statement();
+        }
+        if (otherwise) {
+            const elseStatement = otherwise;
+            return () => condition() ? then() : elseStatement();
+        }
+        return () => condition() ? then() : NEXT_LINE;
+    }
+
+    private loop(): Statement {
+        const variable = this.take();
+        const start = this.expression();
+        const direction = this.take();
+        if (direction !== TOKEN.TO && direction !== TOKEN.DOWNTO) {
+            throw new MalformedLine();
+        }
+        const end = this.expression();
+        let step: Expression = () => 1;
+        if (this.peek() === TOKEN.STEP) {
+            this.pos++;
+            step = this.expression();
+        }
+        const down = direction === TOKEN.DOWNTO;
+        const body = this.index + 1;
+        const vm = this.vm;
+        return () => {
+            vm.startLoop(variable, start(), end(), step(), down, body);
+            return NEXT_LINE;
+        };
+    }
+
+    private printStatement(): Statement {
+        const parts: Array<Expression | string> = [];
+        for (;;) {
+            if (this.peek() === TOKEN.STRING) {
+                this.pos++;
+                const length = this.take();
+                parts.push(String.fromCharCode.apply(null, Array.from(this.code.subarray(this.pos, this.pos + length))));
+                this.pos += length;
+            } else {
+                parts.push(this.expression());
+            }
+            const separator = this.peek();
+            if (separator === TOKEN.COMMA) {
+                parts.push(' ');
+            } else if (separator !== TOKEN.SEMICOLON) {
+                break;
+            }
+            this.pos++;
+        }
+        const vm = this.vm;
+        return () => {
+            let text = '';
+            for (const part of parts) {
+                text += typeof part === 'string' ? part : String(part());
+            }
+            vm.printLine(text);
+            return NEXT_LINE;
+        };
+    }
+
+    /**
+     * Compiles a library call, the lowest 3 bits of the function byte hold the number of arguments
+     */
+    private call(token: number): Expression {
+        const func = this.take();
+        const fn = this.vm.libFunction(token, func);
+        if (!fn) {
+            throw new MalformedLine();
+        }
+        const args: Expression[] = [];
+        for (let i = 0; i < (func & 0x07); i++) {
+            if (i) {
+                this.expect(TOKEN.COMMA);
+            }
+            args.push(this.expression());
+        }
+        const [a, b, c, d, e, f] = args;
+        switch (args.length) {
+            case 0: return () => (fn() as number) | 0;
+            case 1: return () => (fn(a()) as number) | 0;
+            case 2: return () => (fn(a(), b()) as number) | 0;
+            case 3: return () => (fn(a(), b(), c()) as number) | 0;
+            case 4: return () => (fn(a(), b(), c(), d()) as number) | 0;
+            case 5: return () => (fn(a(), b(), c(), d(), e()) as number) | 0;
+            default: return () => (fn(a(), b(), c(), d(), e(), f()) as number) | 0;
+        }
+    }
+
+    private expression(): Expression {
+        return this.logicalOr();
+    }
+
+    private logicalOr(): Expression {
+        let left = this.logicalAnd();
+        while (this.peek() === TOKEN.OR) {
+            this.pos++;
+            const l = left;
+            const r = this.logicalAnd();
+            left = () => {
+                // both operands are evaluated like on the device
+                const a = l();
+                return (r() || a) ? 1 : 0;
+            };
+        }
+        return left;
+    }
+
+    private logicalAnd(): Expression {
+        let left = this.bitwiseOr();
+        while (this.peek() === TOKEN.AND) {
+            this.pos++;
+            const l = left;
+            const r = this.bitwiseOr();
+            left = () => {
+                const a = l();
+                return (r() && a) ? 1 : 0;
+            };
+        }
+        return left;
+    }
+
+    private bitwiseOr(): Expression {
+        let left = this.bitwiseAnd();
+        while (this.peek() === TOKEN.BOR) {
+            this.pos++;
+            const l = left;
+            const r = this.bitwiseAnd();
+            left = () => int16(l() | r());
+        }
+        return left;
+    }
+
+    private bitwiseAnd(): Expression {
+        let left = this.comparison();
+        while (this.peek() === TOKEN.BAND) {
+            this.pos++;
+            const l = left;
+            const r = this.comparison();
+            left = () => int16(l() & r());
+        }
+        return left;
+    }
+
+    private comparison(): Expression {
+        let left = this.sum();
+        for (;;) {
+            const op = this.peek();
+            if (op < TOKEN.LT || op > TOKEN.NE) {
+                return left;
+            }
+            this.pos++;
+            const l = left;
+            const r = this.sum();
+            switch (op) {
+                case TOKEN.LT: left = () => l() < r() ? 1 : 0; break;
+                case TOKEN.GT: left = () => l() > r() ? 1 : 0; break;
+                case TOKEN.EQ: left = () => l() === r() ? 1 : 0; break;
+                case TOKEN.LE: left = () => l() <= r() ? 1 : 0; break;
+                case TOKEN.GE: left = () => l() >= r() ? 1 : 0; break;
+                default: left = () => l() !== r() ? 1 : 0;
+            }
+        }
+    }
+
+    private sum(): Expression {
+        let left = this.product();
+        for (;;) {
+            const op = this.peek();
+            if (op !== TOKEN.ADD && op !== TOKEN.SUB) {
+                return left;
+            }
+            this.pos++;
+            const l = left;
+            const r = this.product();
+            left = op === TOKEN.ADD ? () => int16(l() + r()) : () => int16(l() - r());
+        }
+    }
+
+    private product(): Expression {
+        let left = this.prefix();
+        for (;;) {
+            const op = this.peek();
+            if (op !== TOKEN.MUL && op !== TOKEN.DIV && op !== TOKEN.MOD) {
+                return left;
+            }
+            this.pos++;
+            const l = left;
+            const r = this.prefix();
+            if (op === TOKEN.MUL) {
+                left = () => int16(Math.imul(l(), r()));
+            } else {
+                const divide = op === TOKEN.DIV;
+                left = () => {
+                    const a = l();
+                    const b = r();
+                    if (b === 0) {
+                        throw new InterpreterError(ERR_ZERO, 0);
+                    }
+                    return int16(divide ? Math.trunc(a / b) : a % b);
+                };
+            }
+        }
+    }
+
+    private prefix(): Expression {
+        if (this.peek() === TOKEN.SUB) {
+            this.pos++;
+            const value = this.primary();
+            return () => int16(-value());
+        }
+        return this.primary();
+    }
+
+    private primary(): Expression {
+        const vm = this.vm;
+        const token = this.take();
+        switch (token) {
+            case TOKEN.VALUE: {
+                const value = int16(this.operand());
+                return () => value;
+            }
+            case TOKEN.VAR: {
+                const variable = this.take();
+                const variables = vm.variables;
+                return () => variables[variable];
+            }
+            case TOKEN.PAREN_OPEN: {
+                const inner = this.expression();
+                this.expect(TOKEN.PAREN_CLOSE);
+                return inner;
+            }
+            case TOKEN.RANDOM:
+                return () => vm.nextRandom();
+            case TOKEN.READ: {
+                const address = this.operand();
+                const index = this.expression();
+                return () => vm.read(address, index());
+            }
+            case TOKEN.LIB_LED:
+            case TOKEN.LIB_IO:
+            case TOKEN.LIB_MATRIX:
+                return this.call(token);
+        }
+        throw new MalformedLine();
+    }
+}
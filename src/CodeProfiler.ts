@@ -0,0 +1,229 @@
+'use strict';
+// tslint:disable: no-bitwise
+
+import { decodeEntries, decodeTokens, ENTRY } from './CodeImage';
+import { CodeInterpreter, IExecutionTrace, IInterpreterOptions, IRunLimits, IRunResult } from './CodeInterpreter';
+import { decodeLboHeader, DEFAULT_FRAME_RATE } from './Common';
+import { libCallName } from './CostEstimator';
+
+export interface ILineProfile {
+    // source line number
+    line: number;
+    // label of the block containing the line, null before the first label
+    label: number | null;
+    // number of executions
+    hits: number;
+    // number of executed tokens
+    instructions: number;
+    // device time in microseconds including library calls and waits
+    time: number;
+}
+
+export interface ILabelProfile {
+    label: number | null;
+    // first source line with a statement in the block
+    line: number;
+    // executed statements and tokens of the lines in the block
+    hits: number;
+    instructions: number;
+    time: number;
+}
+
+export interface ICallProfile {
+    // '<lib>.<function>'
+    name: string;
+    // (token << 8) | function as in LibMap
+    id: number;
+    calls: number;
+    time: number;
+}
+
+export interface IProfileReport {
+    result: IRunResult;
+    // configured frame rate and the rate reached by the program
+    frameRate: number;
+    fps: number;
+    frames: number;
+    // number of frames displayed later than the frame rate allows
+    lateFrames: number;
+    // longest time between two frames in microseconds
+    maxFrameTime: number;
+    instructions: number;
+    lines: ILineProfile[];
+    labels: ILabelProfile[];
+    calls: ICallProfile[];
+}
+
+/**
+ * Collects the execution profile of a code image on the host interpreter: executions, tokens
+ * and device time per source line and label, time per library call and the reached frame rate.
+ */
+export class CodeProfiler implements IExecutionTrace {
+    public readonly interpreter: CodeInterpreter;
+    private readonly frameInterval: number;
+    // per statement index in code order
+    private readonly lineNumbers: number[] = [];
+    private readonly lineLabels: Array<number | null> = [];
+    private readonly tokenCounts: number[] = [];
+    private readonly hits: Float64Array;
+    private readonly times: Float64Array;
+    private readonly calls = new Map<number, ICallProfile>();
+    // folded call stacks with their device time, see foldedStacks()
+    private readonly stacks = new Map<string, number>();
+    private stack: string[] = ['program'];
+    private stackKey = 'program';
+    // gosub and return change the stack after their line is reported
+    private stackChanged = false;
+    private callTime = 0;
+    private lastFrame = -1;
+    private lateFrames = 0;
+    private maxFrameTime = 0;
+
+    /**
+     * @param image - code image with the LBO header
+     * @param options - options of the interpreter
+     */
+    constructor(image: Uint8Array, options: IInterpreterOptions = {}) {
+        const header = decodeLboHeader(image);
+        const code = image.subarray(header.headerSize, header.headerSize + header.codeLength);
+        this.frameInterval = 1000000 / (header.frame_rate || DEFAULT_FRAME_RATE);
+
+        let label: number | null = null;
+        decodeEntries(code).forEach((entry) => {
+            if (entry.kind === ENTRY.LABEL) {
+                label = entry.number;
+            } else if (entry.kind === ENTRY.LINE) {
+                this.lineNumbers.push(entry.number);
+                this.lineLabels.push(label);
+                this.tokenCounts.push(decodeTokens(code, entry).length);
+            }
+        });
+        this.hits = new Float64Array(this.lineNumbers.length);
+        this.times = new Float64Array(this.lineNumbers.length);
+        this.interpreter = new CodeInterpreter(image, { ...options, trace: this });
+    }
+
+    /**
+     * Runs the program and returns the profile collected since the start of the program
+     * @param limits - limits of the run, see CodeInterpreter.run
+     */
+    public run(limits: IRunLimits): IProfileReport {
+        const result = this.interpreter.run(limits);
+        return this.report(result);
+    }
+
+    /**
+     * Returns the device time per call stack in the folded format of flamegraph.pl and compatible
+     * tools, one 'frame;frame;... time' line per stack. Frames are the subroutines called with
+     * gosub, the source line and the library call.
+     */
+    public foldedStacks(): string {
+        const result: string[] = [];
+        this.stacks.forEach((time, stack) => {
+            if (time > 0) {
+                result.push(stack + ' ' + Math.round(time));
+            }
+        });
+        return result.sort().join('\n') + '\n';
+    }
+
+    public line(index: number, time: number) {
+        this.hits[index]++;
+        this.times[index] += time;
+        // the time of the library calls of the line is added to their own frames
+        this.addStack(this.stackKey + ';line ' + this.lineNumbers[index], time - this.callTime);
+        this.callTime = 0;
+        if (this.stackChanged) {
+            this.stackKey = this.stack.join(';');
+            this.stackChanged = false;
+        }
+    }
+
+    public call(id: number, time: number) {
+        let profile = this.calls.get(id);
+        if (!profile) {
+            profile = { name: libCallName(id >> 8, id & 0xFF) || String(id), id, calls: 0, time: 0 };
+            this.calls.set(id, profile);
+        }
+        profile.calls++;
+        profile.time += time;
+        this.callTime += time;
+        // the line is reported after its calls
+        this.addStack(this.stackKey + ';line ' + this.interpreter.currentLine() + ';' + profile.name, time);
+    }
+
+    public gosub(label: number) {
+        this.stack.push('label ' + label);
+        this.stackChanged = true;
+    }
+
+    public return() {
+        if (this.stack.length > 1) {
+            this.stack.pop();
+            this.stackChanged = true;
+        }
+    }
+
+    public frame(time: number) {
+        if (this.lastFrame >= 0) {
+            const frameTime = time - this.lastFrame;
+            this.maxFrameTime = Math.max(this.maxFrameTime, frameTime);
+            // show() waits for the next frame, a longer time means the frame was late
+            if (frameTime > this.frameInterval + 0.5) {
+                this.lateFrames++;
+            }
+        }
+        this.lastFrame = time;
+    }
+
+    private addStack(key: string, time: number) {
+        this.stacks.set(key, (this.stacks.get(key) || 0) + time);
+    }
+
+    /**
+     * Returns the profile collected since the start of the program, for runs of the interpreter
+     * split into several calls
+     * @param result - result of the last run
+     */
+    public report(result: IRunResult): IProfileReport {
+        const lines: ILineProfile[] = [];
+        const labels = new Map<number | null, ILabelProfile>();
+        let instructions = 0;
+
+        this.lineNumbers.forEach((line, index) => {
+            const label = this.lineLabels[index];
+            let block = labels.get(label);
+            if (!block) {
+                block = { label, line, hits: 0, instructions: 0, time: 0 };
+                labels.set(label, block);
+            }
+            const hits = this.hits[index];
+            const profile = {
+                line,
+                label,
+                hits,
+                instructions: hits * this.tokenCounts[index],
+                time: this.times[index]
+            };
+            lines.push(profile);
+            block.hits += hits;
+            block.instructions += profile.instructions;
+            block.time += profile.time;
+            instructions += profile.instructions;
+        });
+
+        const seconds = result.time / 1000000;
+        return {
+            result,
+            frameRate: Math.round(1000000 / this.frameInterval),
+            fps: seconds > 0 ? result.frames / seconds : 0,
+            frames: result.frames,
+            lateFrames: this.lateFrames,
+            maxFrameTime: this.maxFrameTime,
+            instructions,
+            lines,
+            labels: Array.from(labels.values()),
+            calls: Array.from(this.calls.values()).sort((a, b) => b.time - a.time)
+        };
+    }
+}
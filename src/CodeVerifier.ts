@@ -0,0 +1,104 @@
+'use strict';
+// tslint:disable: no-bitwise
+
+import { CodeInterpreter, IRunResult, LedFramebuffer, LibFunction } from './CodeInterpreter';
+import { IMetaData, IParseResult, LibMap, parseResultToArray } from './Common';
+
+// limits of each run, the optimized code needs the same or fewer statements than the plain code
+const VERIFY_STEPS = 100000;
+const VERIFY_FRAMES = 100;
+// seeds of the runs, 0 runs with all inputs returning 0
+const VERIFY_SEEDS = [0, 7, 4711];
+// IO functions of the interpreter which are kept, outputs and functions depending on the device state
+const IO_KEEP = ['setport', 'clrport', 'getrtc', 'setrtc', 'beep', 'setenc', 'eeread', 'eewrite', 'sys', 'bt'];
+// header of the verification images, the device is not known to the parser
+const VERIFY_META: IMetaData = {
+    sysCode: 0
+};
+
+interface IExecution {
+    // print output, runtime errors and frames in the order they happened
+    events: string[];
+    result: IRunResult;
+    state: string;
+}
+
+/**
+ * Returns the IO inputs of a run, random values from a generator seeded with the provided value
+ */
+function inputs(seed: number): { [name: string]: LibFunction } {
+    const io: { [name: string]: LibFunction } = {};
+    if (!seed) {
+        return io;
+    }
+    let x = seed;
+    const next = () => {
+        x ^= x << 13;
+        x ^= x >>> 17;
+        x ^= x << 5;
+        return (x >>> 0) & 0xFF;
+    };
+    Object.keys(LibMap.io.functions)
+        .filter((name) => IO_KEEP.indexOf(name) < 0)
+        .forEach((name) => io[name] = next);
+    return io;
+}
+
+function snapshot(vm: CodeInterpreter, framebuffer: LedFramebuffer): string {
+    return Array.from(framebuffer.output).join(',') + ' B' + framebuffer.brightness + ' P' + vm.ports
+        + ' V' + Array.from(vm.variables).join(',');
+}
+
+function execute(image: Uint8Array, seed: number): IExecution {
+    const events: string[] = [];
+    const vm: CodeInterpreter = new CodeInterpreter(image, {
+        seed: seed || 1,
+        io: inputs(seed),
+        onPrint: (text) => events.push('print ' + text),
+        onFrame: (framebuffer) => events.push('frame ' + snapshot(vm, framebuffer))
+    });
+    const result = vm.run({ maxSteps: VERIFY_STEPS, maxFrames: VERIFY_FRAMES });
+    const eeprom = Array.from(vm.eeprom.entries()).sort((a, b) => a[0] - b[0]).join(';');
+    return { events, result, state: snapshot(vm, vm.framebuffer) + ' E' + eeprom };
+}
+
+/**
+ * Checks that an optimized code image behaves like the image compiled without optimizations. Both
+ * images run on the host interpreter with the same random numbers and IO inputs, once with all
+ * inputs 0 and with random inputs of VERIFY_SEEDS. The print output, runtime errors, every frame
+ * with the variables at the time of the frame and the final state must be equal. Runs stopped by
+ * the statement limit are compared up to the events of the plain code, the optimized code needs
+ * fewer statements for them. Only the paths taken by the runs are checked. Returns a description
+ * of the first difference or null.
+ * @param plain - result of the compilation without any optimization
+ * @param optimized - result of the optimized compilation
+ */
+export function verifyOptimizedImage(plain: IParseResult, optimized: IParseResult): string | null {
+    const plainImage = parseResultToArray(plain, VERIFY_META);
+    const optImage = parseResultToArray(optimized, VERIFY_META);
+
+    for (const seed of VERIFY_SEEDS) {
+        const p = execute(plainImage, seed);
+        const o = execute(optImage, seed);
+        const scenario = seed ? 'with random inputs (seed ' + seed + ')' : 'without inputs';
+
+        for (let i = 0; i < p.events.length; i++) {
+            if (p.events[i] !== o.events[i]) {
+                const kind = p.events[i].substring(0, p.events[i].indexOf(' '));
+                const count = p.events.slice(0, i + 1).filter((event) => event.startsWith(kind + ' ')).length;
+                return 'The optimized code differs ' + scenario + ' at ' + kind + ' ' + count;
+            }
+        }
+        if (p.result.reason === 'steps') {
+            // stopped somewhere in the program, the optimized code may be further
+            continue;
+        }
+        if (o.events.length !== p.events.length || o.result.reason !== p.result.reason) {
+            return 'The optimized code ends differently ' + scenario;
+        }
+        if (o.state !== p.state) {
+            return 'The optimized code leaves a different state ' + scenario;
+        }
+    }
+    return null;
+}
@@ -18,6 +18,26 @@ export interface IError {
 export interface IMatchResult {
     success: boolean;
     errors?: IError[];
+    // library calls of a matched program in source order
+    calls?: ICallSite[];
+}
+
+export interface ICallSite {
+    // library and function as written in the source code, e.g. 'LED' and 'show'
+    lib: string;
+    func: string;
+    args: number;
+    // source offsets of '<lib>.<function>'
+    start: number;
+    end: number;
+}
+
+/**
+ * Library call which the selected device can't execute
+ */
+export interface ICallError {
+    call: ICallSite;
+    message: string;
 }
 
 export interface IPosition {
@@ -34,6 +54,28 @@ export interface IParseResult {
     success: boolean;
     code: Uint8Array;
     config: IConfig;
+    warnings?: string[];
+    removed?: IRemovedCode[];
+}
+
+/**
+ * Per compilation options of the code tokenizer
+ */
+export interface ICompileOptions {
+    // fold constant expressions, simplify identities and shorten goto chains
+    optimize?: boolean;
+    // compile a second time without optimizations and check that both images behave the same on the host interpreter
+    verify?: boolean;
+    // remove unreachable code, unused labels and data which is never read
+    removeDeadCode?: boolean;
+}
+
+/**
+ * Source line removed from the code image by the dead code elimination
+ */
+export interface IRemovedCode {
+    line: number;
+    reason: string;
 }
 
 export interface IConfig {
@@ -74,11 +116,28 @@ export interface ICommand {
     argcount: number;
 }
 
+/**
+ * Estimated execution times of the LED Basic interpreter of a device in microseconds
+ */
+export interface ICostTable {
+    // time to fetch and execute a single token
+    token: number;
+    // base time of a library call which is not listed in calls
+    call: number;
+    // base time of specific library calls, key is '<lib>.<function>' in lower case
+    calls?: { [name: string]: number };
+    // additional time per LED of library calls processing the whole LED buffer
+    perLed?: { [name: string]: number };
+    // set once the times are measured on the device, otherwise estimates are shown as uncalibrated
+    calibrated?: boolean;
+}
+
 export interface IDevice {
     label: string;
     detail?: string;
     meta: IMetaData;
     commands: ICommand[];
+    costs?: ICostTable;
 }
 
 export interface ISerialPortInfo {
@@ -88,20 +147,41 @@ export interface ISerialPortInfo {
     sysCode: number;
 }
 
+/**
+ * Receiver of timing events of an upload
+ */
+export interface IUploadRecorder {
+    // records a finished operation of the phase started at the provided time (performance.now())
+    record(phase: string, start: number, bytes?: number): void;
+}
+
 export interface ISerialPort {
     isOpen(): boolean;
     close(): Promise<void>;
     read(timeout?: number): Promise<Uint8Array>;
     write(data: Uint8Array): Promise<void>;
-    openForUpload(brk?: boolean, dtr?: boolean): Promise<void>;
+    openForUpload(brk?: boolean, dtr?: boolean, recorder?: IUploadRecorder): Promise<void>;
     dispose(): void;
 }
 
+export interface IReadProfile {
+    // size of the buffer pool the port reads into
+    poolSize: number;
+    // reading from the port pauses while this many received bytes wait for a consumer
+    highWaterMark: number;
+}
+
 export interface ISerialPortOptions {
     baudRate: number;
     autoOpen?: boolean;
     parity?: string;
     hupcl?: boolean;
+    // recording of a previous session to play back instead of accessing the port
+    replay?: string;
+    // playback speed of the recording, 0 plays it back without delays
+    replaySpeed?: number;
+    // buffering of the received data, see READ_PROFILE_UPLOAD and READ_PROFILE_TERMINAL
+    readProfile?: IReadProfile;
 }
 
 export interface ISerialPortFactory {
@@ -122,16 +202,35 @@ interface ILibMap {
 }
 
 export interface IDevUploader {
+    recorder?: IUploadRecorder;
     isOpen(): boolean;
     open(): Promise<void>;
     close(): Promise<void>;
     reset(): Promise<string>;
     write(data: Uint8Array): Promise<void>;
     read(timeout?: number): Promise<Uint8Array>;
-    sendData(data: Uint8Array): Promise<void>;
+    sendData(data: Uint8Array, pages?: number[]): Promise<void>;
+}
+
+/**
+ * Settings stored in the header of a code image, see createLboHeader
+ */
+export interface ILboHeader {
+    sysCode: number;
+    headerSize: number;
+    basver: number;
+    codeLength: number;
+    ledcnt: number;
+    colour_order: COLOUR_ORDER;
+    cfg: number;
+    frame_rate: number;
+    mbr: number;
+    led_type: number;
+    spi_rate: number;
 }
 
 const LBO_HEADER_SIZE = 16;
+export const DEFAULT_FRAME_RATE = 25;
 export function parseResultToArray(result: IParseResult, meta: IMetaData): Uint8Array {
     const data = new Uint8Array(result.code.length + LBO_HEADER_SIZE);
     const header = createLboHeader(result.config, result.code.length, meta);
@@ -140,6 +239,23 @@ export function parseResultToArray(result: IParseResult, meta: IMetaData): Uint8
     return data;
 }
 
+/**
+ * Returns the number of LEDs driven by the device. If a device has a fixed number of LEDs - use
+ * this value, otherwise check the config line from the code or finally a default value
+ * @param config - configuration from the code
+ * @param meta - meta data of the device
+ */
+export function getLedCount(config: IConfig, meta: IMetaData): number {
+    if (meta.ledcnt !== undefined) {
+        return meta.ledcnt;
+    } else if (config.ledcnt !== undefined) {
+        return config.ledcnt;
+    } else if (meta.default_ledcnt !== undefined) {
+        return meta.default_ledcnt;
+    }
+    return 255;
+}
+
 function createLboHeader(config: IConfig, codeLength: number, meta: IMetaData): Uint8Array {
     const header = new Uint8Array(LBO_HEADER_SIZE);
     const dv = new DataView(header.buffer);
@@ -152,19 +268,8 @@ function createLboHeader(config: IConfig, codeLength: number, meta: IMetaData):
     dv.setUint8(3, meta.basver || 0x0F);
     // set the size of the code
     dv.setUint16(4, codeLength, true);
-    // set the max number of LEDs. If a device has a fixed number of LEDs - use
-    // this value, otherwise check the config line from the code or finally a default value
-    let ledcnt: number;
-    if (meta.ledcnt !== undefined) {
-        ledcnt = meta.ledcnt;
-    } else if (config.ledcnt !== undefined) {
-        ledcnt = config.ledcnt;
-    } else if (meta.default_ledcnt !== undefined) {
-        ledcnt = meta.default_ledcnt;
-    } else {
-        ledcnt = 255;
-    }
-    dv.setUint16(6, ledcnt, true);
+    // set the max number of LEDs
+    dv.setUint16(6, getLedCount(config, meta), true);
     // set the colour order
     dv.setUint8(8, meta.colour_order || config.colour_order || COLOUR_ORDER.GRB); // colour order RGB / GRB
     // calculate and set cfg bits
@@ -183,7 +288,7 @@ function createLboHeader(config: IConfig, codeLength: number, meta: IMetaData):
     }
     dv.setUint8(9, meta.cfg || cfg);
     // set the frame rate
-    dv.setUint8(10, config.frame_rate || 25);
+    dv.setUint8(10, config.frame_rate || DEFAULT_FRAME_RATE);
     // set the master brightness
     dv.setUint8(11, meta.mbr || config.mbr || 100);
     // set the led type specific to the device
@@ -194,6 +299,30 @@ function createLboHeader(config: IConfig, codeLength: number, meta: IMetaData):
     return header;
 }
 
+/**
+ * Reads the header of a code image created by parseResultToArray
+ * @param data - code image with the LBO header
+ */
+export function decodeLboHeader(data: Uint8Array): ILboHeader {
+    if (data.length < LBO_HEADER_SIZE) {
+        throw new Error('Invalid code image');
+    }
+    const dv = new DataView(data.buffer, data.byteOffset, data.byteLength);
+    return {
+        sysCode: dv.getUint16(0, true),
+        headerSize: dv.getUint8(2),
+        basver: dv.getUint8(3),
+        codeLength: dv.getUint16(4, true),
+        ledcnt: dv.getUint16(6, true),
+        colour_order: dv.getUint8(8),
+        cfg: dv.getUint8(9),
+        frame_rate: dv.getUint8(10),
+        mbr: dv.getUint8(11),
+        led_type: dv.getUint8(12),
+        spi_rate: dv.getUint8(13)
+    };
+}
+
 const REG_ERROR = new RegExp('\\?ERROR ([0-9]+) IN LINE ([0-9]+)');
 const ERROR_MAP: { [s: string]: string; } = {
     11: 'Unknown token',
@@ -307,6 +436,28 @@ export const LibMap: ILibMap = {
     }
 };
 
+export interface ILibCall {
+    token: number;
+    func: number;
+}
+
+// library calls by '<lib>.<function>' in lower case
+const LIB_CALL_TABLE = new Map<string, ILibCall>();
+Object.keys(LibMap).forEach((lib) => {
+    const entry = LibMap[lib];
+    Object.keys(entry.functions).forEach((func) => {
+        LIB_CALL_TABLE.set(lib + '.' + func, { token: entry.token, func: entry.functions[func] });
+    });
+});
+
+/**
+ * Returns the token and function byte of a library call or undefined for an unknown call
+ * @param name - call as '<lib>.<function>' in lower case, e.g. 'led.lrgb'
+ */
+export function findLibCall(name: string): ILibCall | undefined {
+    return LIB_CALL_TABLE.get(name);
+}
+
 export interface IJumpTable { [label: string]: number; }
 
 type Action = (...args: any[]) => any;
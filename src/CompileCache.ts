@@ -0,0 +1,128 @@
+'use strict';
+
+import { createHash } from 'crypto';
+import * as fs from 'fs';
+import * as path from 'path';
+import { IMetaData } from './Common';
+
+const MAX_MEMORY_SIZE = 4 * 1024 * 1024;
+const MAX_DISK_ENTRIES = 100;
+const CACHE_DIR = 'compile-cache';
+
+/**
+ * Cache of compiled LBO images addressed by the hash of the source code, the device meta data and
+ * the settings influencing the compilation. Keeps the recently used images in memory and optionally
+ * on disk, the least recently used entries are evicted first.
+ */
+class CompileCache {
+    // insertion order of the map is the usage order, first entry is the least recently used
+    private entries = new Map<string, Uint8Array>();
+    private size = 0;
+    private storagePath: string | null = null;
+
+    /**
+     * Enables the disk layer in the provided directory or disables it if null
+     * @param storagePath - storage directory of the extension
+     */
+    public setStoragePath(storagePath: string | null) {
+        this.storagePath = storagePath ? path.join(storagePath, CACHE_DIR) : null;
+    }
+
+    /**
+     * Returns the cache key for the compilation of the source code
+     * @param text - source code
+     * @param meta - meta data of the target device
+     * @param settings - settings influencing the compilation
+     */
+    public key(text: string, meta: IMetaData, settings: object): string {
+        return createHash('sha256')
+            .update(text)
+            .update(JSON.stringify(meta))
+            .update(JSON.stringify(settings))
+            .digest('hex');
+    }
+
+    /**
+     * Returns the cached image or null
+     * @param key - cache key
+     */
+    public get(key: string): Uint8Array | null {
+        let data = this.entries.get(key);
+        if (data) {
+            // move to the end of the usage order
+            this.entries.delete(key);
+            this.entries.set(key, data);
+            return data;
+        }
+
+        if (!this.storagePath) {
+            return null;
+        }
+        const file = path.join(this.storagePath, key + '.lbo');
+        try {
+            data = new Uint8Array(fs.readFileSync(file));
+            const now = new Date();
+            fs.utimesSync(file, now, now);
+        } catch (error) {
+            return null;
+        }
+        this.add(key, data);
+        return data;
+    }
+
+    /**
+     * Stores the compiled image
+     * @param key - cache key
+     * @param data - LBO image
+     */
+    public set(key: string, data: Uint8Array) {
+        this.add(key, data);
+
+        if (!this.storagePath) {
+            return;
+        }
+        // the disk layer is best effort, the image is compiled again if it can't be stored
+        try {
+            fs.mkdirSync(this.storagePath, { recursive: true });
+            fs.writeFileSync(path.join(this.storagePath, key + '.lbo'), data);
+            this.pruneDisk(this.storagePath);
+        } catch (error) {
+            return;
+        }
+    }
+
+    private add(key: string, data: Uint8Array) {
+        const existing = this.entries.get(key);
+        if (existing) {
+            this.size -= existing.length;
+            this.entries.delete(key);
+        }
+        this.entries.set(key, data);
+        this.size += data.length;
+
+        for (const [oldKey, oldData] of this.entries) {
+            if (this.size <= MAX_MEMORY_SIZE || oldKey === key) {
+                break;
+            }
+            this.entries.delete(oldKey);
+            this.size -= oldData.length;
+        }
+    }
+
+    private pruneDisk(dir: string) {
+        const files = fs.readdirSync(dir)
+            .filter((name) => name.endsWith('.lbo'))
+            .map((name) => {
+                const file = path.join(dir, name);
+                return { file, time: fs.statSync(file).mtimeMs };
+            });
+        if (files.length <= MAX_DISK_ENTRIES) {
+            return;
+        }
+        files.sort((a, b) => a.time - b.time)
+            .slice(0, files.length - MAX_DISK_ENTRIES)
+            .forEach((entry) => fs.unlinkSync(entry.file));
+    }
+}
+
+export const compileCache = new CompileCache();
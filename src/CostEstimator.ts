@@ -0,0 +1,276 @@
+'use strict';
+// tslint:disable: no-bitwise
+
+import { decodeEntries, decodeTokens, ENTRY, ICodeEntry, ICodeToken, readOperand, TOKEN } from './CodeImage';
+import { DEFAULT_FRAME_RATE, IConfig, ICostTable, LibMap } from './Common';
+
+export interface ILineCost {
+    // source line number
+    line: number;
+    // estimated time of a single execution in microseconds
+    cost: number;
+}
+
+export interface IBlockCost {
+    // label number, null for the code before the first label
+    label: number | null;
+    // first source line with a statement in the block, 0 for an empty block
+    line: number;
+    // estimated time of the straight-line execution of the block, including its loops
+    cost: number;
+    overBudget: boolean;
+}
+
+export interface ILoopCost {
+    // source lines of the FOR and the NEXT statement
+    line: number;
+    endLine: number;
+    // number of iterations, null if the bounds are not constant
+    iterations: number | null;
+    // estimated time of a single iteration
+    bodyCost: number;
+    // estimated time of the whole loop, a single iteration if the number of iterations is unknown
+    cost: number;
+    overBudget: boolean;
+}
+
+export interface ICostReport {
+    // false if the cost table of the device is not measured on the device
+    calibrated: boolean;
+    frameRate: number;
+    // time available for a single frame in microseconds
+    frameBudget: number;
+    ledcnt: number;
+    lines: ILineCost[];
+    blocks: IBlockCost[];
+    loops: ILoopCost[];
+}
+
+interface IOpenLoop {
+    variable: number;
+    line: number;
+    iterations: number | null;
+    head: number;
+    body: number;
+    block: IBlockCost | null;
+}
+
+// maps library token and function byte to '<lib>.<function>'
+const LIB_CALLS = new Map<number, string>();
+Object.keys(LibMap).forEach((lib) => {
+    const entry = LibMap[lib];
+    Object.keys(entry.functions).forEach((func) => {
+        LIB_CALLS.set((entry.token << 8) | entry.functions[func], lib + '.' + func);
+    });
+});
+
+function int16(value: number): number {
+    return (value << 16) >> 16;
+}
+
+/**
+ * Returns the name of a library call as '<lib>.<function>' or undefined for unknown calls
+ * @param token - library token
+ * @param func - function byte following the token
+ */
+export function libCallName(token: number, func: number): string | undefined {
+    return LIB_CALLS.get((token << 8) | func);
+}
+
+/**
+ * Estimates the time of a single library call
+ * @param name - call as '<lib>.<function>'
+ * @param costs - cost table of the target device
+ * @param ledcnt - number of LEDs driven by the device
+ */
+export function callCost(name: string, costs: ICostTable, ledcnt: number): number {
+    const call = costs.calls && costs.calls[name];
+    const perLed = costs.perLed && costs.perLed[name];
+    return (call === undefined ? costs.call : call) + (perLed || 0) * ledcnt;
+}
+
+/**
+ * Estimates the time of a single execution of a statement line
+ * @param withDelay - include the time of a constant delay statement
+ */
+function lineCost(code: Uint8Array, tokens: ICodeToken[], costs: ICostTable, ledcnt: number, withDelay = true): number {
+    let cost = tokens.length * costs.token;
+    tokens.forEach((t, index) => {
+        switch (t.token) {
+            case TOKEN.LIB_LED:
+            case TOKEN.LIB_IO:
+            case TOKEN.LIB_MATRIX: {
+                cost += callCost(libCallName(t.token, code[t.offset + 1]) || '', costs, ledcnt);
+                break;
+            }
+            case TOKEN.DELAY: {
+                // only a constant delay can be estimated
+                const value = tokens[index + 1];
+                const following = tokens[index + 2];
+                if (withDelay && value && value.token === TOKEN.VALUE && (!following || following.token === TOKEN.ELSE)) {
+                    cost += Math.max(0, int16(readOperand(code, value.offset))) * 1000;
+                }
+                break;
+            }
+        }
+    });
+    return cost;
+}
+
+/**
+ * Estimates the execution time of a statement line without the time it waits in a delay statement
+ * @param code - code image without the LBO header
+ * @param entry - statement line entry
+ * @param costs - cost table of the target device
+ * @param ledcnt - number of LEDs driven by the device
+ */
+export function statementCost(code: Uint8Array, entry: ICodeEntry, costs: ICostTable, ledcnt: number): number {
+    return lineCost(code, decodeTokens(code, entry), costs, ledcnt, false);
+}
+
+/**
+ * Returns the number of iterations of a FOR loop with constant bounds and step or null
+ */
+function loopIterations(code: Uint8Array, tokens: ICodeToken[]): number | null {
+    // FOR var VALUE TO|DOWNTO VALUE [STEP VALUE]
+    if (tokens.length !== 4 && tokens.length !== 6) {
+        return null;
+    }
+    if (tokens[1].token !== TOKEN.VALUE || tokens[3].token !== TOKEN.VALUE) {
+        return null;
+    }
+    let step = 1;
+    if (tokens.length === 6) {
+        if (tokens[4].token !== TOKEN.STEP || tokens[5].token !== TOKEN.VALUE) {
+            return null;
+        }
+        step = int16(readOperand(code, tokens[5].offset));
+        if (step <= 0) {
+            return null;
+        }
+    }
+    const from = int16(readOperand(code, tokens[1].offset));
+    const to = int16(readOperand(code, tokens[3].offset));
+    const distance = tokens[2].token === TOKEN.TO ? to - from : from - to;
+    // the body is executed at least once
+    return Math.max(1, Math.floor(distance / step) + 1);
+}
+
+/**
+ * Estimates the execution time of each statement line, label block and FOR loop of a code image.
+ * Jumps are not followed, blocks and loops are estimated as straight-line code.
+ * @param code - code image without the LBO header
+ * @param config - configuration from the code, provides the frame rate
+ * @param costs - cost table of the target device
+ * @param ledcnt - number of LEDs driven by the device
+ */
+export function estimateCosts(code: Uint8Array, config: IConfig, costs: ICostTable, ledcnt: number): ICostReport {
+    const frameRate = config.frame_rate || DEFAULT_FRAME_RATE;
+    const report: ICostReport = {
+        calibrated: !!costs.calibrated,
+        frameRate,
+        frameBudget: Math.round(1000000 / frameRate),
+        ledcnt,
+        lines: [],
+        blocks: [],
+        loops: []
+    };
+
+    const loops: IOpenLoop[] = [];
+    let block: IBlockCost | null = null;
+
+    function add(cost: number, target: IBlockCost | null) {
+        if (loops.length) {
+            loops[loops.length - 1].body += cost;
+        } else if (target) {
+            target.cost += cost;
+        }
+    }
+
+    function newBlock(label: number | null): IBlockCost {
+        const result = { label, line: 0, cost: 0, overBudget: false };
+        report.blocks.push(result);
+        return result;
+    }
+
+    decodeEntries(code).forEach((entry: ICodeEntry) => {
+        if (entry.kind === ENTRY.LABEL) {
+            block = newBlock(entry.number);
+            return;
+        }
+        // data lines are never executed
+        if (entry.kind === ENTRY.DATA) {
+            return;
+        }
+
+        const tokens = decodeTokens(code, entry);
+        const cost = lineCost(code, tokens, costs, ledcnt);
+        report.lines.push({ line: entry.number, cost });
+        if (!block) {
+            block = newBlock(null);
+        }
+        if (!block.line) {
+            block.line = entry.number;
+        }
+
+        const first = tokens[0];
+        if (first.token === TOKEN.FOR) {
+            loops.push({
+                variable: code[first.offset + 1],
+                line: entry.number,
+                iterations: loopIterations(code, tokens),
+                head: cost,
+                body: 0,
+                block
+            });
+            return;
+        }
+
+        const index = first.token === TOKEN.NEXT ? loops.map((l) => l.variable).lastIndexOf(code[first.offset + 1]) : -1;
+        if (index < 0) {
+            add(cost, block);
+            return;
+        }
+
+        // NEXT closes the innermost loop of its variable and all loops opened inside of it
+        const closed = loops.splice(index);
+        for (let i = closed.length - 1; i > 0; i--) {
+            closed[i - 1].body += closed[i].head + closed[i].body;
+        }
+        const loop = closed[0];
+        const bodyCost = loop.body + cost;
+        const total = loop.head + (loop.iterations === null ? 1 : loop.iterations) * bodyCost;
+        report.loops.push({
+            line: loop.line,
+            endLine: entry.number,
+            iterations: loop.iterations,
+            bodyCost,
+            cost: total,
+            overBudget: total > report.frameBudget
+        });
+        add(total, loop.block);
+    });
+
+    // loops without NEXT are counted once
+    while (loops.length) {
+        const loop = loops.pop() as IOpenLoop;
+        add(loop.head + loop.body, loop.block);
+    }
+
+    report.blocks.forEach((b) => b.overBudget = b.cost > report.frameBudget);
+    report.loops.sort((a, b) => a.line - b.line);
+    return report;
+}
+
+/**
+ * Formats an estimated time in microseconds for display
+ * @param cost - time in microseconds
+ */
+export function formatCost(cost: number): string {
+    if (cost < 1000) {
+        return Math.round(cost) + ' µs';
+    } else if (cost < 1000000) {
+        return (cost / 1000).toFixed(1) + ' ms';
+    }
+    return (cost / 1000000).toFixed(2) + ' s';
+}
@@ -1,7 +1,7 @@
 'use strict';
 
 import { QuickPickItem } from 'vscode';
-import { ICommand, IDevice, IMetaData } from './Common';
+import { ICommand, ICostTable, IDevice, IMetaData } from './Common';
 
 /**
  * Device structure used for selection
@@ -13,6 +13,7 @@ export class Device implements QuickPickItem, IDevice {
         sysCode: 0
     };
     public commands!: ICommand[];
+    public costs?: ICostTable;
 
     constructor(name: string) {
         this.label = name;
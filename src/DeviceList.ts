@@ -0,0 +1,409 @@
+'use strict';
+
+import { ICallError, ICallSite, ICommand, ICostTable, IDevice } from './Common';
+import { Device } from './Device';
+
+// system code reported by the SB-Prog adapter, the type of the board behind it is checked during the upload
+export const SBPROG_SYSCODE = 0x4470;
+
+const CMD_LED_BASIC = [dev('setled', 2), dev('setall', 1)];
+const CMD_LED_PWM = [dev('show'), dev('lrgb', 4), dev('lhsv', 4), dev('irgb', 4), dev('ihsv', 4), dev('iled', 2), dev('iall', 1), dev('irange', 3), dev('rainbow', 6), dev('copy', 2), dev('repeat', 3), dev('shift', 3), dev('mirror', 3), dev('blackout')];
+const CMD_LED_BRIGHT = [dev('bright', 1)];
+const CMD_IO_KEY = [dev('waitkey'), dev('getkey'), dev('keystate')];
+const CMD_IO_RTC = [dev('getrtc', 1), dev('setrtc', 2)];
+const CMD_IO_LDR = [dev('getldr')];
+const CMD_IO_IR = [dev('getir')];
+const CMD_IO_PORT_CLR = [dev('clrport', 1)];
+const CMD_IO_PORT = [...CMD_IO_PORT_CLR, dev('setport', 1)];
+const CMD_IO_POTI = [dev('getpoti', 1)];
+const CMD_IO_ADC = [dev('getadc', 1)];
+const CMD_IO_TEMP = [dev('gettemp')];
+const CMD_IO_XTEMP = [dev('xtempcnt'), dev('xtempval', 2)];
+const CMD_IO_SOUND = [dev('beep', 1)];
+const CMD_IO_ENC = [dev('getenc'), dev('setenc', 3)];
+const CMD_IO_EEP = [dev('eeread', 1), dev('eewrite', 2)];
+const CMD_IO_SYS = [dev('sys', 2)];
+const CMD_IO_BT = [dev('bt', 2)];
+const CMD_LED_UPDATE = [dev('update')];
+const CMD_LED_SEG = [dev('clear'), dev('pchar', 2), dev('achar', 4), dev('praw', 2), dev('araw', 4), dev('adp', 1), dev('phex', 3), dev('pdez', 4), ...CMD_LED_UPDATE];
+const CMD_MATRIX = [dev('setxy', 3), dev('line', 5), dev('rect', 6), dev('circle', 5), dev('shift', 2), dev('setfont', 1), dev('char', 4), dev('pic', 2)];
+
+/**
+ * Estimated times of library calls in microseconds, used by the static cost analysis. The transfer
+ * of the LED buffer dominates, so calls updating the LEDs are listed per LED as well. The times are
+ * rough guesses, not measured on a device, so the cost tables are not marked as calibrated.
+ */
+const CALL_COSTS = {
+    'led.show': 50,
+    'led.blackout': 50,
+    'led.update': 200,
+    'led.rainbow': 20,
+    'io.waitkey': 0,
+    'io.getrtc': 100,
+    'io.setrtc': 200,
+    'io.gettemp': 100,
+    'io.xtempval': 1000,
+    'io.eeread': 50,
+    'io.eewrite': 5000,
+    'matrix.line': 100,
+    'matrix.rect': 150,
+    'matrix.circle': 200,
+    'matrix.char': 100,
+    'matrix.pic': 300
+};
+const PER_LED_COSTS = {
+    'led.show': 30,
+    'led.blackout': 30,
+    'led.setall': 1,
+    'led.iall': 0.5,
+    'led.irange': 0.5,
+    'led.rainbow': 2,
+    'led.copy': 0.5,
+    'led.repeat': 0.5,
+    'led.shift': 0.5,
+    'led.mirror': 0.5
+};
+// Cortex-M0 controllers programmed through the SB-Prog adapter
+const COST_SBPROG: ICostTable = {
+    token: 8,
+    call: 20,
+    calls: CALL_COSTS,
+    perLed: PER_LED_COSTS
+};
+const COST_DEFAULT: ICostTable = {
+    token: 4,
+    call: 10,
+    calls: CALL_COSTS,
+    perLed: PER_LED_COSTS
+};
+
+/**
+ * List of known/supported devices
+ */
+export const DEVICES: Device[] = [
+    {
+        label: 'LED-Badge (12 LEDs)',
+        detail: 'Cell coin powered badge with 12 RGB-LEDs without PWM.',
+        commands: CMD_LED_BASIC,
+        costs: COST_SBPROG,
+        meta: {
+            sysCode: 0x3110,
+            ledcnt: 12,
+            needsSbProg: true,
+            noPrint: true
+        }
+    },
+    {
+        label: 'LED-Badge (16 LEDs)',
+        detail: 'Cell coin powered badge with a button and 16 RGB-LEDs without PWM.',
+        commands: commands(CMD_LED_BASIC, CMD_IO_KEY, CMD_IO_PORT_CLR),
+        costs: COST_SBPROG,
+        meta: {
+            sysCode: 0x3120,
+            ledcnt: 16,
+            needsSbProg: true
+        }
+    },
+    {
+        label: 'Basic-Pentagon-Board',
+        detail: 'Supports PWM LEDs, DS18B20 temp. sensor, RTC, LDR. 3 buttons on board.',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_IR, CMD_IO_PORT, CMD_IO_TEMP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3130
+        }
+    },
+    {
+        label: 'Basic-Budget-Board',
+        detail: 'Supports PWM LEDs, DS18B20 temp. sensor, RTC, LDR, buttons',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_IR, CMD_IO_PORT, CMD_IO_TEMP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3130
+        }
+    },
+    {
+        label: 'Cronios 1',
+        detail: 'Basis module for LED clocks',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_SOUND, CMD_IO_ENC, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3140
+        }
+    },
+    {
+        label: 'Cronios-Segmenta',
+        detail: 'Clock module based on 7-segment digits',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_PORT, CMD_IO_TEMP, CMD_IO_SOUND, CMD_IO_EEP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3150
+        }
+    },
+    {
+        label: 'Basic-Booster',
+        detail: 'Compact module for WS2812 compatible LEDs',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT, CMD_IO_IR),
+        costs: COST_SBPROG,
+        meta: {
+            sysCode: 0x3160,
+            needsSbProg: true
+        }
+    },
+    {
+        label: 'Cortex-Clock',
+        detail: 'Single colour 4 digits display.',
+        commands: commands(CMD_LED_SEG, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_SOUND, CMD_IO_EEP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3170,
+            ledcnt: 0
+        }
+    },
+    {
+        label: 'Temperature-Sensor Interface',
+        detail: 'Supports up to 8 DS18B20 temp sensors.',
+        commands: commands(CMD_IO_XTEMP, CMD_IO_PORT),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3180,
+            ledcnt: 0
+        }
+    },
+    {
+        label: 'Running Light with 16 LEDs',
+        detail: 'Supports up to 16 single colour LEDs.',
+        commands: commands(CMD_LED_BASIC, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT, CMD_IO_POTI, CMD_IO_EEP),
+        costs: COST_SBPROG,
+        meta: {
+            sysCode: 0x3190,
+            default_ledcnt: 16,
+            needsSbProg: true
+        }
+    },
+    {
+        label: 'All-In-One Power-M4-Board',
+        detail: 'Powerfull board with many supported features.',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_IR, CMD_IO_ENC, CMD_IO_PORT, CMD_IO_TEMP, CMD_IO_SOUND, CMD_IO_EEP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3210,
+            default_ledcnt: 1024,
+            spi_rate: 0x04
+        }
+    },
+    {
+        label: 'LED-Box',
+        detail: 'Ready to use package with controller, IR RC and LED stripe.',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_LDR, CMD_IO_IR, CMD_IO_PORT, CMD_IO_EEP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3220
+        }
+    },
+    {
+        label: 'APA Booster',
+        detail: 'Compact module for APA102 comaptible LEDs.',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT),
+        costs: COST_SBPROG,
+        meta: {
+            sysCode: 0x3230,
+            needsSbProg: true
+        }
+    },
+    {
+        label: 'RC-Box',
+        detail: 'Module with RF remote control support.',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT, CMD_IO_ADC, CMD_IO_IR, CMD_IO_EEP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3240
+        }
+    },
+    {
+        label: 'Touch-Lamp',
+        detail: 'Baseboard for a LED lamp.',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT, CMD_IO_IR, CMD_IO_EEP),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3270,
+            ledcnt: 8
+        }
+    },
+    {
+        label: 'LED-Tube-Clock',
+        detail: '8-digit clock with 7-segment LED displays in VFD tube design.',
+        commands: commands(CMD_LED_SEG, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_SOUND, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3300,
+            ledcnt: 0
+        }
+    },
+    {
+        label: 'NixieCron - Cronios 2',
+        detail: 'Imporved basis module for LED clocks',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_SOUND, CMD_IO_ENC, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3350
+        }
+    },
+    {
+        label: 'NixieCron - Cronios 3',
+        detail: 'Imporved basis module for LED clocks playing own sound files',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_SOUND, CMD_IO_ENC, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3400
+        }
+    },
+    {
+        label: 'NixieCron - LED-Nixie-M4',
+        detail: 'LED clock module with support of 4 digits',
+        commands: commands(CMD_LED_PWM, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_SOUND, CMD_IO_ENC, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3320
+        }
+    },
+    {
+        label: 'NixiCron - LED-Tube-Clock',
+        detail: '8-digit clock with 7-segment LED displays in VFD tube design with integrated DS3231',
+        commands: commands(CMD_LED_SEG, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_SOUND, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3300,
+            ledcnt: 0
+        }
+    },
+    {
+        label: 'NixieCron - Flame-Clock',
+        detail: 'LED-Matrix-Display for displaying a flame, time etc.',
+        commands: commands(CMD_LED_BASIC, CMD_MATRIX, CMD_LED_UPDATE, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_SOUND, CMD_IO_LDR, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3390
+        }
+    },
+    {
+        label: 'NixieCron - Matrix- and Segment-Tube-Clock',
+        detail: 'LED-Matrix-Display for displaying a flame, time etc.',
+        commands: commands(CMD_LED_PWM, CMD_MATRIX, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_SOUND, CMD_IO_LDR, CMD_IO_ENC, CMD_IO_EEP, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3410
+        }
+    },
+    {
+        label: 'LED-BASIC-PICO',
+        detail: 'Tiny breadboard friendly base module',
+        commands: commands(CMD_LED_PWM, CMD_LED_SEG, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT, CMD_IO_ADC, CMD_IO_IR, CMD_IO_ENC, CMD_IO_TEMP, CMD_IO_SOUND, CMD_IO_EEP, CMD_IO_RTC, CMD_IO_SYS),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3370,
+            ledcnt: 64
+        }
+    },
+    {
+        label: 'Chronios-Bluetooth',
+        detail: 'Chronios clock module with Bluetooth support',
+        commands: commands(CMD_LED_PWM, CMD_IO_KEY, CMD_IO_RTC, CMD_IO_LDR, CMD_IO_TEMP, CMD_IO_SOUND, CMD_IO_EEP, CMD_IO_SYS, CMD_IO_BT),
+        costs: COST_DEFAULT,
+        meta: {
+            sysCode: 0x3420
+        }
+    },
+    /*
+    {
+        label: 'LED-BASIC-PICO2',
+        detail: 'Improved version of the PICO base module',
+        commands: commands(CMD_LED_PWM, CMD_LED_SEG, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT, CMD_IO_ADC, CMD_IO_IR, CMD_IO_ENC, CMD_IO_TEMP, CMD_IO_SOUND, CMD_IO_EEP, CMD_IO_RTC, CMD_IO_SYS),
+        meta: {
+            sysCode: 0x3430,
+            ledcnt: 512
+        }
+    },
+    {
+        label: 'PICO2 Running Light',
+        detail: 'RGB running light module based on PICO2',
+        commands: commands(CMD_LED_PWM, CMD_LED_SEG, CMD_LED_BRIGHT, CMD_IO_KEY, CMD_IO_PORT, CMD_IO_ADC, CMD_IO_IR, CMD_IO_ENC, CMD_IO_TEMP, CMD_IO_SOUND, CMD_IO_EEP, CMD_IO_RTC, CMD_IO_SYS),
+        meta: {
+            sysCode: 0x3430, // ???
+            ledcnt: 512
+        }
+    }
+    */
+];
+
+// device selected when no device is connected
+export const DEFAULT_DEVICE = DEVICES[2];
+
+// command lookup tables of the devices, created on first use
+const commandTables = new WeakMap<IDevice, Map<string, ICommand>>();
+
+/**
+ * Returns the commands of a device by name. A name used by several libraries, e.g. shift, maps to
+ * the command listed first.
+ * @param device - target device
+ */
+export function commandTable(device: IDevice): Map<string, ICommand> {
+    let table = commandTables.get(device);
+    if (!table) {
+        table = new Map<string, ICommand>();
+        for (const command of device.commands) {
+            if (!table.has(command.name)) {
+                table.set(command.name, command);
+            }
+        }
+        commandTables.set(device, table);
+    }
+    return table;
+}
+
+/**
+ * Checks library calls against the commands of a device and returns the calls the device can't execute
+ * @param calls - library calls of a program
+ * @param device - target device
+ * @param caseInsensitiveCalls - accept function names in any case, see the setting led_basic.caseInsensitiveCalls
+ */
+export function checkCalls(calls: ICallSite[], device: IDevice, caseInsensitiveCalls: boolean): ICallError[] {
+    const commands = commandTable(device);
+    const errors: ICallError[] = [];
+    calls.forEach((call) => {
+        const cmd = commands.get(caseInsensitiveCalls ? call.func.toLowerCase() : call.func);
+        let message: string | null = null;
+        if (!cmd) {
+            message = 'is not supported by current device';
+        } else if (call.args !== cmd.argcount) {
+            message = 'has wrong number of arguments';
+        }
+        if (message) {
+            errors.push({ call, message: 'Command "' + call.lib + '.' + call.func + '" ' + message });
+        }
+    });
+    return errors;
+}
+
+/**
+ * Returns the known device with the system code or undefined
+ * @param sysCode - system code of the device
+ */
+export function findDevice(sysCode: number): Device | undefined {
+    return DEVICES.find((knownDevice: Device) => {
+        return knownDevice.meta.sysCode === sysCode;
+    });
+}
+
+function commands(...groups: ICommand[][]): ICommand[] {
+    const result: ICommand[] = [];
+    groups.forEach((group) => result.push(...group));
+    return result;
+}
+
+function dev(name: string, argcount?: number): ICommand {
+    return {
+        name,
+        argcount: argcount || 0
+    };
+}
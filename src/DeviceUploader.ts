@@ -55,6 +55,6 @@ export class DeviceUploader extends BaseDeviceUploader {
         this.port = this.portFactory.createSerialPort(this.portInfo.name, {
             baudRate: 0x100000 + this.deviceInfo.meta.sysCode
         });
-        return this.port.openForUpload(true, false);
+        return this.port.openForUpload(true, false, this.recorder);
     }
 }
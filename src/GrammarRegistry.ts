@@ -0,0 +1,37 @@
+'use strict';
+
+import * as fs from 'fs';
+import * as ohm from 'ohm-js';
+import * as path from 'path';
+
+const GRAMMAR_EX = 'grammar_ex.ohm';
+// const GRAMMAR = 'grammar.ohm';
+
+/**
+ * Compiles the LED Basic grammar once on first use and shares it between the code tokenizer,
+ * the validator and the formatter. Each of them adds its own semantics.
+ */
+class GrammarRegistry {
+    private grammar: ohm.Grammar | null = null;
+
+    /**
+     * Returns the compiled grammar, compiles it on the first call
+     */
+    public get(): ohm.Grammar {
+        if (!this.grammar) {
+            // resolved from the compiled module, so the grammar is found also without VS Code
+            const file = path.join(__dirname, '..', 'res', GRAMMAR_EX);
+            this.grammar = ohm.grammar(fs.readFileSync(file).toString());
+        }
+        return this.grammar;
+    }
+
+    /**
+     * Compiles the grammar in the background after the current task, e.g. after the extension activation
+     */
+    public preload() {
+        setTimeout(() => this.get(), 0);
+    }
+}
+
+export const grammarRegistry = new GrammarRegistry();
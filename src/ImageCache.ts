@@ -0,0 +1,74 @@
+'use strict';
+
+import { createHash } from 'crypto';
+import { ISerialPortInfo } from './Common';
+
+export const PAGE_SIZE = 256;
+
+/**
+ * Remembers the last image successfully flashed to each device as page hashes. Used to upload
+ * only the pages which changed since the last upload.
+ */
+class ImageCache {
+    private images = new Map<string, string[]>();
+
+    /**
+     * Returns the cache key of the device connected to the port or null if the device can't be identified.
+     * @param portInfo - port of the connected device
+     * @param sysCode - system code of the target device
+     */
+    public key(portInfo: ISerialPortInfo, sysCode: number): string | null {
+        // the serial number of an SB-Prog adapter does not identify the programmed device
+        if (!portInfo.serialNumber || portInfo.sysCode !== sysCode) {
+            return null;
+        }
+        return portInfo.serialNumber + ':' + sysCode.toString(16);
+    }
+
+    /**
+     * Returns the indexes of the pages which differ from the last image flashed to the device
+     * or null if the image of the device is unknown
+     * @param key - cache key of the device
+     * @param data - image to upload
+     */
+    public changedPages(key: string, data: Uint8Array): number[] | null {
+        const hashes = this.images.get(key);
+        if (!hashes) {
+            return null;
+        }
+        const result: number[] = [];
+        pageHashes(data).forEach((hash, index) => {
+            if (hash !== hashes[index]) {
+                result.push(index);
+            }
+        });
+        return result;
+    }
+
+    /**
+     * Stores the image flashed to the device
+     * @param key - cache key of the device
+     * @param data - flashed image
+     */
+    public set(key: string, data: Uint8Array) {
+        this.images.set(key, pageHashes(data));
+    }
+
+    /**
+     * Forgets the image of the device, e.g. if an upload is in progress or failed
+     * @param key - cache key of the device
+     */
+    public invalidate(key: string) {
+        this.images.delete(key);
+    }
+}
+
+function pageHashes(data: Uint8Array): string[] {
+    const result: string[] = [];
+    for (let offset = 0; offset < data.length; offset += PAGE_SIZE) {
+        result.push(createHash('sha1').update(data.subarray(offset, offset + PAGE_SIZE)).digest('hex'));
+    }
+    return result;
+}
+
+export const imageCache = new ImageCache();
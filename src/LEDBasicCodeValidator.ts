@@ -1,7 +1,8 @@
 'use strict';
 
 import { Diagnostic, DiagnosticCollection, DiagnosticSeverity, Position, Range, TextDocument, workspace } from 'vscode';
-import { IError, IRange, IMatchResult } from './Common';
+import { ICallError, IError, IMatchResult, IRange } from './Common';
+import { checkCalls } from './DeviceList';
 import { deviceSelector } from './DeviceSelector';
 import { LEDBasicParserFactory } from './LEDBasicParserFactory';
 
@@ -90,7 +91,7 @@ export class LEDBasicCodeValidator {
 
         const sourceCode = doc.getText();
         const parser = LEDBasicParserFactory.getParser();
-        let matchResult = parser.match(sourceCode);
+        const matchResult = parser.match(sourceCode);
 
         if (!matchResult.success && matchResult.errors) {
             const diagnostics = matchResult.errors.map((error: IError) => {
@@ -99,82 +100,14 @@ export class LEDBasicCodeValidator {
             this.diagnosticCollection.set(doc.uri, diagnostics);
             return false;
         } else {
-            try {
-                matchResult = parser.match(sourceCode);
-            } catch (e) {
-                // tslint:disable-next-line: no-console
-                console.log(e);
-            }
-
             const diagnostics: Diagnostic[] = [];
 
-            if (!matchResult.success && matchResult.errors) {
-                diagnostics.concat(matchResult.errors.map((error: IError) => {
-                    return new Diagnostic(IRange2Range(error.range), error.message, DiagnosticSeverity.Error);
-                }));
-            }
-
-            // check for illegal API usage
-            const currentDevice = deviceSelector.selectedDevice();
-            let line;
-            let m;
-            const reg = new RegExp('((?:IO|LED|MATRIX)\\.([a-zA-Z]+))', 'gim');
-            for (let index = 0; index < doc.lineCount; index++) {
-                line = doc.lineAt(index);
-                // skip line if empty or is a comment
-                if (line.isEmptyOrWhitespace || line.text.trim().startsWith('\'')) {
-                    continue;
-                }
-
-                // tslint:disable-next-line: no-conditional-assignment
-                while (m = reg.exec(line.text)) {
-                    let funcName = m[2];
-                    const config = workspace.getConfiguration('led_basic');
-                    if (config.caseInsensitiveCalls) {
-                        funcName = funcName.toLowerCase();
-                    }
-                    // let args = m[3];
-                    const cmd = currentDevice.commands.find((command) => command.name === funcName);
-                    if (!cmd) {
-                        const start = new Position(index, m.index);
-                        const end = new Position(index, m.index + m[1].length);
-                        const diagnostic = new Diagnostic(new Range(start, end), 'Command "' + m[1] + '" is not supported by current device', DiagnosticSeverity.Error);
-                        diagnostics.push(diagnostic);
-                    } else {
-                        // TODO find a propper regex if possible
-                        // get the arguments
-                        let args = '';
-                        let bs = 0;
-                        let offset = m.index + m[1].length;
-                        let c;
-                        while (offset < line.text.length) {
-                            c = line.text.charAt(offset);
-                            if (c !== '(' && bs === 0) {
-                                break;
-                            }
-                            if (c === '(') {
-                                bs++;
-                            } else if (c === ')') {
-                                bs--;
-                            }
-                            args += c;
-                            offset++;
-                        }
-                        args = args.substr(1, args.length - 2);
-
-                        // detect if arguments contain a read call
-                        const readCalls = args.split('read ').length - 1;
-                        let ac = args ? args.split(',').length : 0;
-                        ac = ac - readCalls;
-                        if (ac !== cmd.argcount) {
-                            const start = new Position(index, m.index);
-                            const end = new Position(index, m.index + m[1].length);
-                            const diagnostic = new Diagnostic(new Range(start, end), 'Command "' + m[1] + '" has wrong number of arguments', DiagnosticSeverity.Error);
-                            diagnostics.push(diagnostic);
-                        }
-                    }
-                }
-            }
+            // check for illegal API usage, the library calls are collected from the parse tree of the match
+            const caseInsensitiveCalls = workspace.getConfiguration('led_basic').caseInsensitiveCalls;
+            checkCalls(matchResult.calls || [], deviceSelector.selectedDevice(), caseInsensitiveCalls).forEach((error: ICallError) => {
+                const range = new Range(doc.positionAt(error.call.start), doc.positionAt(error.call.end));
+                diagnostics.push(new Diagnostic(range, error.message, DiagnosticSeverity.Error));
+            });
 
             if (diagnostics.length) {
                 this.diagnosticCollection.set(doc.uri, diagnostics);
@@ -1,12 +1,13 @@
 'use strict';
 
 import { CancellationToken, CompletionContext, CompletionItem, CompletionItemProvider, Position, ProviderResult, TextDocument } from 'vscode';
+import { commandTable } from './DeviceList';
 import { deviceSelector } from './DeviceSelector';
 import { API } from './LEDBasicAPI';
 
 export class LEDBasicCompletionItemProvider implements CompletionItemProvider {
     public provideCompletionItems(document: TextDocument, position: Position, token: CancellationToken, context: CompletionContext): ProviderResult<CompletionItem[]> {
-        const commands = deviceSelector.selectedDevice().commands;
+        const commands = commandTable(deviceSelector.selectedDevice());
         const lineText = document.lineAt(position.line).text;
         const lineTillCurrentPosition = lineText.substr(0, position.character);
         const parts = /([a-zA-Z]+).(\w*)$/g.exec(lineTillCurrentPosition);
@@ -16,7 +17,7 @@ export class LEDBasicCompletionItemProvider implements CompletionItemProvider {
             const lib = API[libName];
             if (lib) {
                 Object.keys(lib).forEach((func) => {
-                    if (commands.find((cmd) => cmd.name === func)) {
+                    if (commands.has(func)) {
                         result.push(new CompletionItem(func));
                     }
                 });
@@ -0,0 +1,65 @@
+'use strict';
+
+import { TextDocument, workspace } from 'vscode';
+import { getLedCount, IParseResult } from './Common';
+import { estimateCosts, ICostReport } from './CostEstimator';
+import { deviceSelector } from './DeviceSelector';
+import { LEDBasicParserFactory } from './LEDBasicParserFactory';
+
+interface ICachedReport {
+    version: number;
+    sysCode: number;
+    report: ICostReport | null;
+}
+
+/**
+ * Provides the estimated execution costs of a document for the currently selected device.
+ * Reports are cached until the document changes or another device is selected.
+ */
+class LEDBasicCostAnalyzer {
+    private cache = new Map<string, ICachedReport>();
+
+    /**
+     * Returns the cost report of the document or null if the code can't be compiled
+     * @param document - LED Basic document
+     */
+    public analyze(document: TextDocument): ICostReport | null {
+        const device = deviceSelector.selectedDevice();
+        const key = document.uri.toString();
+        const cached = this.cache.get(key);
+        if (cached && cached.version === document.version && cached.sysCode === device.meta.sysCode) {
+            return cached.report;
+        }
+
+        let report: ICostReport | null = null;
+        if (device.costs) {
+            // compile with the same options as the upload to get the same code
+            const config = workspace.getConfiguration('led_basic');
+            const result = LEDBasicParserFactory.getParser().build(document.getText(), {
+                optimize: config.optimizeCode,
+                removeDeadCode: config.optimizeCode
+            });
+            if (result.success) {
+                const parseResult = result as IParseResult;
+                report = estimateCosts(parseResult.code, parseResult.config, device.costs, getLedCount(parseResult.config, device.meta));
+            }
+        }
+
+        this.cache.set(key, {
+            version: document.version,
+            sysCode: device.meta.sysCode,
+            report
+        });
+        return report;
+    }
+
+    /**
+     * Removes the cached report of a closed document
+     * @param document - LED Basic document
+     */
+    public forget(document: TextDocument) {
+        this.cache.delete(document.uri.toString());
+    }
+}
+
+export const costAnalyzer = new LEDBasicCostAnalyzer();
@@ -1,51 +1,130 @@
 'use strict';
 
-import * as fs from 'fs';
 import * as ohm from 'ohm-js';
-import { getExtensionPath } from './utils';
+import { grammarRegistry } from './GrammarRegistry';
 
-import { CancellationToken, DocumentFormattingEditProvider, FormattingOptions, TextDocument, TextEdit } from 'vscode';
-
-const GRAMMAR_EX = 'grammar_ex.ohm';
-// const GRAMMAR = 'grammar.ohm';
+import {
+    CancellationToken, DocumentFormattingEditProvider, DocumentRangeFormattingEditProvider, FormattingOptions,
+    OnTypeFormattingEditProvider, Position, Range, TextDocument, TextEdit
+} from 'vscode';
 
 let gOptions!: FormattingOptions;
 
-export class LEDBasicDocumentFormatter implements DocumentFormattingEditProvider {
-    private grammar: ohm.Grammar;
-    private semantics: ohm.Semantics;
+interface IFormatCache {
+    // text of the last parsed document version
+    text: string;
+    version: number;
+    // incremental matcher keeping the memoized parse of the last version
+    matcher: any;
+    tabSize: number;
+    // formatted lines of the last version, null if the code can't be parsed
+    lines: string[] | null;
+}
 
-    constructor() {
-        const path = getExtensionPath() + 'res/' + GRAMMAR_EX;
-        const grammar = fs.readFileSync(path).toString();
+export class LEDBasicDocumentFormatter implements DocumentFormattingEditProvider, DocumentRangeFormattingEditProvider, OnTypeFormattingEditProvider {
+    // created on first use to keep the grammar compilation out of the extension activation
+    private semantics: ohm.Semantics | null = null;
+    private cache = new Map<string, IFormatCache>();
 
-        this.grammar = ohm.grammar(grammar);
-        this.semantics = this.createSemantics();
+    public provideDocumentFormattingEdits(document: TextDocument, options: FormattingOptions, token: CancellationToken): TextEdit[] | Thenable<TextEdit[] | null | undefined> | null | undefined {
+        return this.createEdits(document, options, 0, document.lineCount - 1);
     }
 
-    public provideDocumentFormattingEdits(document: TextDocument, options: FormattingOptions, token: CancellationToken): TextEdit[] | Thenable<TextEdit[] | null | undefined> | null | undefined {
-        const result: TextEdit[] = [];
+    public provideDocumentRangeFormattingEdits(document: TextDocument, range: Range, options: FormattingOptions, token: CancellationToken): TextEdit[] | null {
+        return this.createEdits(document, options, range.start.line, range.end.line);
+    }
 
-        gOptions = options;
+    /**
+     * Formats the line completed with the enter key
+     */
+    public provideOnTypeFormattingEdits(document: TextDocument, position: Position, ch: string, options: FormattingOptions, token: CancellationToken): TextEdit[] | null {
+        if (position.line === 0) {
+            return null;
+        }
+        return this.createEdits(document, options, position.line - 1, position.line - 1);
+    }
 
-        const code = document.getText();
-        const formCode: string[] = this.semantics(this.grammar.match(code)).eval();
+    /**
+     * Removes the cached parse of a closed document
+     * @param document - LED Basic document
+     */
+    public forget(document: TextDocument) {
+        this.cache.delete(document.uri.toString());
+    }
 
-        for (let index = 0; index < document.lineCount; index++) {
+    /**
+     * Creates edits for the lines in the provided range which differ from the formatted code
+     */
+    private createEdits(document: TextDocument, options: FormattingOptions, startLine: number, endLine: number): TextEdit[] {
+        const result: TextEdit[] = [];
+        const formCode = this.format(document, options);
+        if (!formCode) {
+            return result;
+        }
+
+        for (let index = startLine; index <= endLine; index++) {
             const line = document.lineAt(index);
             const formattedLine = formCode[index];
-            if (line.text && line.text !== formattedLine) {
+            if (line.text && formattedLine !== undefined && line.text !== formattedLine) {
                 result.push(TextEdit.replace(line.range, formattedLine));
             }
         }
         return result;
     }
 
+    /**
+     * Returns the formatted lines of the document or null if the code has syntax errors. The parse of the
+     * previous version is reused, only the part of the text which changed since then is parsed again.
+     */
+    private format(document: TextDocument, options: FormattingOptions): string[] | null {
+        const key = document.uri.toString();
+        const text = document.getText();
+        let entry = this.cache.get(key);
+
+        if (entry && entry.version === document.version && entry.tabSize === options.tabSize) {
+            return entry.lines;
+        }
+
+        if (!entry) {
+            const matcher = grammarRegistry.get().matcher();
+            matcher.setInput(text);
+            entry = { text, version: document.version, matcher, tabSize: options.tabSize, lines: null };
+            this.cache.set(key, entry);
+        } else if (entry.text !== text) {
+            let prefix = 0;
+            const maxLength = Math.min(entry.text.length, text.length);
+            while (prefix < maxLength && entry.text.charCodeAt(prefix) === text.charCodeAt(prefix)) {
+                prefix++;
+            }
+            let suffix = 0;
+            while (suffix < maxLength - prefix
+                && entry.text.charCodeAt(entry.text.length - 1 - suffix) === text.charCodeAt(text.length - 1 - suffix)) {
+                suffix++;
+            }
+            entry.matcher.replaceInputRange(prefix, entry.text.length - suffix, text.substring(prefix, text.length - suffix));
+            entry.text = text;
+        }
+        entry.version = document.version;
+        entry.tabSize = options.tabSize;
+
+        const match = entry.matcher.match();
+        if (match.failed()) {
+            entry.lines = null;
+        } else {
+            gOptions = options;
+            if (!this.semantics) {
+                this.semantics = this.createSemantics();
+            }
+            entry.lines = this.semantics(match).eval();
+        }
+        return entry.lines;
+    }
+
     /**
      * Build local semantics for generating tokenized output for the target device
      */
     private createSemantics() {
-        const result = this.grammar.createSemantics();
+        const result = grammarRegistry.get().createSemantics();
         let deep = 0;
         let goDeeper = false;
 
@@ -1,7 +1,7 @@
 'use strict';
 // tslint:disable: no-bitwise
 
-import { COLOUR_ORDER, IConfig, IError, IEvalOperation, IJumpTable, IMatchResult, IOperationList, LibMap } from './Common';
+import { COLOUR_ORDER, findLibCall, IConfig, IError, IEvalOperation, IJumpTable, IMatchResult, IOperationList } from './Common';
 
 let JumpTable: IJumpTable = {};
 let lineNumber = 0;
@@ -662,8 +662,11 @@ export const operation: IEvalOperation = {
     LibCall(libName, dot, funcName, leftBr, params, rightBr) {
         const paramsEv = params.eval();
         const result = new Uint8Array(paramsEv.value.length + 2);
-        result[0] = LibMap[libName.sourceString.toLowerCase()].token;
-        result[1] = LibMap[libName.sourceString.toLowerCase()].functions[funcName.sourceString.toLowerCase()];
+        const call = findLibCall((libName.sourceString + '.' + funcName.sourceString).toLowerCase());
+        if (call) {
+            result[0] = call.token;
+            result[1] = call.func;
+        }
         result.set(paramsEv.value, 2);
 
         return {
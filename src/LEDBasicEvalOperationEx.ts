@@ -1,19 +1,156 @@
 'use strict';
 // tslint:disable: no-bitwise
 
-import { COLOUR_ORDER, IConfig, IError, IEvalOperation, IJumpTable, IMatchResult, IOperationList, LibMap } from './Common';
+import { COLOUR_ORDER, findLibCall, ICompileOptions, IConfig, IError, IEvalOperation, IMatchResult, IOperationList, IRemovedCode } from './Common';
 // import { dump } from './utils';
 
 const DEBUG_STRICT = false;
 
-let JumpTable: IJumpTable = {};
+// label numbers are 15 bit values, the highest bit marks a label reference in the token stream
+const MAX_LABEL = 0x7FFE;
+const NO_ADDRESS = -1;
+// variable slots of the device interpreter, the variables a to z of the original LED Basic
+const MAX_VARIABLES = 26;
+
+// dense jump table indexed by the label number, holds the code offset of the label or NO_ADDRESS
+const labelAddresses = new Int32Array(MAX_LABEL + 1).fill(NO_ADDRESS);
 let lineNumber = 0;
 let labelIdCounter = 1000;
 let variableIdCounter = 0;
 let errors: IError[] = [];
 
-const labelsMap: { [label: string]: number; } = {};
-const variablesMap: { [label: string]: number; } = {};
+let labelsMap: { [label: string]: number; } = {};
+let variablesMap: { [label: string]: number; } = {};
+
+let compileOptions: ICompileOptions = {};
+// target label of labels whose first statement is an unconditional goto, used to shorten goto chains
+const labelGotos = new Int32Array(MAX_LABEL + 1).fill(NO_ADDRESS);
+
+/**
+ * Label operand of a goto, gosub or read, patched with the label address after all lines are emitted
+ */
+interface ILabelRef {
+    // offset of the 16 bit operand in the value
+    pos: number;
+    label: number;
+    // label as written in the source code
+    name: string;
+    isRead: boolean;
+}
+
+interface IEvalResult {
+    type: string;
+    value: Uint8Array;
+    // label operands contained in the value
+    refs?: ILabelRef[];
+}
+
+/**
+ * Copies the code of an operand into the value of a statement or expression and takes over its label operands
+ * @param result - value of the statement or expression
+ * @param refs - label operands of the statement or expression
+ * @param part - evaluated operand
+ * @param pos - position of the operand in the value
+ */
+function place(result: Uint8Array, refs: ILabelRef[], part: IEvalResult, pos: number) {
+    result.set(part.value, pos);
+    if (part.refs) {
+        for (const ref of part.refs) {
+            refs.push({ pos: ref.pos + pos, label: ref.label, name: ref.name, isRead: ref.isRead });
+        }
+    }
+}
+
+/**
+ * Sets the options for the next compilation
+ * @param options - compile options
+ */
+export function setCompileOptions(options: ICompileOptions) {
+    compileOptions = options;
+}
+
+function constantOf(ev: IEvalResult): number | null {
+    if (ev.type !== 'value') {
+        return null;
+    }
+    return ((ev.value[1] | (ev.value[2] << 8)) << 16) >> 16;
+}
+
+function constantResult(num: number): IEvalResult {
+    const result = new Uint8Array(3);
+    result[0] = 0x88;
+    new DataView(result.buffer).setInt16(1, num, true);
+    return {
+        type: 'value',
+        value: result
+    };
+}
+
+/**
+ * Tries to replace a binary operation by a constant or by one of its operands. Only results that fit into
+ * the 16 bit device arithmetic are folded, division by zero is left for the device to report.
+ * @param left - evaluated left operand
+ * @param op - operation token
+ * @param right - evaluated right operand
+ */
+function foldBinary(left: IEvalResult, op: number, right: IEvalResult): IEvalResult | null {
+    if (!compileOptions.optimize) {
+        return null;
+    }
+
+    const l = constantOf(left);
+    const r = constantOf(right);
+
+    if (l !== null && r !== null) {
+        let num: number;
+        switch (op) {
+            case 0x9D: num = l + r; break;
+            case 0x9E: num = l - r; break;
+            case 0xA1: num = l * r; break;
+            case 0xA2: num = r === 0 ? NaN : Math.trunc(l / r); break;
+            case 0xA3: num = r === 0 ? NaN : l % r; break;
+            case 0x9F: num = l & r; break;
+            case 0xA0: num = l | r; break;
+            default: return null;
+        }
+        if (isNaN(num) || num < -0x8000 || num > 0x7FFF) {
+            return null;
+        }
+        return constantResult(num);
+    }
+
+    // identities, the remaining operand keeps its side effects
+    if (r === 0 && (op === 0x9D || op === 0x9E || op === 0xA0)) {
+        return left;
+    }
+    if (l === 0 && (op === 0x9D || op === 0xA0)) {
+        return right;
+    }
+    if (r === 1 && (op === 0xA1 || op === 0xA2)) {
+        return left;
+    }
+    if (l === 1 && op === 0xA1) {
+        return right;
+    }
+    return null;
+}
+
+function binaryExpression(type: string, left: IEvalResult, op: number, right: IEvalResult): IEvalResult {
+    const folded = foldBinary(left, op, right);
+    if (folded) {
+        return folded;
+    }
+    const result = new Uint8Array(left.value.length + right.value.length + 1);
+    const refs: ILabelRef[] = [];
+    place(result, refs, left, 0);
+    result[left.value.length] = op;
+    place(result, refs, right, left.value.length + 1);
+    return {
+        type,
+        value: result,
+        refs
+    };
+}
 
 function getLabel() {
     let labelId = labelIdCounter;
@@ -24,6 +161,134 @@ function getLabel() {
     return labelId;
 }
 
+/**
+ * Returns the label number for a label literal. Named labels get a generated number on first use,
+ * so forward references to them resolve to the same number as the later definition.
+ * @param literal - label as written in the source code
+ */
+function getLabelId(literal: string) {
+    let label = parseInt(literal, 10);
+    if (isNaN(label)) {
+        label = labelsMap[literal];
+        if (label === undefined) {
+            label = getLabel();
+            labelsMap[literal] = label;
+        }
+    }
+
+    if (label > MAX_LABEL) {
+        throw new Error('Label value to big. Max number allowed: 32766');
+    }
+    return label;
+}
+
+const KEEP = 0;
+const UNREACHABLE = 1;
+const UNUSED_LABEL = 2;
+const UNUSED_DATA = 3;
+const REMOVE_REASONS = ['', 'unreachable code', 'unused label', 'unused data'];
+
+interface IBlock {
+    index: number;
+    label: number;
+    lines: number[];
+    // index into lines of the first line after goto, return or end
+    deadFrom: number;
+    reachable: boolean;
+    read: boolean;
+    referenced: boolean;
+}
+
+/**
+ * Finds lines which can be removed from the program. The program is split into blocks starting at
+ * labels, blocks are reachable from the program start by falling through or by goto and gosub, data is
+ * used if a reachable block reads it. Returns a remove reason for every line or null if the label graph
+ * is not valid, in that case the errors are reported by the code generation.
+ * @param progLines - evaluated program lines
+ */
+function findDeadCode(progLines: any[]): Uint8Array | null {
+    const blocks: IBlock[] = [];
+    const blockOfLabel = new Map<number, IBlock>();
+    let block: IBlock = { index: 0, label: NO_ADDRESS, lines: [], deadFrom: -1, reachable: true, read: false, referenced: false };
+    blocks.push(block);
+
+    for (let i = 0; i < progLines.length; i++) {
+        const line = progLines[i];
+        const startLabel = line.type === 'label' ? line.value : (line.type === 'dataline' && line.label ? line.label.value : null);
+        if (startLabel) {
+            const label = (startLabel[0] | (startLabel[1] << 8)) - 0x8000;
+            if (blockOfLabel.has(label)) {
+                return null;
+            }
+            block = { index: blocks.length, label, lines: [], deadFrom: -1, reachable: false, read: false, referenced: false };
+            blocks.push(block);
+            blockOfLabel.set(label, block);
+        }
+        if (line.type === 'emptyline') {
+            continue;
+        }
+        block.lines.push(i);
+        if (block.deadFrom === -1 && (line.type === 'end' || line.type === 'return' || (line.type === 'jump' && line.value[1] === 0x95))) {
+            block.deadFrom = block.lines.length;
+        }
+    }
+
+    // walk the blocks reachable from the program start
+    let valid = true;
+    const queue = [0];
+    while (queue.length) {
+        const index = queue.pop() as number;
+        const current = blocks[index];
+        const end = current.deadFrom === -1 ? current.lines.length : current.deadFrom;
+        for (let j = 0; j < end; j++) {
+            const line = progLines[current.lines[j]];
+            if (line.type === 'label' || line.type === 'dataline') {
+                continue;
+            }
+            for (const ref of line.refs) {
+                const target = blockOfLabel.get(ref.label);
+                if (!target) {
+                    valid = false;
+                    continue;
+                }
+                target.referenced = true;
+                if (ref.isRead) {
+                    target.read = true;
+                } else if (!target.reachable) {
+                    target.reachable = true;
+                    queue.push(target.index);
+                }
+            }
+        }
+        if (current.deadFrom === -1 && index + 1 < blocks.length && !blocks[index + 1].reachable) {
+            blocks[index + 1].reachable = true;
+            queue.push(index + 1);
+        }
+    }
+
+    if (!valid) {
+        return null;
+    }
+
+    const result = new Uint8Array(progLines.length);
+    blocks.forEach((b) => {
+        b.lines.forEach((i, j) => {
+            const type = progLines[i].type;
+            if (b.read) {
+                return;
+            }
+            if (!b.reachable || (b.deadFrom !== -1 && j >= b.deadFrom)) {
+                result[i] = UNREACHABLE;
+            } else if (type === 'dataline') {
+                result[i] = UNUSED_DATA;
+            } else if (type === 'label' && !b.referenced) {
+                result[i] = UNUSED_LABEL;
+            }
+        });
+    });
+    return result;
+}
+
 function getVariable(literal: string) {
     let variableId;
     if (DEBUG_STRICT) {
@@ -37,14 +302,26 @@ function getVariable(literal: string) {
 
 export const operation: IEvalOperation = {
     Program(comments, configLine, lines) {
-        JumpTable = {};
+        labelAddresses.fill(NO_ADDRESS);
+        labelGotos.fill(NO_ADDRESS);
+        labelsMap = {};
+        labelIdCounter = 1000;
+        variablesMap = {};
+        variableIdCounter = 0;
         lineNumber = 1;
         errors = [];
 
         const coms = comments.eval();
         const conf = configLine.eval();
-        const progLines = lines.eval();
-        let len = 0;
+        // line which declares the first variable without a free slot
+        let variableOverflow = -1;
+        const progLines = lines.children.map((child: any, i: number) => {
+            const line = child.eval();
+            if (variableOverflow < 0 && variableIdCounter > MAX_VARIABLES) {
+                variableOverflow = i;
+            }
+            return line;
+        });
         lineNumber += coms.length;
         lineNumber += conf.length;
 
@@ -52,119 +329,83 @@ export const operation: IEvalOperation = {
             return comments.children.length + configLine.children.length + i;
         }
 
-        let isInLabel = false;
-        let hasData = false;
-        let dataLengthPos = 0;
-        // first run, calc final size and create a jump table for labels
-        for (let i = 0; i < progLines.length; i++) {
-            const line = progLines[i];
-            const type = line.type;
-            if (type === 'label') {
-                const label = new DataView(line.value.buffer).getUint16(0, true) - 0x8000;
-                if (JumpTable[label] !== undefined) {
-                    const iLine = getLine(i);
-                    errors.push({
-                        message: 'Label ' + label + ' is already defined',
-                        range: {
-                            start: {
-                                line: iLine,
-                                character: 0
-                            },
-                            end: {
-                                line: iLine,
-                                character: lines.child(i).sourceString.indexOf(':')
-                            }
-                        }
-                    });
-                } else {
-                    JumpTable[label] = len;
+        function addError(i: number, message: string, endChar: number) {
+            const iLine = getLine(i);
+            errors.push({
+                message,
+                range: {
+                    start: {
+                        line: iLine,
+                        character: 0
+                    },
+                    end: {
+                        line: iLine,
+                        character: endChar
+                    }
                 }
+            });
+        }
 
-                isInLabel = true;
-                hasData = false;
-            } else if (type === 'dataline') {
-                if (!isInLabel && !line.label) {
-                    const iLine = getLine(i);
-                    errors.push({
-                        message: 'Data definition is only possible after a label.',
-                        range: {
-                            start: {
-                                line: iLine,
-                                character: 0
-                            },
-                            end: {
-                                line: iLine,
-                                character: lines.child(i).sourceString.length
-                            }
-                        }
-                    });
-                }
+        if (variableOverflow >= 0) {
+            addError(variableOverflow, 'Too many variables, the device has ' + MAX_VARIABLES + ' variables',
+                lines.child(variableOverflow).sourceString.length);
+        }
 
-                if (line.label) {
-                    const label = new DataView(line.label.value.buffer).getUint16(0, true) - 0x8000;
-                    if (JumpTable[label] !== undefined) {
-                        const iLine = getLine(i);
-                        errors.push({
-                            message: 'Label ' + label + ' is already defined',
-                            range: {
-                                start: {
-                                    line: iLine,
-                                    character: 0
-                                },
-                                end: {
-                                    line: iLine,
-                                    character: lines.child(i).sourceString.indexOf(':')
-                                }
-                            }
-                        });
-                    } else {
-                        JumpTable[label] = len;
-                    }
+        const removed: IRemovedCode[] = [];
+        const removeReasons = compileOptions.removeDeadCode ? findDeadCode(progLines) : null;
 
-                    isInLabel = true;
-                    hasData = false;
-                    len += 3; // label bytes length
-                }
+        // the sum of all line values is a good lower bound for the final size, grow if needed
+        let capacity = 2;
+        for (const line of progLines) {
+            capacity += line.value.length + 4;
+        }
+        let result = new Uint8Array(capacity);
+        let dv = new DataView(result.buffer);
+        let len = 0;
 
-                if (!hasData) {
-                    len += 2; // line number
-                    len += 2; // length of all data and data token
-                    hasData = true;
-                }
-            } else if (type === 'return') {
-                if (!isInLabel) {
-                    const iLine = getLine(i);
-                    errors.push({
-                        message: 'return requires a label to return from',
-                        range: {
-                            start: {
-                                line: iLine,
-                                character: 0
-                            },
-                            end: {
-                                line: iLine,
-                                character: lines.child(i).sourceString.length
-                            }
-                        }
-                    });
+        function reserve(size: number) {
+            if (len + size <= result.length) {
+                return;
+            }
+            const grown = new Uint8Array(Math.max(result.length * 2, len + size));
+            grown.set(result.subarray(0, len), 0);
+            result = grown;
+            dv = new DataView(result.buffer);
+        }
+
+        function defineLabel(i: number, labelValue: Uint8Array, name: string) {
+            const label = (labelValue[0] | (labelValue[1] << 8)) - 0x8000;
+            if (labelAddresses[label] !== NO_ADDRESS) {
+                addError(i, 'Label ' + name + ' is already defined', lines.child(i).sourceString.indexOf(':'));
+            } else {
+                labelAddresses[label] = len;
+            }
+        }
 
+        // follows labels starting with an unconditional goto to the final jump target
+        function jumpTarget(label: number) {
+            let target = label;
+            for (let hops = 0; hops <= MAX_LABEL && labelGotos[target] !== NO_ADDRESS; hops++) {
+                if (labelAddresses[labelGotos[target]] === NO_ADDRESS) {
+                    break;
+                }
+                target = labelGotos[target];
+                if (target === label) {
+                    return label; // endless goto loop, keep the original target
                 }
-                len += 2; // line number and length
-            } else if (type !== 'emptyline') {
-                hasData = false;
-                // isInLabel = false;
-                len += 2; // line number and length
             }
-            len += line.value.length;
+            return target;
         }
 
-        const result = new Uint8Array(len + 2); // +2 = 0xFFFF end of stream
-        const dv = new DataView(result.buffer);
+        const fixups: ILabelRef[] = [];
+        const fixupLines: number[] = [];
+        // labels defined since the last statement, back to back labels share the next statement
+        let pendingLabels: number[] = [];
+        let isInLabel = false;
+        let hasData = false;
+        let dataLengthPos = 0;
 
-        len = 0;
-        isInLabel = false;
-        hasData = false;
-        // tslint:disable-next-line: prefer-for-of
+        // single pass: emit code, define labels as they appear and remember label references for backpatching
         for (let i = 0; i < progLines.length; i++) {
             const line = progLines[i];
             const val = line.value;
@@ -176,13 +417,33 @@ export const operation: IEvalOperation = {
                 continue;
             }
 
+            if (removeReasons && removeReasons[i] !== KEEP) {
+                removed.push({
+                    line: getLine(i) + 1,
+                    reason: REMOVE_REASONS[removeReasons[i]]
+                });
+                if (type === 'label') {
+                    isInLabel = true;
+                }
+                lineNumber++;
+                continue;
+            }
+
             if (type === 'dataline') {
+                pendingLabels = [];
+                if (!isInLabel && !label) {
+                    addError(i, 'Data definition is only possible after a label.', lines.child(i).sourceString.length);
+                }
+
                 if (label) {
+                    isInLabel = true;
                     hasData = false;
                 }
 
+                reserve(val.length + 7);
                 if (!hasData) {
                     if (label) {
+                        defineLabel(i, label.value, label.name);
                         result.set(label.value, len);
                         len += label.value.length;
                     }
@@ -200,30 +461,36 @@ export const operation: IEvalOperation = {
                 result.set(val, len);
                 len += val.length;
                 lineNumber++;
-                // console.log(Utils.dump(result));
                 continue;
-            } else if (type === 'label') {
+            }
+
+            reserve(val.length + 2);
+            if (type === 'label') {
+                defineLabel(i, val, line.name);
+                pendingLabels.push((val[0] | (val[1] << 8)) - 0x8000);
+                isInLabel = true;
                 hasData = false;
             } else {
-                // check for jumps and dataread
-                for (let j = 0; j < val.length; j++) {
-                    if ((val[j] === 0x95 || val[j] === 0x96 || val[j] === 0xAF) && j < val.length - 2) {
-                        const locdv = new DataView(val.buffer);
-                        const labelNr = locdv.getUint16(j + 1, true);
-                        if (labelNr & 0x8000) {
-                            let addr = JumpTable[labelNr - 0x8000];
-                            if (addr !== undefined) {
-                                if (val[j] === 0xAF) {
-                                    addr += 5;
-                                }
-                                locdv.setUint16(j + 1, addr, true);
-                            }
-                        }
+                if (type === 'jump' && val[1] === 0x95) {
+                    for (const pending of pendingLabels) {
+                        labelGotos[pending] = (val[2] | (val[3] << 8)) - 0x8000;
                     }
                 }
+                pendingLabels = [];
+
+                if (type === 'return' && !isInLabel) {
+                    addError(i, 'return requires a label to return from', lines.child(i).sourceString.length);
+                }
+                hasData = false;
 
                 dv.setUint16(len, lineNumber, true);
                 len += 2;
+
+                // label operands of jumps and dataread, patched after all labels are defined
+                for (const ref of line.refs) {
+                    fixups.push({ pos: len + ref.pos, label: ref.label, name: ref.name, isRead: ref.isRead });
+                    fixupLines.push(i);
+                }
             }
 
             result.set(val, len);
@@ -231,7 +498,26 @@ export const operation: IEvalOperation = {
             lineNumber++;
         }
 
+        // backpatch all label references now that every label address is known
+        fixups.forEach((fixup, index) => {
+            let addr = labelAddresses[fixup.label];
+            if (compileOptions.optimize && !fixup.isRead && addr !== NO_ADDRESS) {
+                addr = labelAddresses[jumpTarget(fixup.label)];
+            }
+            if (addr === NO_ADDRESS) {
+                const line = fixupLines[index];
+                addError(line, 'Label ' + fixup.name + ' is not defined', lines.child(line).sourceString.length);
+                return;
+            }
+            if (fixup.isRead) {
+                addr += 5;
+            }
+            dv.setUint16(fixup.pos, addr, true);
+        });
+
+        reserve(2);
         result.set([0xFF, 0xFF], len);
+        len += 2;
 
         if (errors.length) {
             const errorResult: IMatchResult = {
@@ -243,8 +529,9 @@ export const operation: IEvalOperation = {
 
         return {
             success: true,
-            code: result,
-            config: conf[0] || {}
+            code: result.slice(0, len),
+            config: conf[0] || {},
+            removed: removeReasons ? removed : undefined
         };
     },
     configLine(a, b, lnbr) {
@@ -297,6 +584,7 @@ export const operation: IEvalOperation = {
     },
     Line(e, comment, eol) {
         let result;
+        const refs: ILabelRef[] = [];
         const ev = e.eval();
         if (ev.type === 'label' || ev.type === 'dataline') {
             result = new Uint8Array(ev.value.length);
@@ -304,13 +592,15 @@ export const operation: IEvalOperation = {
         } else {
             result = new Uint8Array(ev.value.length + 1);
             result[0] = ev.value.length;
-            result.set(ev.value, 1);
+            place(result, refs, ev, 1);
         }
 
         const line = {
             type: ev.type,
             value: result,
-            label: undefined
+            refs,
+            label: undefined,
+            name: ev.name
         };
         if (ev.label) {
             line.label = ev.label;
@@ -320,26 +610,20 @@ export const operation: IEvalOperation = {
     Statement(e) {
         const ev = e.eval();
         const result = new Uint8Array(ev.value.length);
-        result.set(ev.value, 0);
+        const refs: ILabelRef[] = [];
+        place(result, refs, ev, 0);
         return {
             type: ev.type,
-            value: result
+            value: result,
+            refs
         };
     },
     LabelIdentifier(labelLit) {
         return labelLit.sourceString;
     },
     Label(e, colon) {
-        const ev = e.eval();
-        let label = parseInt(ev, 10);
-        if (isNaN(label)) {
-            label = getLabel();
-            labelsMap[ev] = label;
-        }
-
-        if (label > 0x7FFE) {
-            throw new Error('Label value to big. Max number allowed: 32766');
-        }
+        const name = e.eval();
+        const label = getLabelId(name);
 
         const result = new Uint8Array(3);
         const dv = new DataView(result.buffer);
@@ -349,7 +633,8 @@ export const operation: IEvalOperation = {
 
         return {
             type: 'label',
-            value: result
+            value: result,
+            name
         };
     },
     variable(e) {
@@ -378,13 +663,15 @@ export const operation: IEvalOperation = {
         }
 
         const result = new Uint8Array(rightSide.value.length + 1 + 1);
+        const refs: ILabelRef[] = [];
         result[0] = 0x8B;
         result[1] = variable;
-        result.set(rightSide.value, 2);
+        place(result, refs, rightSide, 2);
 
         return {
             type: 'assign',
-            value: result
+            value: result,
+            refs
         };
     },
     Expression(e) {
@@ -394,49 +681,35 @@ export const operation: IEvalOperation = {
         const left = a.eval();
         const right = b.eval();
         const result = new Uint8Array(left.value.length + right.value.length + 1);
-        result.set(left.value, 0);
+        const refs: ILabelRef[] = [];
+        place(result, refs, left, 0);
         result[left.value.length] = 0xB1;
-        result.set(right.value, left.value.length + 1);
+        place(result, refs, right, left.value.length + 1);
         return {
             type: 'logorExp',
-            value: result
+            value: result,
+            refs
         };
     },
     LogicAndExpression_logand(a, andLit, b) {
         const left = a.eval();
         const right = b.eval();
         const result = new Uint8Array(left.value.length + right.value.length + 1);
-        result.set(left.value, 0);
+        const refs: ILabelRef[] = [];
+        place(result, refs, left, 0);
         result[left.value.length] = 0xB0;
-        result.set(right.value, left.value.length + 1);
+        place(result, refs, right, left.value.length + 1);
         return {
             type: 'logandExp',
-            value: result
+            value: result,
+            refs
         };
     },
     BitwiseORExpression_bor(a, op, b) {
-        const left = a.eval();
-        const right = b.eval();
-        const result = new Uint8Array(left.value.length + right.value.length + 1);
-        result.set(left.value, 0);
-        result[left.value.length] = 0xA0;
-        result.set(right.value, left.value.length + 1);
-        return {
-            type: 'borExp',
-            value: result
-        };
+        return binaryExpression('borExp', a.eval(), 0xA0, b.eval());
     },
     BitwiseANDExpression_band(a, op, b) {
-        const left = a.eval();
-        const right = b.eval();
-        const result = new Uint8Array(left.value.length + right.value.length + 1);
-        result.set(left.value, 0);
-        result[left.value.length] = 0x9F;
-        result.set(right.value, left.value.length + 1);
-        return {
-            type: 'bandExp',
-            value: result
-        };
+        return binaryExpression('bandExp', a.eval(), 0x9F, b.eval());
     },
     CompareExpression_comp(a, op, b) {
         const ops: IOperationList = {
@@ -451,12 +724,14 @@ export const operation: IEvalOperation = {
         const left = a.eval();
         const right = b.eval();
         const result = new Uint8Array(left.value.length + right.value.length + 1);
-        result.set(left.value, 0);
+        const refs: ILabelRef[] = [];
+        place(result, refs, left, 0);
         result[left.value.length] = ops[op.sourceString];
-        result.set(right.value, left.value.length + 1);
+        place(result, refs, right, left.value.length + 1);
         return {
             type: 'compExp',
-            value: result
+            value: result,
+            refs
         };
     },
     AddExpression_add(a, op, b) {
@@ -464,17 +739,7 @@ export const operation: IEvalOperation = {
             '+': 0x9D,
             '-': 0x9E
         };
-        const left = a.eval();
-        const right = b.eval();
-        // TODO optimize if two numbers -> add
-        const result = new Uint8Array(left.value.length + right.value.length + 1);
-        result.set(left.value, 0);
-        result[left.value.length] = ops[op.sourceString];
-        result.set(right.value, left.value.length + 1);
-        return {
-            type: 'addExp',
-            value: result
-        };
+        return binaryExpression('addExp', a.eval(), ops[op.sourceString], b.eval());
     },
     MulExpression_mul(a, op, b) {
         const ops: IOperationList = {
@@ -482,40 +747,41 @@ export const operation: IEvalOperation = {
             '/': 0xA2,
             '%': 0xA3,
         };
-        const left = a.eval();
-        const right = b.eval();
-        // TODO optimize if two numbers -> add
-        const result = new Uint8Array(left.value.length + right.value.length + 1);
-        result.set(left.value, 0);
-        result[left.value.length] = ops[op.sourceString];
-        result.set(right.value, left.value.length + 1);
-        return {
-            type: 'mulExp',
-            value: result
-        };
+        return binaryExpression('mulExp', a.eval(), ops[op.sourceString], b.eval());
     },
     PrefixExpression_prefix(op, b) {
         const ops: IOperationList = {
             '-': 0x9E
         };
         const right = b.eval();
+        const num = constantOf(right);
+        if (compileOptions.optimize && num !== null && num !== -0x8000) {
+            return constantResult(-num);
+        }
         const result = new Uint8Array(right.value.length + 1);
+        const refs: ILabelRef[] = [];
         result[0] = ops[op.sourceString];
-        result.set(right.value, 1);
+        place(result, refs, right, 1);
         return {
             type: 'prfExp',
-            value: result
+            value: result,
+            refs
         };
     },
     ParenExpression_paren(leftparen, e, rightparen) {
         const inner = e.eval();
+        if (compileOptions.optimize && (inner.type === 'value' || inner.type === 'var')) {
+            return inner;
+        }
         const result = new Uint8Array(inner.value.length + 2);
+        const refs: ILabelRef[] = [];
         result[0] = 0x9B;
-        result.set(inner.value, 1);
+        place(result, refs, inner, 1);
         result[result.length - 1] = 0x9C;
         return {
             type: 'paren',
-            value: result
+            value: result,
+            refs
         };
     },
     RestExpression(e) {
@@ -532,22 +798,24 @@ export const operation: IEvalOperation = {
             len += stepExp.value.length + 1;
         }
         const result = new Uint8Array(len);
+        const refs: ILabelRef[] = [];
         let index = 0;
         result[index++] = 0x90; // TOKEN_FOR
         result[index++] = varExp.value[1]; // var without token
-        result.set(initExp.value, index);
+        place(result, refs, initExp, index);
         index += initExp.value.length;
         result[index++] = dirLit.sourceString === 'to' ? 0x91 : 0x92; // TOKEN_TO, TOKEN_DOWNTO
-        result.set(endExp.value, index);
+        place(result, refs, endExp, index);
         if (stepLit.sourceString) {
             index += endExp.value.length;
             result[index++] = 0x93; // TOKEN_STEP
-            result.set(stepExp.value, index);
+            place(result, refs, stepExp, index);
         }
 
         return {
             type: 'loop',
-            value: result
+            value: result,
+            refs
         };
     },
     Next(nextLit, e) {
@@ -575,24 +843,26 @@ export const operation: IEvalOperation = {
             len += elseSt.value.length + 1;
         }
         const result = new Uint8Array(len);
+        const refs: ILabelRef[] = [];
         result[0] = 0x8D;
         result[1] = 0;
         let pos = 2;
-        result.set(cond.value, pos);
+        place(result, refs, cond, pos);
         pos += cond.value.length;
         result[pos] = 0x8E;
         pos++;
-        result.set(thSt.value, pos);
+        place(result, refs, thSt, pos);
         pos += thSt.value.length;
         if (elseSt) {
             result[1] = pos - 1;
             result[pos] = 0x8F;
             pos++;
-            result.set(elseSt.value, pos);
+            place(result, refs, elseSt, pos);
         }
         return {
             type: 'if',
-            value: result
+            value: result,
+            refs
         };
     },
     Jump(jumpOp, labelLit) {
@@ -603,66 +873,60 @@ export const operation: IEvalOperation = {
             result[0] = 0x96;
         }
         const dv = new DataView(result.buffer);
-        const lbl = labelLit.eval();
-        let label = parseInt(lbl, 10);
-        if (isNaN(label)) {
-            label = labelsMap[lbl];
-        }
-
-        if (lbl > 0x7FFE) {
-            throw new Error('Label value to big. Max number allowed: 32766');
-        }
-        dv.setUint16(1, lbl | 0x8000, true);
+        const name = labelLit.eval();
+        const label = getLabelId(name);
+        dv.setUint16(1, label | 0x8000, true);
 
         return {
             type: 'jump',
-            value: result
+            value: result,
+            refs: [{ pos: 1, label, name, isRead: false }]
         };
     },
     Delay(delayLit, e) {
         const ev = e.eval();
         const result = new Uint8Array(ev.value.length + 1);
+        const refs: ILabelRef[] = [];
         result[0] = 0x98;
-        result.set(ev.value, 1);
+        place(result, refs, ev, 1);
         return {
             type: 'delay',
-            value: result
+            value: result,
+            refs
         };
     },
     Print(printlit, params) {
         const paramsEv = params.eval();
         const result = new Uint8Array(paramsEv.value.length + 1);
+        const refs: ILabelRef[] = [];
         result[0] = 0x8C;
-        result.set(paramsEv.value, 1);
+        place(result, refs, paramsEv, 1);
 
         return {
             type: 'print',
-            value: result
+            value: result,
+            refs
         };
     },
     PrintArgs(first, rest) {
         const f = first.eval();
-        let args;
-        const r: any = {
-            value: []
-        };
+        const args: IEvalResult[] = rest.sourceString !== '' ? rest.eval() : [];
 
-        if (rest.sourceString !== '') {
-            args = rest.eval();
-            args.forEach((arg: any) => {
-                arg.value.forEach((sarg: any) => {
-                    r.value.push(sarg);
-                });
-            });
-        }
-
-        const result = new Uint8Array(f.value.length + r.value.length);
-        result.set(f.value, 0);
-        result.set(r.value, f.value.length);
+        let len = f.value.length;
+        args.forEach((arg) => len += arg.value.length);
+        const result = new Uint8Array(len);
+        const refs: ILabelRef[] = [];
+        place(result, refs, f, 0);
+        let pos = f.value.length;
+        args.forEach((arg) => {
+            place(result, refs, arg, pos);
+            pos += arg.value.length;
+        });
 
         return {
             type: 'print_args',
-            value: result
+            value: result,
+            refs
         };
     },
     PrintArg(e) {
@@ -670,7 +934,8 @@ export const operation: IEvalOperation = {
         const result = new Uint8Array(ev.value);
         return {
             type: 'print_arg',
-            value: result
+            value: result,
+            refs: ev.refs
         };
     },
     PrintArgsList(sep, arg) {
@@ -678,11 +943,13 @@ export const operation: IEvalOperation = {
         const a = arg.eval();
 
         const result = new Uint8Array(s.value.length + a.value.length);
-        result.set(s.value, 0);
-        result.set(a.value, s.value.length);
+        const refs: ILabelRef[] = [];
+        place(result, refs, s, 0);
+        place(result, refs, a, s.value.length);
         return {
             type: 'print_arg_list',
-            value: result
+            value: result,
+            refs
         };
     },
     PrintArgSeparator(e) {
@@ -711,13 +978,18 @@ export const operation: IEvalOperation = {
     LibCall(libName, dot, funcName, leftBr, params, rightBr) {
         const paramsEv = params.eval();
         const result = new Uint8Array(paramsEv.value.length + 2);
-        result[0] = LibMap[libName.sourceString.toLowerCase()].token;
-        result[1] = LibMap[libName.sourceString.toLowerCase()].functions[funcName.sourceString.toLowerCase()];
-        result.set(paramsEv.value, 2);
+        const refs: ILabelRef[] = [];
+        const call = findLibCall((libName.sourceString + '.' + funcName.sourceString).toLowerCase());
+        if (call) {
+            result[0] = call.token;
+            result[1] = call.func;
+        }
+        place(result, refs, paramsEv, 2);
 
         return {
             type: 'call',
-            value: result
+            value: result,
+            refs
         };
     },
     CallArgs(args) {
@@ -745,8 +1017,9 @@ export const operation: IEvalOperation = {
         }
 
         const result = new Uint8Array(len);
+        const refs: ILabelRef[] = [];
         for (let i = 0; i < e.value.length; i++) {
-            result.set(e.value[i].value, index);
+            place(result, refs, e.value[i], index);
             index += e.value[i].value.length;
             if (i < e.value.length - 1) {
                 result[index] = 0x99;
@@ -756,7 +1029,8 @@ export const operation: IEvalOperation = {
 
         return {
             type: 'callargs',
-            value: result
+            value: result,
+            refs
         };
     },
     NonemptyListOf(first, _, rest) {
@@ -786,23 +1060,21 @@ export const operation: IEvalOperation = {
         };
     },
     DataRead(readLit, labelLit, commaLit, index) {
-        const lbl = labelLit.eval();
+        const name = labelLit.eval();
+        const label = getLabelId(name);
         const inev = index.eval();
 
-        let label = parseInt(lbl, 10);
-        if (isNaN(label)) {
-            label = labelsMap[lbl];
-        }
-
         const result = new Uint8Array(3 + inev.value.length); // TOKEN 8bit, ADDR 16bit
+        const refs: ILabelRef[] = [{ pos: 1, label, name, isRead: true }];
         result[0] = 0xAF;
         const dv = new DataView(result.buffer);
         dv.setUint16(1, label | 0x8000, true);
-        result.set(inev.value, 3);
+        place(result, refs, inev, 3);
 
         return {
             type: 'dataread',
             value: result,
+            refs,
             length: inev.value.length
         };
     },
@@ -1,15 +1,25 @@
 'use strict';
 
 import { CancellationToken, Hover, HoverProvider, MarkdownString, Position, ProviderResult, TextDocument } from 'vscode';
-import { LEDBasicDocumentSymbolProvider } from './LEDBasicDocumentSymbolProvider';
-import { findLibSignature } from './utils';
+import { formatCost, IBlockCost, ICostReport } from './CostEstimator';
+import { costAnalyzer } from './LEDBasicCostAnalyzer';
+import { findLibSignature, labelIdentifierPattern } from './utils';
 
-export class LEDBasicHoverProvider implements HoverProvider {
-    private dsp: LEDBasicDocumentSymbolProvider;
+interface ILabelInfo {
+    position: Position;
+    // comment line in front of the label
+    comment: string;
+}
 
-    constructor(docSymbolProvider: LEDBasicDocumentSymbolProvider) {
-        this.dsp = docSymbolProvider;
-    }
+interface ICachedLabels {
+    version: number;
+    labels: Map<string, ILabelInfo>;
+}
+
+const REG_LABEL = new RegExp('^[^\'\r\na-zA-Z0-9_]*(' + labelIdentifierPattern + '):');
+
+export class LEDBasicHoverProvider implements HoverProvider {
+    private cache = new Map<string, ICachedLabels>();
 
     public provideHover(document: TextDocument, position: Position, token: CancellationToken): ProviderResult<Hover> {
         const wordRange = document.getWordRangeAtPosition(position)
@@ -26,28 +36,118 @@ export class LEDBasicHoverProvider implements HoverProvider {
             const contents = new MarkdownString();
             contents.appendCodeblock(entry.signature, 'led_basic');
             contents.appendMarkdown(entry.description);
+            if (name.toLowerCase() === 'for') {
+                this.appendLoopCost(contents, document, wordRange.start.line + 1);
+            }
 
             return new Hover(contents, wordRange);
         } else { // look for labels
             const line = document.lineAt(wordRange.start.line);
+            if (line.text.match(new RegExp('^\\s*' + name + ':'))) {
+                const contents = new MarkdownString();
+                if (this.appendBlockCost(contents, document, wordRange.start.line + 1)) {
+                    return new Hover(contents, wordRange);
+                }
+                return null;
+            }
             if (!line.text.match(new RegExp('(?:goto|gosub)\\s+(' + name + ')'))) {
                 return null;
             }
-            const symbols = this.dsp.provideDocumentSymbols(document, token);
-            if (symbols instanceof Array) {
-                const labelSymbol = symbols.find((symbol) => {
-                    return symbol.name.startsWith(name + ':');
-                });
+            const label = this.labels(document).get(name);
+            if (label && label.comment) {
+                const contents = new MarkdownString();
+                contents.appendCodeblock('\'' + label.comment, 'led_basic');
 
-                if (labelSymbol && labelSymbol.detail) {
-                    const contents = new MarkdownString();
-                    contents.appendCodeblock('\'' + labelSymbol.detail, 'led_basic');
-
-                    return new Hover(contents, wordRange);
-                }
+                return new Hover(contents, wordRange);
             }
         }
 
         return null;
     }
+
+    /**
+     * Removes the cached labels of a closed document
+     * @param document - LED Basic document
+     */
+    public forget(document: TextDocument) {
+        this.cache.delete(document.uri.toString());
+    }
+
+    /**
+     * Returns the labels of the document with the comment in front of them. The labels are collected
+     * once per document version on the first hover over a jump target.
+     * @param document - LED Basic document
+     */
+    private labels(document: TextDocument): Map<string, ILabelInfo> {
+        const key = document.uri.toString();
+        const cached = this.cache.get(key);
+        if (cached && cached.version === document.version) {
+            return cached.labels;
+        }
+
+        const labels = new Map<string, ILabelInfo>();
+        let previous = '';
+        for (let index = 0; index < document.lineCount; index++) {
+            const text = document.lineAt(index).text;
+            const match = REG_LABEL.exec(text);
+            // the first definition of a label wins
+            if (match && !labels.has(match[1])) {
+                labels.set(match[1], {
+                    position: new Position(index, match[0].length - match[1].length - 1),
+                    comment: previous.startsWith('\'') ? previous.substring(1).trim() : ''
+                });
+            }
+            previous = text;
+        }
+
+        this.cache.set(key, { version: document.version, labels });
+        return labels;
+    }
+
+    /**
+     * Adds the estimated time of the FOR loop starting in the provided line
+     * @param contents - hover contents
+     * @param document - LED Basic document
+     * @param line - source line number of the FOR statement
+     */
+    private appendLoopCost(contents: MarkdownString, document: TextDocument, line: number) {
+        const report = costAnalyzer.analyze(document);
+        const loop = report && report.loops.find((l) => l.line === line);
+        if (!report || !loop) {
+            return;
+        }
+        const iterations = loop.iterations === null ? 'unknown number of iterations' : loop.iterations + ' iterations';
+        contents.appendMarkdown('\n\n' + iterations + ' of ' + formatCost(loop.bodyCost) + '. ' + costSummary(loop.cost, report));
+    }
+
+    /**
+     * Adds the estimated time of the label block defined in the provided line. Returns false if no costs are available.
+     * @param contents - hover contents
+     * @param document - LED Basic document
+     * @param line - source line number of the label
+     */
+    private appendBlockCost(contents: MarkdownString, document: TextDocument, line: number): boolean {
+        const report = costAnalyzer.analyze(document);
+        if (!report) {
+            return false;
+        }
+        // labels have no line numbers in the code image, take the first block starting after the label
+        let block: IBlockCost | null = null;
+        for (const b of report.blocks) {
+            if (b.label !== null && b.line >= line && (!block || b.line < block.line)) {
+                block = b;
+            }
+        }
+        if (!block) {
+            return false;
+        }
+        contents.appendMarkdown('Straight-line execution up to the next label. ' + costSummary(block.cost, report));
+        return true;
+    }
+}
+
+function costSummary(cost: number, report: ICostReport): string {
+    const share = Math.round(cost * 100 / report.frameBudget);
+    return (report.calibrated ? 'Estimated time: ' : 'Uncalibrated estimate: ') + formatCost(cost) + ', ' + share
+        + '% of the ' + formatCost(report.frameBudget) + ' frame at ' + report.frameRate + ' fps.';
 }
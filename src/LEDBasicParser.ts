@@ -1,17 +1,61 @@
-import { IError, IMatchResult, IParseResult } from './Common';
+import { verifyOptimizedImage } from './CodeVerifier';
+import { ICallSite, ICompileOptions, IError, IMatchResult, IParseResult } from './Common';
+
+/**
+ * Collects the library calls of the parse tree including the calls in the arguments of other calls
+ */
+const callsOperation = {
+    LibCall(libName: any, dot: any, funcName: any, leftBr: any, params: any, rightBr: any): ICallSite[] {
+        // CallArgs > ListOf > NonemptyListOf<Expression, ","> | EmptyListOf
+        const list = params.child(0).child(0);
+        const site: ICallSite = {
+            lib: libName.sourceString,
+            func: funcName.sourceString,
+            args: list.ctorName === 'NonemptyListOf' ? list.child(2).numChildren + 1 : 0,
+            start: libName.source.startIdx,
+            end: funcName.source.endIdx
+        };
+        return [site].concat(params.calls());
+    },
+    _nonterminal(this: any): ICallSite[] {
+        return collectCalls(this.children);
+    },
+    _iter(this: any): ICallSite[] {
+        return collectCalls(this.children);
+    },
+    _terminal(): ICallSite[] {
+        return [];
+    }
+};
+
+function collectCalls(children: any[]): ICallSite[] {
+    const result: ICallSite[] = [];
+    children.forEach((child) => result.push(...child.calls()));
+    return result;
+}
 
 export class LEDBasicParser {
     private grammar: any;
     private semantics: any;
+    private configure: ((options: ICompileOptions) => void) | undefined;
 
-    constructor(ohmlib: any, grammar: string, operation: any) {
-        this.grammar = ohmlib.grammar(grammar);
+    /**
+     * @param ohmlib - ohm library
+     * @param grammar - grammar source or an already compiled grammar shared with other semantics
+     * @param operation - semantic actions generating the code
+     * @param configure - callback setting the compile options of the semantic actions
+     */
+    constructor(ohmlib: any, grammar: string | object, operation: any, configure?: (options: ICompileOptions) => void) {
+        this.grammar = typeof grammar === 'string' ? ohmlib.grammar(grammar) : grammar;
         this.semantics = this.grammar.createSemantics();
         this.semantics.addOperation('eval', operation);
+        this.semantics.addOperation('calls', callsOperation);
+        this.configure = configure;
     }
 
     /**
      * Checks if the provided code respects the grammar. Returns generated errors for the "PROBLEMS" view
+     * or the library calls of the program for the API checks.
      * @param text - source code
      */
     public match(text: string): IMatchResult {
@@ -20,7 +64,9 @@ export class LEDBasicParser {
         };
 
         const match = this.grammar.match(text);
-        if (match.failed()) {
+        if (match.succeeded()) {
+            result.calls = this.semantics(match).calls();
+        } else {
             result.success = false;
             const errors: IError[] = [];
             if (match.shortMessage) {
@@ -49,14 +95,43 @@ export class LEDBasicParser {
     /**
      * Generates tokenized code for the upload. Provides local configuration properties if detected in the code.
      * @param text - source code
+     * @param options - compile options, no optimizations by default
      */
-    public build(text: string): IParseResult | IMatchResult {
-        const check = this.match(text);
-        if (!check.success) {
-            return check;
+    public build(text: string, options: ICompileOptions = {}): IParseResult | IMatchResult {
+        const match = this.grammar.match(text);
+        if (match.failed()) {
+            return this.match(text);
         }
 
-        const result: IMatchResult | IParseResult = this.semantics(this.grammar.match(text)).eval();
+        const result: IMatchResult | IParseResult = this.evaluate(match, options);
+        if (!result.success || !(options.optimize || options.removeDeadCode) || !options.verify) {
+            return result;
+        }
+
+        // fall back to the code without any optimization if the optimizer changed the program
+        const plain = this.evaluate(match, {}) as IParseResult;
+        if (!plain.success) {
+            // errors in removed code only, nothing to compare with
+            return result;
+        }
+        const difference = verifyOptimizedImage(plain, result as IParseResult);
+        if (difference) {
+            plain.warnings = ['Code optimization skipped. ' + difference];
+            return plain;
+        }
         return result;
     }
+
+    private evaluate(match: any, options: ICompileOptions): IParseResult | IMatchResult {
+        if (this.configure) {
+            this.configure(options);
+        }
+        try {
+            return this.semantics(match).eval();
+        } finally {
+            if (this.configure) {
+                this.configure({});
+            }
+        }
+    }
 }
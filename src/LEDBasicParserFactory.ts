@@ -1,12 +1,8 @@
-import fs = require('fs');
 import ohm = require('ohm-js');
+import { grammarRegistry } from './GrammarRegistry';
 // import { operation } from './LEDBasicEvalOperation';
-import { operation } from './LEDBasicEvalOperationEx';
+import { operation, setCompileOptions } from './LEDBasicEvalOperationEx';
 import { LEDBasicParser } from './LEDBasicParser';
-import { getExtensionPath } from './utils';
-
-const GRAMMAR_EX = 'grammar_ex.ohm';
-// const GRAMMAR = 'grammar.ohm';
 
 class ParserFactory {
     private parser: LEDBasicParser | null = null;
@@ -16,9 +12,7 @@ class ParserFactory {
             return this.parser;
         }
 
-        const path = getExtensionPath() + 'res/' + GRAMMAR_EX;
-        const grammar = fs.readFileSync(path).toString();
-        this.parser = new LEDBasicParser(ohm, grammar, operation);
+        this.parser = new LEDBasicParser(ohm, grammarRegistry.get(), operation, setCompileOptions);
         return this.parser;
     }
 }
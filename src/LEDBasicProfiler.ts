@@ -0,0 +1,152 @@
+'use strict';
+
+import {
+    DecorationOptions, Disposable, ProgressLocation, Range, TextDocument, TextEditor, TextEditorDecorationType, ThemeColor,
+    window, workspace
+} from 'vscode';
+import { IRunResult } from './CodeInterpreter';
+import { CodeProfiler, IProfileReport } from './CodeProfiler';
+import { IParseResult, parseResultToArray } from './Common';
+import { formatCost } from './CostEstimator';
+import { deviceSelector } from './DeviceSelector';
+import { LEDBasicParserFactory } from './LEDBasicParserFactory';
+
+// device time a program is profiled for in microseconds
+const PROFILE_TIME = 10000000;
+// stops programs which run without delays or frames
+const PROFILE_STEPS = 20000000;
+// statements run at once, the extension host handles other events between the chunks
+const PROFILE_CHUNK = 250000;
+
+interface IProfiledDocument {
+    document: TextDocument;
+    version: number;
+    profiler: CodeProfiler;
+}
+
+/**
+ * Profiles a document on the host interpreter and shows the executions and device time of each
+ * line as decorations behind the line.
+ */
+class LEDBasicProfiler implements Disposable {
+    private decoration: TextEditorDecorationType;
+    private last: IProfiledDocument | null = null;
+
+    constructor() {
+        this.decoration = window.createTextEditorDecorationType({
+            after: {
+                color: new ThemeColor('editorCodeLens.foreground'),
+                margin: '0 0 0 2em'
+            }
+        });
+    }
+
+    /**
+     * Runs the document for PROFILE_TIME device time and decorates the editor with the result.
+     * The run shows its progress and can be cancelled. Resolves to null if the code can't be compiled
+     * and to undefined if the run was cancelled.
+     * @param editor - editor of a LED Basic document
+     */
+    public profile(editor: TextEditor): Thenable<IProfileReport | null | undefined> {
+        const document = editor.document;
+        const device = deviceSelector.selectedDevice();
+        // compile with the same options as the upload to get the same code
+        const config = workspace.getConfiguration('led_basic');
+        const result = LEDBasicParserFactory.getParser().build(document.getText(), {
+            optimize: config.optimizeCode,
+            removeDeadCode: config.optimizeCode
+        });
+        if (!result.success) {
+            return Promise.resolve(null);
+        }
+
+        const image = parseResultToArray(result as IParseResult, device.meta);
+        const profiler = new CodeProfiler(image, { costs: device.costs });
+        const progressOptions = {
+            location: ProgressLocation.Notification,
+            title: 'Profiling on ' + device.label,
+            cancellable: true
+        };
+        return window.withProgress(progressOptions, (progress, token) => new Promise<IProfileReport | undefined>((resolve, reject) => {
+            let reported = 0;
+            const run = () => {
+                if (token.isCancellationRequested) {
+                    resolve(undefined);
+                    return;
+                }
+                let runResult: IRunResult;
+                try {
+                    runResult = profiler.interpreter.run({
+                        maxTime: PROFILE_TIME,
+                        maxSteps: Math.min(profiler.interpreter.steps + PROFILE_CHUNK, PROFILE_STEPS)
+                    });
+                } catch (error) {
+                    reject(error);
+                    return;
+                }
+                if (runResult.reason === 'steps' && runResult.steps < PROFILE_STEPS) {
+                    const percent = Math.min(100, Math.max(runResult.time * 100 / PROFILE_TIME, runResult.steps * 100 / PROFILE_STEPS));
+                    progress.report({ increment: percent - reported });
+                    reported = percent;
+                    setImmediate(run);
+                    return;
+                }
+                resolve(profiler.report(runResult));
+            };
+            run();
+        })).then((report) => {
+            if (report) {
+                this.last = { document, version: document.version, profiler };
+                this.decorate(editor, report);
+            }
+            return report;
+        });
+    }
+
+    /**
+     * Returns the call stacks of the last profile in the folded format of flamegraph tools or null
+     * if no profile is available
+     */
+    public foldedStacks(): string | null {
+        return this.last ? this.last.profiler.foldedStacks() : null;
+    }
+
+    /**
+     * Removes the decorations of a changed document, the profile doesn't match the lines anymore
+     * @param document - LED Basic document
+     */
+    public clear(document: TextDocument) {
+        if (this.last && this.last.document === document && this.last.version !== document.version) {
+            window.visibleTextEditors
+                .filter((editor) => editor.document === document)
+                .forEach((editor) => editor.setDecorations(this.decoration, []));
+            this.last = null;
+        }
+    }
+
+    public dispose() {
+        this.decoration.dispose();
+    }
+
+    private decorate(editor: TextEditor, report: IProfileReport) {
+        const total = report.result.time || 1;
+        const decorations: DecorationOptions[] = report.lines
+            .filter((line) => line.hits > 0 && line.line <= editor.document.lineCount)
+            .map((line) => {
+                const end = editor.document.lineAt(line.line - 1).range.end;
+                const share = (line.time * 100 / total).toFixed(1);
+                return {
+                    range: new Range(end, end),
+                    renderOptions: {
+                        after: {
+                            contentText: line.hits + '× · ' + formatCost(line.time) + ' · ' + share + '%'
+                        }
+                    },
+                    hoverMessage: line.instructions + ' tokens executed, ' + formatCost(line.time / line.hits) + ' per execution'
+                };
+            });
+        editor.setDecorations(this.decoration, decorations);
+    }
+}
+
+export const profiler = new LEDBasicProfiler();
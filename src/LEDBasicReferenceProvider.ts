@@ -1,40 +1,37 @@
 'use strict';
-import { CancellationToken, Location, Position, ProviderResult, Range, ReferenceContext, ReferenceProvider, TextDocument } from 'vscode';
+import { CancellationToken, Location, Position, ProviderResult, ReferenceContext, ReferenceProvider, TextDocument } from 'vscode';
+import { OCCURRENCE, tokenIndex } from './TokenIndex';
 import { labelIdentifierPattern, variableIdentifierPattern } from './utils';
 
 export class LEDBasicReferenceProvider implements ReferenceProvider {
     public provideReferences(document: TextDocument, position: Position, context: ReferenceContext, token: CancellationToken): ProviderResult<Location[]> {
-        const result = [];
-        let label = '';
-        const code = document.getText();
-        let match;
-        let reg: RegExp | null = null;
+        let name = '';
+        let kinds: OCCURRENCE[] = [];
 
         // check for a label
         let wordRange = document.getWordRangeAtPosition(position, new RegExp(labelIdentifierPattern + ':', 'i'));
         if (wordRange) {
-            label = document.getText(wordRange);
-            label = label.substring(0, label.length - 1);
-            reg = new RegExp('(?:goto|gosub|read)\\s\\b(' + label + ')\\b', 'ig');
+            name = document.getText(wordRange);
+            name = name.substring(0, name.length - 1);
+            kinds = context.includeDeclaration ? [OCCURRENCE.JUMP, OCCURRENCE.LABEL] : [OCCURRENCE.JUMP];
         } else {
             // check variables
             wordRange = document.getWordRangeAtPosition(position, new RegExp(variableIdentifierPattern, 'i'));
             if (wordRange) {
-                label = document.getText(wordRange);
-                reg = new RegExp('\\b(' + label + ')\\b', 'ig');
+                name = document.getText(wordRange);
+                // the target of goto, gosub or read refers to the label, not to a variable
+                if (tokenIndex.kindAt(document, position) === OCCURRENCE.JUMP
+                    || tokenIndex.find(document, name, [OCCURRENCE.LABEL]).length) {
+                    kinds = context.includeDeclaration ? [OCCURRENCE.JUMP, OCCURRENCE.LABEL] : [OCCURRENCE.JUMP];
+                } else {
+                    kinds = [OCCURRENCE.IDENTIFIER];
+                }
             }
         }
 
-        if (reg) {
-            // tslint:disable-next-line: no-conditional-assignment
-            while (match = reg.exec(code)) {
-                const index = match.index + match[0].indexOf(match[1]);
-                const start = document.positionAt(index);
-                const end = document.positionAt(index + match[1].length);
-
-                result.push(new Location(document.uri, new Range(start, end)));
-            }
+        if (!name) {
+            return [];
         }
-        return result;
+        return tokenIndex.find(document, name, kinds).map((range) => new Location(document.uri, range));
     }
 }
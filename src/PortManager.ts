@@ -0,0 +1,365 @@
+'use strict';
+// tslint:disable: no-console no-unused-expression
+
+import { performance } from 'perf_hooks';
+import { Disposable } from 'vscode';
+import { ISerialPort, ISerialPortFactory, ISerialPortOptions, IUploadRecorder } from './Common';
+import { SerialPort } from './SerialPort';
+
+const DEBUG = false;
+
+// an unused port stays open for a while, uploaders reopen it right after closing
+const IDLE_CLOSE_DELAY = 2000;
+
+/**
+ * Handle of a port owned by the port manager. A handle opened with open() listens in the background
+ * like the terminal, a handle opened with openForUpload() uses the port exclusively. Background
+ * handles are paused while an exclusive handle is open and resumed afterwards.
+ */
+export class PortHandle implements ISerialPort {
+    // called when a paused background handle is attached to the port again
+    public onResume: (() => void) | null = null;
+    public listener: ((data: Uint8Array) => void | Promise<void>) | null = null;
+    public captureFile: string | null = null;
+    public captureSize = 0;
+    private opened = false;
+
+    constructor(private shared: SharedPort, public readonly options: ISerialPortOptions) {
+    }
+
+    public isOpen(): boolean {
+        // a paused background handle stays open while the port is used by an upload
+        return this.opened && (!this.shared.portOf(this) || this.shared.isOpen());
+    }
+
+    public open(): Promise<void> {
+        return this.shared.openBackground(this)
+            .then(() => {
+                this.opened = true;
+            });
+    }
+
+    public openForUpload(brk?: boolean, dtr?: boolean, recorder?: IUploadRecorder): Promise<void> {
+        return this.shared.openExclusive(this, brk, dtr, recorder)
+            .then(() => {
+                this.opened = true;
+            });
+    }
+
+    public close(): Promise<void> {
+        if (!this.opened) {
+            return Promise.reject(new Error('Port not opened'));
+        }
+        this.opened = false;
+        return this.shared.release(this);
+    }
+
+    public read(timeout?: number): Promise<Uint8Array> {
+        const port = this.shared.portOf(this);
+        if (!port) {
+            return Promise.reject(new Error('Serial Port is closed'));
+        }
+        return port.read(timeout);
+    }
+
+    public write(data: Uint8Array): Promise<void> {
+        const port = this.shared.portOf(this);
+        if (!port) {
+            return Promise.reject(new Error('Serial Port is closed'));
+        }
+        return port.write(data);
+    }
+
+    public setReadListener(listener: ((data: Uint8Array) => void | Promise<void>) | null) {
+        this.listener = listener;
+        const port = this.shared.portOf(this);
+        if (port) {
+            port.setReadListener(listener);
+        }
+    }
+
+    /**
+     * Captures the received data of a background handle to a rolling log, see SerialPort.capture.
+     * The capture is paused together with the handle.
+     * @param file - log file or null to stop the capture
+     * @param size - size of the captured data in bytes
+     */
+    public capture(file: string | null, size = 0) {
+        this.captureFile = file;
+        this.captureSize = size;
+        const port = this.shared.portOf(this);
+        if (port) {
+            port.capture(file, size);
+        }
+    }
+
+    public dispose() {
+        if (this.opened) {
+            this.close();
+        }
+    }
+}
+
+/**
+ * One physical port shared by the handles. Mode switches change the baud rate of the open port,
+ * the port is reopened only if the parity changes.
+ */
+class SharedPort {
+    private port: SerialPort | null = null;
+    private options: ISerialPortOptions | null = null;
+    private exclusive: PortHandle | null = null;
+    private background: PortHandle | null = null;
+    private attached = false;
+    private paused = false;
+    private suspended = 0;
+    private idleTimer: NodeJS.Timer | null = null;
+    // reconfigurations of the port run one after the other
+    private queue: Promise<any> = Promise.resolve();
+
+    constructor(private name: string) {
+    }
+
+    public isOpen(): boolean {
+        return !!this.port && this.port.isOpen();
+    }
+
+    /**
+     * Returns the physical port if the handle is the one currently using it
+     */
+    public portOf(handle: PortHandle): SerialPort | null {
+        if (handle === this.exclusive || (handle === this.background && this.attached)) {
+            return this.port;
+        }
+        return null;
+    }
+
+    public openBackground(handle: PortHandle): Promise<void> {
+        this.background = handle;
+        this.paused = false;
+        if (this.exclusive || this.suspended) {
+            // attached when the port is free again
+            this.paused = true;
+            return Promise.resolve();
+        }
+        return this.attach();
+    }
+
+    public openExclusive(handle: PortHandle, brk?: boolean, dtr?: boolean, recorder?: IUploadRecorder): Promise<void> {
+        if (this.exclusive && this.exclusive !== handle) {
+            return Promise.reject(new Error('Serial port is in use'));
+        }
+        this.exclusive = handle;
+        return this.run(() => {
+            this.detach();
+            const start = performance.now();
+            return this.configure(handle.options)
+                .then((reopened) => {
+                    recorder && recorder.record(reopened ? 'port open' : 'port update', start);
+                    return (this.port as SerialPort).resetForUpload(brk, dtr, recorder);
+                });
+        })
+            .catch((error) => {
+                if (this.exclusive === handle) {
+                    this.exclusive = null;
+                }
+                throw error;
+            });
+    }
+
+    public release(handle: PortHandle): Promise<void> {
+        if (handle === this.exclusive) {
+            this.exclusive = null;
+        } else if (handle === this.background) {
+            this.run(() => this.detach());
+            this.background = null;
+        }
+        return this.resumeBackground();
+    }
+
+    /**
+     * Pauses the background handle until resume() is called, e.g. for the duration of an upload
+     */
+    public suspend(): Promise<void> {
+        this.suspended++;
+        if (this.exclusive) {
+            return Promise.resolve();
+        }
+        return this.run(() => this.detach());
+    }
+
+    public resume(): Promise<void> {
+        this.suspended = Math.max(0, this.suspended - 1);
+        return this.resumeBackground();
+    }
+
+    public dispose() {
+        this.cancelClose();
+        if (this.port && this.port.isOpen()) {
+            this.port.close();
+        }
+        this.port = null;
+    }
+
+    private resumeBackground(): Promise<void> {
+        if (this.background && !this.exclusive && !this.suspended) {
+            return this.attach();
+        }
+        this.scheduleClose();
+        return Promise.resolve();
+    }
+
+    private attach(): Promise<void> {
+        const handle = this.background;
+        return this.run(() => {
+            if (!handle || handle !== this.background || this.exclusive || this.attached) {
+                return;
+            }
+            return this.configure(handle.options)
+                .then(() => {
+                    const port = this.port as SerialPort;
+                    port.setReadListener(handle.listener);
+                    if (handle.captureFile) {
+                        try {
+                            port.capture(handle.captureFile, handle.captureSize);
+                        } catch (error) {
+                            DEBUG && console.log('[PORTS] capture not resumed:', (error as Error).message);
+                        }
+                    }
+                    this.attached = true;
+                    if (this.paused) {
+                        this.paused = false;
+                        handle.onResume && handle.onResume();
+                    }
+                });
+        });
+    }
+
+    private detach() {
+        if (!this.attached) {
+            return;
+        }
+        DEBUG && console.log('[PORTS] pausing background listener of ' + this.name);
+        this.attached = false;
+        this.paused = true;
+        if (this.port && this.port.isOpen()) {
+            this.port.setReadListener(null);
+            if (this.background && this.background.captureFile) {
+                this.port.capture(null);
+            }
+        }
+    }
+
+    /**
+     * Brings the physical port into the requested configuration
+     * @returns true if the port was (re)opened, false if it was reconfigured in place
+     */
+    private configure(options: ISerialPortOptions): Promise<boolean> {
+        this.cancelClose();
+        const parity = (o: ISerialPortOptions) => o.parity || 'none';
+        if (this.port && this.port.isOpen() && this.options && parity(this.options) === parity(options)) {
+            if (this.options.baudRate === options.baudRate) {
+                return Promise.resolve(false);
+            }
+            DEBUG && console.log('[PORTS] switching ' + this.name + ' to ' + options.baudRate + ' baud');
+            return this.port.update(options.baudRate)
+                .then(() => {
+                    this.options = options;
+                    return false;
+                })
+                .catch(() => this.reopen(options));
+        }
+        return this.reopen(options);
+    }
+
+    private reopen(options: ISerialPortOptions): Promise<boolean> {
+        DEBUG && console.log('[PORTS] opening ' + this.name + ' with ' + options.baudRate + ' baud');
+        const old = this.port;
+        this.port = null;
+        this.options = null;
+        return (old && old.isOpen() ? old.close() : Promise.resolve())
+            .then(() => {
+                const port = new SerialPort(this.name, { ...options });
+                return port.open()
+                    .then(() => {
+                        this.port = port;
+                        this.options = options;
+                        return true;
+                    });
+            });
+    }
+
+    private run<T>(operation: () => Promise<T> | T): Promise<T> {
+        const result = this.queue.then(operation);
+        this.queue = result.catch(() => undefined);
+        return result;
+    }
+
+    private scheduleClose() {
+        if (this.idleTimer) {
+            return;
+        }
+        this.idleTimer = setTimeout(() => {
+            this.idleTimer = null;
+            if (this.exclusive || (this.background && !this.suspended)) {
+                return;
+            }
+            this.run(() => {
+                DEBUG && console.log('[PORTS] closing unused port ' + this.name);
+                const port = this.port;
+                this.port = null;
+                this.options = null;
+                return port && port.isOpen() ? port.close() : Promise.resolve();
+            });
+        }, IDLE_CLOSE_DELAY);
+    }
+
+    private cancelClose() {
+        if (this.idleTimer) {
+            clearTimeout(this.idleTimer);
+            this.idleTimer = null;
+        }
+    }
+}
+
+/**
+ * Owns each physical serial port once and shares it between the terminal and the uploaders.
+ */
+class PortManager implements ISerialPortFactory, Disposable {
+    private ports = new Map<string, SharedPort>();
+
+    public createSerialPort(name: string, options?: ISerialPortOptions): PortHandle {
+        return new PortHandle(this.shared(name), options || { baudRate: 9600 });
+    }
+
+    /**
+     * Pauses the background handles of the port, e.g. the terminal during an upload
+     * @param name - port name
+     */
+    public suspend(name: string): Promise<void> {
+        return this.shared(name).suspend();
+    }
+
+    /**
+     * Resumes the background handles of the port paused by suspend()
+     * @param name - port name
+     */
+    public resume(name: string): Promise<void> {
+        return this.shared(name).resume();
+    }
+
+    public dispose() {
+        this.ports.forEach((port) => port.dispose());
+        this.ports.clear();
+    }
+
+    private shared(name: string): SharedPort {
+        let port = this.ports.get(name);
+        if (!port) {
+            port = new SharedPort(name);
+            this.ports.set(name, port);
+        }
+        return port;
+    }
+}
+
+export const portManager = new PortManager();
@@ -1,6 +1,7 @@
 'use strict';
 // tslint:disable: no-console no-unused-expression
 
+import { performance } from 'perf_hooks';
 import { StringDecoder } from 'string_decoder';
 import { BaseDeviceUploader, CMD } from './BaseDeviceUploader';
 
@@ -62,22 +63,27 @@ export class SBProgUploader extends BaseDeviceUploader {
                 baudRate: baud
             });
 
-            port.openForUpload(true, false)
+            let start = performance.now();
+
+            port.openForUpload(true, false, this.recorder)
                 .then(() => port.close())
                 .then(() => {
+                    this.recorder && this.recorder.record('sbprog switch', start);
                     port = this.portFactory.createSerialPort(this.portInfo.name, {
                         baudRate: PROG_BAUD,
                         parity: 'even'
                     });
-                    return port.openForUpload(false, true);
+                    return port.openForUpload(false, true, this.recorder);
                 })
                 .then(() => {
+                    start = performance.now();
                     return port.write(new Uint8Array([0x7F]));
                 })
                 .then(() => {
                     return port.read();
                 })
                 .then((response: Uint8Array) => {
+                    this.recorder && this.recorder.record('handshake', start);
                     if (response.length < 2) {
                         throw new Error('There is no connected device to SB-PROG');
                     }
@@ -86,9 +92,11 @@ export class SBProgUploader extends BaseDeviceUploader {
                         data: new Uint8Array([])
                     };
                     this.port = port;
+                    start = performance.now();
                     return this.sendPacket(packet);
                 })
                 .then((response: Uint8Array) => {
+                    this.recorder && this.recorder.record('boot info', start);
                     // String.fromCharCode.apply(null, response.slice(0, 4));
                     const sysCode = new StringDecoder('utf8').write(Buffer.from(response.slice(0, 4)));
                     if (this.deviceInfo.meta.sysCode !== parseInt(sysCode, 16)) {
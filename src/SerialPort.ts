@@ -3,13 +3,26 @@
 
 const SP = require('../blp-serial');
 
+import * as path from 'path';
+import { performance } from 'perf_hooks';
 import { Disposable } from 'vscode';
 // import { dump } from './utils';
-import { ISerialPort, ISerialPortInfo, ISerialPortOptions } from './Common';
+import { IReadProfile, ISerialPort, ISerialPortInfo, ISerialPortOptions, IUploadRecorder } from './Common';
 
 const DEBUG = false;
 const DEFAULT_READ_TIMEOUT = 2000;
-const BUFFER_SIZE = 1024;
+
+// the bootloaders answer with short packets, one at a time
+export const READ_PROFILE_UPLOAD: IReadProfile = {
+    poolSize: 1024,
+    highWaterMark: 16 * 1024
+};
+
+// a running program may print continuously, the terminal reads in larger blocks
+export const READ_PROFILE_TERMINAL: IReadProfile = {
+    poolSize: 64 * 1024,
+    highWaterMark: 256 * 1024
+};
 
 export class SerialPort implements ISerialPort, Disposable {
 
@@ -31,12 +44,26 @@ export class SerialPort implements ISerialPort, Disposable {
         });
     }
 
+    /**
+     * Records the traffic of all ports opened afterwards, one recording file per port object
+     * @param dir - directory of the recordings or null to stop the recording
+     */
+    public static setRecordDirectory(dir: string | null) {
+        SerialPort.recordDirectory = dir;
+    }
+
+    private static recordDirectory: string | null = null;
+    private static recordCount = 0;
+
     private dataTimeout: number = 0;
     private readCallTimerId: NodeJS.Timer | null = null;
     private currentErrorCallback: any;
-    private inDataQueue: Uint8Array;
-    private inDataQueueOffset: number = 0;
-    private onResult: ((data: Uint8Array) => void) | null = null;
+    // the received data stays in the buffer of the stream until a consumer takes it
+    private pendingRead: ((data: Uint8Array) => void) | null = null;
+    // rejects the read waiting for data or for its timeout
+    private failRead: ((error: Error) => void) | null = null;
+    private listener: ((data: Uint8Array) => void | Promise<void>) | null = null;
+    private listenerBusy = false;
     private port: any;
     private portName: string;
 
@@ -48,32 +75,25 @@ export class SerialPort implements ISerialPort, Disposable {
         options.autoOpen = false;
         options.hupcl = false;
 
-        this.port = new SP(this.portName, options);
+        const profile = options.readProfile || READ_PROFILE_UPLOAD;
+        const spOptions: any = { ...options, highWaterMark: profile.highWaterMark, readPoolSize: profile.poolSize };
+        delete spOptions.readProfile;
+        if (options.replay) {
+            spOptions.binding = SP.ReplayBinding;
+            spOptions.bindingOptions = { replay: options.replay };
+            if (options.replaySpeed !== undefined) {
+                spOptions.bindingOptions.speed = options.replaySpeed;
+            }
+        } else if (SerialPort.recordDirectory) {
+            const name = new Date().toISOString().replace(/[:.]/g, '-') + '-' + (++SerialPort.recordCount) + '.blprec';
+            spOptions.binding = SP.RecordingBinding;
+            spOptions.bindingOptions = { record: path.join(SerialPort.recordDirectory, name) };
+        }
 
-        this.inDataQueue = new Uint8Array(BUFFER_SIZE);
+        this.port = new SP(this.portName, spOptions);
 
-        this.port.on('data', (data: Buffer) => {
-            DEBUG && console.log('[SERIAL] received ' + data.byteLength + ' bytes');
-            // DEBUG && console.log('[SERIAL] <\n' + dump(data));
-            if (this.inDataQueueOffset && !this.dataTimeout) {
-                DEBUG && console.log('[SERIAL] CB - queue not empty, add new data to it');
-                this.inDataQueue.set(new Uint8Array(data), this.inDataQueueOffset);
-                this.inDataQueueOffset += data.byteLength;
-            } else if (this.onResult) {
-                if (this.dataTimeout) {
-                    DEBUG && console.log('[SERIAL] CB - has a data timeout. pushing data to queue');
-                    this.inDataQueue.set(new Uint8Array(data), this.inDataQueueOffset);
-                    this.inDataQueueOffset += data.byteLength;
-                } else {
-                    DEBUG && console.log('[SERIAL] CB - calling callback function directly');
-                    this.onResult(new Uint8Array(data));
-                }
-            } else {
-                DEBUG && console.log('[SERIAL] CB - got data without read requested. pushing to queue');
-                this.inDataQueue.set(new Uint8Array(data), this.inDataQueueOffset);
-                this.inDataQueueOffset += data.byteLength;
-            }
-        });
+        // paused mode: data is read from the port only as fast as it is consumed
+        this.port.on('readable', () => this.pump());
 
         this.port.on('error', (error: Error) => {
             DEBUG && console.log('[SERIAL] error: ' + error.message);
@@ -99,21 +119,20 @@ export class SerialPort implements ISerialPort, Disposable {
         });
     }
 
-    public openForUpload(brk?: boolean, dtr?: boolean): Promise<void> {
+    /**
+     * Opens the port and resets the device into upload mode
+     * @param brk - toggle the BRK signal
+     * @param dtr - toggle the DTR signal
+     * @param recorder - receives the times of opening the port and of the signal toggling
+     */
+    public openForUpload(brk?: boolean, dtr?: boolean, recorder?: IUploadRecorder): Promise<void> {
         return new Promise((resolve, reject) => {
             DEBUG && console.log('[SERIAL] openForUpload with BRK:', brk, ', DTR:', dtr);
+            const start = performance.now();
             this.open()
                 .then(() => {
-                    if (brk) {
-                        return this.toggleBRK();
-                    }
-                    return Promise.resolve();
-                })
-                .then(() => {
-                    if (dtr) {
-                        return this.toggleDTR();
-                    }
-                    return Promise.resolve();
+                    recorder && recorder.record('port open', start);
+                    return this.resetForUpload(brk, dtr, recorder);
                 })
                 .then(() => {
                     DEBUG && console.log('[SERIAL] openForUpload resolving');
@@ -123,6 +142,60 @@ export class SerialPort implements ISerialPort, Disposable {
         });
     }
 
+    /**
+     * Resets the device on the open port into upload mode
+     * @param brk - toggle the BRK signal
+     * @param dtr - toggle the DTR signal
+     * @param recorder - receives the times of the signal toggling
+     */
+    public resetForUpload(brk?: boolean, dtr?: boolean, recorder?: IUploadRecorder): Promise<void> {
+        let start = performance.now();
+        return Promise.resolve()
+            .then(() => {
+                if (brk) {
+                    return this.toggleBRK()
+                        .then(() => recorder && recorder.record('brk', start));
+                }
+                return Promise.resolve();
+            })
+            .then(() => {
+                start = performance.now();
+                if (dtr) {
+                    return this.toggleDTR()
+                        .then(() => recorder && recorder.record('dtr', start));
+                }
+                return Promise.resolve();
+            });
+    }
+
+    /**
+     * Changes the baud rate of the open port in place and discards the data received so far,
+     * like reopening the port would do
+     * @param baudRate - new baud rate
+     */
+    public update(baudRate: number): Promise<void> {
+        return new Promise((resolve, reject) => {
+            DEBUG && console.log('[SERIAL] update baud rate to ' + baudRate);
+            this.discard();
+            this.port.update({ baudRate }, (error: Error) => {
+                if (error) {
+                    DEBUG && console.log('[SERIAL] error updating: ' + error.message);
+                    reject(error);
+                    return;
+                }
+                this.port.flush((flushError: Error) => {
+                    this.discard();
+                    if (flushError) {
+                        DEBUG && console.log('[SERIAL] error flushing: ' + flushError.message);
+                        reject(flushError);
+                    } else {
+                        resolve();
+                    }
+                });
+            });
+        });
+    }
+
     public toggleBRK(): Promise<void> {
         return new Promise((resolve, reject) => {
             DEBUG && console.log('[SERIAL] toggle BRK');
@@ -150,13 +223,14 @@ export class SerialPort implements ISerialPort, Disposable {
     public close(): Promise<void> {
         return new Promise((resolve, reject) => {
             DEBUG && console.log('[SERIAL] close');
-            this.inDataQueueOffset = 0;
-            this.onResult = null;
-            this.readCallTimerId = null;
+            this.listener = null;
+            this.cancelRead(new Error('Serial Port is closed'));
             this.dataTimeout = 0;
             this.currentErrorCallback = null;
 
             this.port.close((error: Error) => {
+                // data of this session must not show up after reopening the port
+                this.discard();
                 if (error) {
                     DEBUG && console.log('[SERIAL] error closing: ' + error.message);
                     reject(error);
@@ -168,8 +242,49 @@ export class SerialPort implements ISerialPort, Disposable {
         });
     }
 
-    public setReadListener(onData: ((data: Uint8Array) => void) | null) {
-        this.onResult = onData;
+    /**
+     * Starts writing the received data with timestamps to a memory mapped rolling log file or stops it.
+     * The capture stops when the port is closed.
+     * @param file - log file or null to stop the capture
+     * @param size - size of the captured data in bytes, older data is overwritten
+     */
+    public capture(file: string | null, size?: number) {
+        DEBUG && console.log('[SERIAL] capture to ' + file);
+        this.port.capture(file, size);
+    }
+
+    /**
+     * Sets a listener receiving all data which is not taken by read(). If the listener returns a promise,
+     * no further data is read from the port until the promise settles.
+     * @param onData - listener or null to keep the data in the port buffers
+     */
+    public setReadListener(onData: ((data: Uint8Array) => void | Promise<void>) | null) {
+        this.listener = onData;
+        this.pump();
+    }
+
+    /**
+     * Iterates over the received data. The next chunk is read from the port only when the consumer asks
+     * for it, so a slow consumer slows down the reading instead of growing the buffers.
+     * Not to be combined with read() or a read listener.
+     */
+    public async *chunks(): AsyncIterableIterator<Uint8Array> {
+        while (this.isOpen()) {
+            const data: Buffer | null = this.port.read();
+            if (data !== null) {
+                yield new Uint8Array(data);
+                continue;
+            }
+            await new Promise<void>((resolve) => {
+                const done = () => {
+                    this.port.removeListener('readable', done);
+                    this.port.removeListener('close', done);
+                    resolve();
+                };
+                this.port.on('readable', done);
+                this.port.on('close', done);
+            });
+        }
     }
 
     public read(dataTimeout?: number): Promise<Uint8Array> {
@@ -183,21 +298,24 @@ export class SerialPort implements ISerialPort, Disposable {
                 reject(new Error('Previous read operation still waiting for data'));
             } else {
                 this.dataTimeout = dataTimeout || 0;
-                if (this.inDataQueueOffset && !dataTimeout) {
-                    const data = this.inDataQueue.slice(0, this.inDataQueueOffset);
-                    this.inDataQueueOffset = 0;
+                const queued: Buffer | null = dataTimeout ? null : this.port.read();
+                if (queued !== null) {
                     DEBUG && console.log('[SERIAL] read got data from queue');
-                    resolve(data);
+                    resolve(new Uint8Array(queued));
                 } else {
-                    this.onResult = (data: Uint8Array) => {
-                        DEBUG && console.log('[SERIAL] read called from read CB');
-                        if (this.readCallTimerId) {
-                            clearTimeout(this.readCallTimerId);
-                            this.readCallTimerId = null;
-                        }
-                        this.onResult = null;
-                        resolve(data);
-                    };
+                    // with a data timeout everything received until the timeout is returned
+                    if (!dataTimeout) {
+                        this.pendingRead = (data: Uint8Array) => {
+                            DEBUG && console.log('[SERIAL] read called from read CB');
+                            if (this.readCallTimerId) {
+                                clearTimeout(this.readCallTimerId);
+                                this.readCallTimerId = null;
+                            }
+                            this.failRead = null;
+                            resolve(data);
+                        };
+                    }
+                    this.failRead = reject;
 
                     this.setReadTimeout((data: Uint8Array) => {
                         resolve(data);
@@ -256,9 +374,10 @@ export class SerialPort implements ISerialPort, Disposable {
     private setReadTimeout(onTimeout: (data: Uint8Array) => void, onError: (error: Error) => void) {
         this.readCallTimerId = setTimeout(() => {
             this.readCallTimerId = null;
-            this.onResult = null;
-            const result = this.inDataQueue.slice(0, this.inDataQueueOffset);
-            this.inDataQueueOffset = 0;
+            this.pendingRead = null;
+            this.failRead = null;
+            const data: Buffer | null = this.port.read();
+            const result = data ? new Uint8Array(data) : new Uint8Array(0);
             if (this.dataTimeout) {
                 DEBUG && console.log('[SERIAL] read timed out expectedly. resolving.');
                 onTimeout(result);
@@ -266,6 +385,67 @@ export class SerialPort implements ISerialPort, Disposable {
                 DEBUG && console.log('[SERIAL] read timed out unexpectedly. rejecting.');
                 onError(new Error('Device is not reponding. Check if you\'ve selected the right target device and correct serial port.'));
             }
+            this.pump();
         }, this.dataTimeout ? this.dataTimeout : DEFAULT_READ_TIMEOUT);
     }
+
+    /**
+     * Hands the buffered data to the waiting read or to the read listener. Without a consumer the data
+     * stays buffered, and once the high-water mark is reached the port is not read any more.
+     */
+    private pump() {
+        while (this.port && (this.pendingRead || (this.listener && !this.listenerBusy && !this.readCallTimerId))) {
+            const data: Buffer | null = this.port.read();
+            if (data === null) {
+                return;
+            }
+            DEBUG && console.log('[SERIAL] received ' + data.byteLength + ' bytes');
+            // DEBUG && console.log('[SERIAL] <\n' + dump(data));
+            if (this.pendingRead) {
+                const onResult = this.pendingRead;
+                this.pendingRead = null;
+                onResult(new Uint8Array(data));
+                continue;
+            }
+            const pending = (this.listener as (data: Uint8Array) => void | Promise<void>)(new Uint8Array(data));
+            if (pending instanceof Promise) {
+                this.listenerBusy = true;
+                pending
+                    .catch((error: Error) => DEBUG && console.log('[SERIAL] read listener failed: ' + error.message))
+                    .then(() => {
+                        this.listenerBusy = false;
+                        this.pump();
+                    });
+                return;
+            }
+        }
+    }
+
+    /**
+     * Rejects the read waiting for data, it must not receive data of a later session
+     * @param error - error of the read
+     */
+    private cancelRead(error: Error) {
+        const failRead = this.failRead;
+        this.pendingRead = null;
+        this.failRead = null;
+        if (this.readCallTimerId) {
+            clearTimeout(this.readCallTimerId);
+            this.readCallTimerId = null;
+        }
+        if (failRead) {
+            failRead(error);
+        }
+    }
+
+    /**
+     * Drops the received data which was not consumed yet and cancels a waiting read
+     */
+    private discard() {
+        this.cancelRead(new Error('Read cancelled, the received data was discarded'));
+        if (this.port) {
+            // without a size the stream returns all of its buffered data
+            this.port.read();
+        }
+    }
 }
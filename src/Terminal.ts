@@ -2,8 +2,15 @@
 
 import { StringDecoder } from 'string_decoder';
 import { OutputChannel, StatusBarAlignment, StatusBarItem, window } from 'vscode';
+import { PortHandle, portManager } from './PortManager';
 import { portSelector } from './PortSelector';
-import { SerialPort } from './SerialPort';
+import { READ_PROFILE_TERMINAL } from './SerialPort';
+
+// in capture mode the output channel shows only the last lines received within the interval
+const TAIL_INTERVAL = 250;
+const TAIL_LINES = 100;
+// the output channel is cleared when it reaches this number of lines in capture mode
+const MAX_CHANNEL_LINES = 10000;
 
 /**
  * Terminal state
@@ -18,8 +25,16 @@ class Terminal {
     public state: TERM_STATE = TERM_STATE.DISABLED;
     private channel: OutputChannel;
     private statusBarItem: StatusBarItem;
-    private port: SerialPort | null = null;
+    private port: PortHandle | null = null;
     private deviceName: string;
+    private captureFile: string | null = null;
+    private captureSize = 0;
+    private capturing = false;
+    private tail: string[] = [];
+    private tailPartial = '';
+    private skippedLines = 0;
+    private channelLines = 0;
+    private tailTimer: NodeJS.Timer | null = null;
 
     constructor() {
         this.channel = window.createOutputChannel('BLP-Device-Output');
@@ -47,18 +62,27 @@ class Terminal {
             }
             this.deviceName = selectedPort.deviceName;
 
-            this.port = new SerialPort(selectedPort.name, {
-                baudRate: 115200
+            // the port is shared with the uploader, which pauses the terminal during an upload
+            this.port = portManager.createSerialPort(selectedPort.name, {
+                baudRate: 115200,
+                readProfile: READ_PROFILE_TERMINAL
             });
+            this.port.onResume = () => {
+                this.addLine('> Resumed after upload');
+                this.port?.write(new Uint8Array([0]));
+            };
             this.port.open()
                 .then(() => {
                     this.addLine('> Connected to LED Basic device: ' + this.deviceName);
+                    this.startCapture();
 
                     if (this.port) {
                         this.port.setReadListener((data: Uint8Array) => {
                             // const msg = String.fromCharCode.apply(null, data);
                             const msg = new StringDecoder('utf8').write(Buffer.from(data));
-                            if (msg.startsWith('?ERROR')) {
+                            if (this.capturing) {
+                                this.addTail(msg);
+                            } else if (msg.startsWith('?ERROR')) {
                                 this.addLine(msg);
                             } else {
                                 this.addLine(msg);
@@ -80,11 +104,33 @@ class Terminal {
         } else {
             this.state = TERM_STATE.DISCONNECTED;
             this.update();
+            if (this.capturing) {
+                this.capturing = false;
+                if (this.tailPartial) {
+                    this.addTail('\n');
+                }
+                this.flushTail();
+            }
             this.addLine('> Disconnected from ' + this.deviceName);
             return this.port.close();
         }
     }
 
+    /**
+     * Sets the file the received data is captured to when the terminal connects. In capture mode the
+     * output channel shows only a throttled tail of the data.
+     * @param file - capture file or null to disable the capture mode
+     * @param size - maximal size of the captured data in bytes, older data is overwritten
+     */
+    public setCapture(file: string | null, size = 0) {
+        this.captureFile = file;
+        this.captureSize = size;
+    }
+
+    public getCaptureFile(): string | null {
+        return this.captureFile;
+    }
+
     public enable() {
         this.state = TERM_STATE.DISCONNECTED;
         this.update();
@@ -96,6 +142,9 @@ class Terminal {
     }
 
     public dispose() {
+        if (this.tailTimer) {
+            clearTimeout(this.tailTimer);
+        }
         this.statusBarItem.dispose();
         this.channel.dispose();
     }
@@ -105,6 +154,59 @@ class Terminal {
         this.channel.appendLine(message);
     }
 
+    private startCapture() {
+        this.capturing = false;
+        this.tailPartial = '';
+        if (!this.port || !this.captureFile) {
+            return;
+        }
+        try {
+            this.port.capture(this.captureFile, this.captureSize);
+            this.capturing = true;
+            this.channelLines = 0;
+            this.addLine('> Capturing device output to ' + this.captureFile);
+        } catch (error) {
+            this.addLine('> Capturing device output not possible: ' + (error as Error).message);
+        }
+    }
+
+    private addTail(message: string) {
+        const lines = (this.tailPartial + message).split('\n');
+        this.tailPartial = lines.pop() as string;
+        this.tail.push(...lines.map((line) => line.replace(/\r$/, '')));
+        if (this.tail.length > TAIL_LINES) {
+            this.skippedLines += this.tail.length - TAIL_LINES;
+            this.tail.splice(0, this.tail.length - TAIL_LINES);
+        }
+        if (!this.tailTimer) {
+            this.tailTimer = setTimeout(() => this.flushTail(), TAIL_INTERVAL);
+        }
+    }
+
+    private flushTail() {
+        if (this.tailTimer) {
+            clearTimeout(this.tailTimer);
+            this.tailTimer = null;
+        }
+        if (!this.tail.length && !this.skippedLines) {
+            return;
+        }
+        if (this.channelLines + this.tail.length > MAX_CHANNEL_LINES) {
+            this.channel.clear();
+            this.channelLines = 0;
+        }
+        if (this.skippedLines) {
+            this.channel.appendLine('> ' + this.skippedLines + ' lines skipped, see ' + this.captureFile);
+            this.channelLines++;
+        }
+        if (this.tail.length) {
+            this.channel.append(this.tail.join('\n') + '\n');
+            this.channelLines += this.tail.length;
+        }
+        this.tail = [];
+        this.skippedLines = 0;
+    }
+
     private update() {
         let label = 'Terminal';
 
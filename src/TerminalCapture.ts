@@ -0,0 +1,136 @@
+'use strict';
+
+import * as fs from 'fs';
+
+export const CAPTURE_FILE = 'terminal-capture.log';
+
+// layout of the capture file written by blp-serial, see blp-serial/src/capture.h
+const MAGIC = 'BLPCAP01';
+const OFFSET_CAPACITY = 8;
+const OFFSET_WRITTEN = 16;
+const OFFSET_ERROR_COUNT = 32;
+const OFFSET_ERRORS = 56;
+const INDEX_SIZE = 1024;
+const HEADER_SIZE = OFFSET_ERRORS + INDEX_SIZE * 8;
+const TIMESTAMP_SIZE = 24;
+// longer lines are cut when read back
+const MAX_LINE_SIZE = 1024;
+
+export interface ICaptureLine {
+    // position of the line in the capture, used to read its context
+    position: number;
+    time: string;
+    text: string;
+}
+
+/**
+ * Reads the rolling terminal log captured by the serial port. The log can be read while the capture is running.
+ */
+export class CaptureLogReader {
+    private capacity = 0;
+    private written = 0;
+    private errorCount = 0;
+    private index: Buffer = Buffer.alloc(0);
+
+    /**
+     * @param file - path of the capture file
+     */
+    constructor(private file: string) {
+    }
+
+    /**
+     * Returns the captured lines starting with ?ERROR which are still in the log, oldest first
+     */
+    public errors(): ICaptureLine[] {
+        this.readHeader();
+        const result: ICaptureLine[] = [];
+        for (let i = Math.max(0, this.errorCount - INDEX_SIZE); i < this.errorCount; i++) {
+            const position = Number(this.index.readBigUInt64LE((i % INDEX_SIZE) * 8));
+            if (position >= this.oldest()) {
+                const lines = this.lines(position, Math.min(this.written, position + MAX_LINE_SIZE));
+                if (lines.length) {
+                    result.push(lines[0]);
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Returns the lines around the line at the position
+     * @param position - position of a captured line
+     * @param before - maximal number of lines before the line
+     * @param after - maximal number of lines after the line
+     */
+    public around(position: number, before: number, after: number): ICaptureLine[] {
+        this.readHeader();
+        const start = Math.max(this.oldest(), position - before * MAX_LINE_SIZE);
+        const lines = this.lines(start, Math.min(this.written, position + (after + 1) * MAX_LINE_SIZE));
+        // the first line is incomplete unless the range starts at the line or at the begin of the capture
+        if (start !== position && start !== 0 && lines.length) {
+            lines.shift();
+        }
+        const index = lines.findIndex((line) => line.position === position);
+        if (index === -1) {
+            return [];
+        }
+        return lines.slice(Math.max(0, index - before), index + after + 1);
+    }
+
+    private readHeader() {
+        const fd = fs.openSync(this.file, 'r');
+        try {
+            const header = Buffer.alloc(HEADER_SIZE);
+            if (fs.readSync(fd, header, 0, HEADER_SIZE, 0) !== HEADER_SIZE || header.toString('latin1', 0, MAGIC.length) !== MAGIC) {
+                throw new Error('Invalid terminal capture file ' + this.file);
+            }
+            this.capacity = Number(header.readBigUInt64LE(OFFSET_CAPACITY));
+            this.written = Number(header.readBigUInt64LE(OFFSET_WRITTEN));
+            this.errorCount = Number(header.readBigUInt64LE(OFFSET_ERROR_COUNT));
+            this.index = header.subarray(OFFSET_ERRORS);
+        } finally {
+            fs.closeSync(fd);
+        }
+    }
+
+    /**
+     * Position of the oldest data which was not overwritten yet
+     */
+    private oldest(): number {
+        return Math.max(0, this.written - this.capacity);
+    }
+
+    /**
+     * Reads the data between the positions and splits it into lines
+     */
+    private lines(start: number, end: number): ICaptureLine[] {
+        const data = Buffer.alloc(end - start);
+        const fd = fs.openSync(this.file, 'r');
+        try {
+            // the range wraps around at the end of the ring buffer
+            const offset = start % this.capacity;
+            const first = Math.min(data.length, this.capacity - offset);
+            fs.readSync(fd, data, 0, first, HEADER_SIZE + offset);
+            if (first < data.length) {
+                fs.readSync(fd, data, first, data.length - first, HEADER_SIZE);
+            }
+        } finally {
+            fs.closeSync(fd);
+        }
+
+        const result: ICaptureLine[] = [];
+        let lineStart = 0;
+        while (lineStart < data.length) {
+            let lineEnd = data.indexOf(10, lineStart);
+            lineEnd = lineEnd === -1 ? data.length : lineEnd + 1;
+            const line = data.toString('utf8', lineStart, lineEnd).replace(/\r?\n$/, '');
+            result.push({
+                position: start + lineStart,
+                time: line.substring(0, TIMESTAMP_SIZE - 1),
+                text: line.substring(TIMESTAMP_SIZE)
+            });
+            lineStart = lineEnd;
+        }
+        return result;
+    }
+}
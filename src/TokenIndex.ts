@@ -0,0 +1,234 @@
+'use strict';
+
+import { Position, Range, TextDocument, TextDocumentContentChangeEvent } from 'vscode';
+
+export enum OCCURRENCE {
+    // variables and other plain identifiers
+    IDENTIFIER,
+    // label after goto, gosub or read
+    JUMP,
+    // label definition at the start of a line
+    LABEL,
+    // library and function names of calls like LED.show
+    MEMBER
+}
+
+interface IToken {
+    // lower case name, LED Basic is case insensitive
+    name: string;
+    character: number;
+    length: number;
+    kind: OCCURRENCE;
+}
+
+interface ILine {
+    // line number, only valid up to the first renumbered line of the document
+    index: number;
+    text: string;
+    tokens: IToken[];
+}
+
+interface IIndexedDocument {
+    version: number;
+    lines: ILine[];
+    // lines containing each name
+    occurrences: Map<string, Set<ILine>>;
+    // first line with an outdated line number
+    renumber: number;
+}
+
+const REG_WORD = /[a-zA-Z0-9_]/;
+const JUMP_KEYWORDS = new Set(['goto', 'gosub', 'read']);
+
+/**
+ * Inverted index of the identifiers of each document. Comments and strings are not indexed.
+ * Edits re-tokenize the changed lines only, a query takes the lines containing the name.
+ */
+class TokenIndex {
+    private documents = new Map<string, IIndexedDocument>();
+
+    /**
+     * Returns the ranges of a name in the document in line order
+     * @param document - LED Basic document
+     * @param name - identifier or label, case insensitive
+     * @param kinds - kinds of occurrences to return
+     */
+    public find(document: TextDocument, name: string, kinds: OCCURRENCE[]): Range[] {
+        const indexed = this.get(document);
+        const lines = indexed.occurrences.get(name.toLowerCase());
+        if (!lines) {
+            return [];
+        }
+        if (indexed.renumber < indexed.lines.length) {
+            for (let index = indexed.renumber; index < indexed.lines.length; index++) {
+                indexed.lines[index].index = index;
+            }
+            indexed.renumber = indexed.lines.length;
+        }
+
+        const key = name.toLowerCase();
+        const result: Range[] = [];
+        Array.from(lines).sort((a, b) => a.index - b.index).forEach((line) => {
+            line.tokens.forEach((token) => {
+                if (token.name === key && kinds.indexOf(token.kind) >= 0) {
+                    result.push(new Range(line.index, token.character, line.index, token.character + token.length));
+                }
+            });
+        });
+        return result;
+    }
+
+    /**
+     * Returns the kind of the token at a position or undefined outside of the indexed tokens
+     * @param document - LED Basic document
+     * @param position - position inside or at the end of the token
+     */
+    public kindAt(document: TextDocument, position: Position): OCCURRENCE | undefined {
+        const line = this.get(document).lines[position.line];
+        const token = line && line.tokens.find((t) => t.character <= position.character
+            && position.character <= t.character + t.length);
+        return token ? token.kind : undefined;
+    }
+
+    /**
+     * Applies the changes of an edit to the index of the document. The index is dropped if it missed
+     * a version and rebuilt on the next query.
+     * @param document - changed document
+     * @param changes - content changes of the edit in the order they are applied
+     */
+    public update(document: TextDocument, changes: readonly TextDocumentContentChangeEvent[]) {
+        const key = document.uri.toString();
+        const indexed = this.documents.get(key);
+        if (!indexed) {
+            return;
+        }
+        if (indexed.version !== document.version - 1) {
+            this.documents.delete(key);
+            return;
+        }
+
+        changes.forEach((change) => {
+            const start = change.range.start;
+            const end = change.range.end;
+            const text = indexed.lines[start.line].text.substring(0, start.character) + change.text
+                + indexed.lines[end.line].text.substring(end.character);
+            const added = text.split(/\r?\n/).map((lineText) => this.createLine(lineText));
+
+            const removed = indexed.lines.splice(start.line, end.line - start.line + 1, ...added);
+            removed.forEach((line) => this.removeLine(indexed, line));
+            added.forEach((line) => this.addLine(indexed, line));
+            if (added.length !== removed.length) {
+                indexed.renumber = Math.min(indexed.renumber, start.line);
+            }
+            // the unchanged line numbers stay valid
+            added.forEach((line, offset) => line.index = start.line + offset);
+        });
+        indexed.version = document.version;
+    }
+
+    /**
+     * Removes the index of a closed document
+     * @param document - LED Basic document
+     */
+    public forget(document: TextDocument) {
+        this.documents.delete(document.uri.toString());
+    }
+
+    private get(document: TextDocument): IIndexedDocument {
+        const key = document.uri.toString();
+        const cached = this.documents.get(key);
+        if (cached && cached.version === document.version) {
+            return cached;
+        }
+
+        const indexed: IIndexedDocument = {
+            version: document.version,
+            lines: [],
+            occurrences: new Map(),
+            renumber: document.lineCount
+        };
+        for (let index = 0; index < document.lineCount; index++) {
+            const line = this.createLine(document.lineAt(index).text);
+            line.index = index;
+            indexed.lines.push(line);
+            this.addLine(indexed, line);
+        }
+        this.documents.set(key, indexed);
+        return indexed;
+    }
+
+    private addLine(indexed: IIndexedDocument, line: ILine) {
+        line.tokens.forEach((token) => {
+            let lines = indexed.occurrences.get(token.name);
+            if (!lines) {
+                lines = new Set();
+                indexed.occurrences.set(token.name, lines);
+            }
+            lines.add(line);
+        });
+    }
+
+    private removeLine(indexed: IIndexedDocument, line: ILine) {
+        line.tokens.forEach((token) => {
+            const lines = indexed.occurrences.get(token.name);
+            if (lines) {
+                lines.delete(line);
+                if (!lines.size) {
+                    indexed.occurrences.delete(token.name);
+                }
+            }
+        });
+    }
+
+    /**
+     * Splits a source line into its identifiers, the rest of the line after ' or REM and strings are skipped
+     * @param text - source line
+     */
+    private createLine(text: string): ILine {
+        const tokens: IToken[] = [];
+        let previous = '';
+        let index = 0;
+        while (index < text.length) {
+            const char = text[index];
+            if (char === '\'') {
+                break;
+            }
+            if (char === '"') {
+                index++;
+                while (index < text.length && text[index] !== '"') {
+                    index += text[index] === '\\' ? 2 : 1;
+                }
+                index++;
+                previous = '';
+                continue;
+            }
+            if (!REG_WORD.test(char)) {
+                index++;
+                continue;
+            }
+
+            const start = index;
+            while (index < text.length && REG_WORD.test(text[index])) {
+                index++;
+            }
+            const name = text.substring(start, index).toLowerCase();
+            if (name === 'rem') {
+                break;
+            }
+
+            let kind = OCCURRENCE.IDENTIFIER;
+            if (JUMP_KEYWORDS.has(previous)) {
+                kind = OCCURRENCE.JUMP;
+            } else if (text[start - 1] === '.' || text[index] === '.') {
+                kind = OCCURRENCE.MEMBER;
+            } else if (!tokens.length && /^\s*:/.test(text.substring(index))) {
+                kind = OCCURRENCE.LABEL;
+            }
+            tokens.push({ name, character: start, length: index - start, kind });
+            previous = name;
+        }
+        return { index: 0, text, tokens };
+    }
+}
+
+export const tokenIndex = new TokenIndex();
@@ -0,0 +1,167 @@
+'use strict';
+
+import { performance } from 'perf_hooks';
+import { IUploadRecorder } from './Common';
+
+// upper bounds of the packet latency histogram buckets in milliseconds, the last bucket is open
+const LATENCY_BUCKETS = [5, 10, 20, 50, 100, 200, 500];
+
+export interface IUploadEvent {
+    phase: string;
+    // start time relative to the start of the upload and duration in milliseconds
+    start: number;
+    duration: number;
+    bytes?: number;
+}
+
+export interface IUploadProgress {
+    sentBytes: number;
+    totalBytes: number;
+    bytesPerSecond: number;
+    // estimated remaining time in milliseconds
+    eta: number;
+}
+
+export interface IUploadReport {
+    duration: number;
+    totalBytes: number;
+    sentBytes: number;
+    bytesPerSecond: number;
+    // time of each phase in milliseconds without the time of the phases nested in it, the phases
+    // add up to the time covered by events
+    phases: { [phase: string]: number };
+    // time of each phase in milliseconds including the nested phases
+    phaseTotals: { [phase: string]: number };
+    // number of packets with a latency up to the bucket bound, key is the bound or '>' + last bound
+    latencyHistogram: { [bucket: string]: number };
+    events: IUploadEvent[];
+    // message of the error which ended the upload
+    error?: string;
+}
+
+/**
+ * Collects timing events of an upload. Provides the live throughput of the written packets
+ * and a report with the time spent in each phase.
+ */
+export class UploadTelemetry implements IUploadRecorder {
+    public onProgress: ((progress: IUploadProgress) => void) | null = null;
+    private startTime = performance.now();
+    private firstPacket = 0;
+    private events: IUploadEvent[] = [];
+    private totalBytes = 0;
+    private sentBytes = 0;
+    private error: string | undefined;
+
+    /**
+     * Sets the number of bytes the upload is going to write
+     * @param bytes - expected number of bytes
+     */
+    public expect(bytes: number) {
+        this.totalBytes = bytes;
+    }
+
+    /**
+     * Records a finished operation. Packets (phase 'packet') with their size update the progress.
+     * @param phase - name of the phase
+     * @param start - start time of the operation from performance.now()
+     * @param bytes - number of written bytes
+     */
+    public record(phase: string, start: number, bytes?: number) {
+        const now = performance.now();
+        this.events.push({
+            phase,
+            start: start - this.startTime,
+            duration: now - start,
+            bytes
+        });
+
+        if (phase === 'packet' && bytes) {
+            if (!this.firstPacket) {
+                this.firstPacket = start;
+            }
+            this.sentBytes += bytes;
+            if (this.onProgress) {
+                this.onProgress(this.progress(now));
+            }
+        }
+    }
+
+    /**
+     * Measures the time of an asynchronous operation
+     * @param phase - name of the phase
+     * @param operation - operation to measure
+     */
+    public measure<T>(phase: string, operation: () => Promise<T>): Promise<T> {
+        const start = performance.now();
+        return operation()
+            .then((result) => {
+                this.record(phase, start);
+                return result;
+            });
+    }
+
+    /**
+     * Marks the upload as failed, the report keeps the error message
+     * @param error - error which ended the upload
+     */
+    public fail(error: Error) {
+        this.error = error.message;
+    }
+
+    public report(): IUploadReport {
+        const phases: { [phase: string]: number } = {};
+        const phaseTotals: { [phase: string]: number } = {};
+        const latencyHistogram: { [bucket: string]: number } = {};
+        LATENCY_BUCKETS.forEach((bound) => latencyHistogram[bound] = 0);
+        latencyHistogram['>' + LATENCY_BUCKETS[LATENCY_BUCKETS.length - 1]] = 0;
+
+        // operations run one after the other, an event within the time of another one is nested in it,
+        // e.g. the write and the ack of a packet
+        const sorted = this.events.slice().sort((a, b) => a.start - b.start || b.duration - a.duration);
+        const nestedTime = new Map<IUploadEvent, number>();
+        const open: IUploadEvent[] = [];
+        sorted.forEach((event) => {
+            while (open.length && open[open.length - 1].start + open[open.length - 1].duration < event.start + event.duration) {
+                open.pop();
+            }
+            if (open.length) {
+                const parent = open[open.length - 1];
+                nestedTime.set(parent, (nestedTime.get(parent) || 0) + event.duration);
+            }
+            open.push(event);
+        });
+
+        this.events.forEach((event) => {
+            phases[event.phase] = (phases[event.phase] || 0) + event.duration - (nestedTime.get(event) || 0);
+            phaseTotals[event.phase] = (phaseTotals[event.phase] || 0) + event.duration;
+            if (event.phase === 'packet') {
+                const bound = LATENCY_BUCKETS.find((b) => event.duration <= b);
+                latencyHistogram[bound !== undefined ? bound : '>' + LATENCY_BUCKETS[LATENCY_BUCKETS.length - 1]]++;
+            }
+        });
+
+        return {
+            duration: performance.now() - this.startTime,
+            totalBytes: this.totalBytes,
+            sentBytes: this.sentBytes,
+            bytesPerSecond: this.progress(performance.now()).bytesPerSecond,
+            phases,
+            phaseTotals,
+            latencyHistogram,
+            events: this.events,
+            error: this.error
+        };
+    }
+
+    private progress(now: number): IUploadProgress {
+        const elapsed = this.firstPacket ? now - this.firstPacket : 0;
+        const bytesPerSecond = elapsed ? Math.round(this.sentBytes * 1000 / elapsed) : 0;
+        const remaining = Math.max(0, this.totalBytes - this.sentBytes);
+        return {
+            sentBytes: this.sentBytes,
+            totalBytes: this.totalBytes,
+            bytesPerSecond,
+            eta: bytesPerSecond ? Math.round(remaining * 1000 / bytesPerSecond) : 0
+        };
+    }
+}
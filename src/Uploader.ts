@@ -1,17 +1,27 @@
 'use strict';
 // tslint:disable: no-console no-unused-expression
 import { IDevice, IDevUploader, ISerialPortFactory, ISerialPortInfo } from './Common';
+import { SBPROG_SYSCODE } from './DeviceList';
 import { DeviceUploader } from './DeviceUploader';
+import { imageCache, PAGE_SIZE } from './ImageCache';
 import { SBProgUploader } from './SBProgUploader';
-
-const SBPROG_SYSCODE = 0x4470;
+import { UploadTelemetry } from './UploadTelemetry';
 
 const DEBUG = false;
 
 export class Uploader {
+    // number of pages written by the last upload and the total number of pages of the image
+    public writtenPages: number = 0;
+    public totalPages: number = 0;
+    // timing events of the last upload
+    public telemetry = new UploadTelemetry();
     private devUploader: IDevUploader;
+    private portInfo: ISerialPortInfo;
+    private device: IDevice;
 
     constructor(portInfo: ISerialPortInfo, device: IDevice, portFactory: ISerialPortFactory) {
+        this.portInfo = portInfo;
+        this.device = device;
         if (portInfo.sysCode === SBPROG_SYSCODE) {
             this.devUploader = new SBProgUploader(portInfo, device, portFactory);
         } else {
@@ -19,12 +29,49 @@ export class Uploader {
         }
     }
 
-    public upload(file: Uint8Array): Promise<string> {
+    /**
+     * Uploads the image to the device. Only pages which changed since the last upload to the same device
+     * are written, unless a full flash is requested. If the device rejects a page the whole image is written.
+     * @param file - LBO image
+     * @param fullFlash - write all pages of the image
+     */
+    public upload(file: Uint8Array, fullFlash = false): Promise<string> {
+        const key = imageCache.key(this.portInfo, this.device.meta.sysCode);
+        const pages = key && !fullFlash ? imageCache.changedPages(key, file) : null;
+        this.totalPages = Math.trunc((file.length + PAGE_SIZE - 1) / PAGE_SIZE);
+        this.writtenPages = pages ? pages.length : this.totalPages;
+        // the content of the device is unknown until the upload is complete
+        if (key) {
+            imageCache.invalidate(key);
+        }
+
+        const telemetry = this.telemetry;
+        // the last page is usually not complete
+        const expectedBytes = pages ? pages.reduce((sum, index) => sum + Math.min(PAGE_SIZE, file.length - index * PAGE_SIZE), 0) : file.length;
+        telemetry.expect(expectedBytes);
+        this.devUploader.recorder = telemetry;
+
         return new Promise((resolve, reject) => {
-            this.devUploader.open()
-                .then(() => this.devUploader.sendData(file))
-                .then(() => this.devUploader.close())
-                .then(() => this.devUploader.reset())
+            telemetry.measure('open', () => this.devUploader.open())
+                .then(() => this.devUploader.sendData(file, pages || undefined))
+                .catch((error) => {
+                    if (!pages) {
+                        throw error;
+                    }
+                    DEBUG && console.log('[UPLOAD] upload - partial upload failed, writing all pages');
+                    this.writtenPages = this.totalPages;
+                    telemetry.expect(expectedBytes + file.length);
+                    return (this.devUploader.isOpen() ? this.devUploader.close() : Promise.resolve())
+                        .then(() => telemetry.measure('open', () => this.devUploader.open()))
+                        .then(() => this.devUploader.sendData(file));
+                })
+                .then(() => telemetry.measure('close', () => this.devUploader.close()))
+                .then(() => {
+                    if (key) {
+                        imageCache.set(key, file);
+                    }
+                    return telemetry.measure('reset', () => this.devUploader.reset());
+                })
                 .then((error) => {
                     if (error) {
                         DEBUG && console.log('[UPLOAD] upload - received error from device');
@@ -39,6 +86,7 @@ export class Uploader {
                     }
                 })
                 .catch((error) => {
+                    telemetry.fail(error);
                     if (this.devUploader.isOpen()) {
                         this.devUploader.close()
                             .then(() => reject(error));
@@ -0,0 +1,475 @@
+#!/usr/bin/env node
+'use strict';
+// tslint:disable: no-console
+
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { performance } from 'perf_hooks';
+import { isMainThread, parentPort, Worker } from 'worker_threads';
+import { CodeInterpreter, LedFramebuffer } from './CodeInterpreter';
+import { decodeErrorMessage, IMatchResult, IParseResult, ISerialPortFactory, parseResultToArray } from './Common';
+import { Device } from './Device';
+import { formatCost } from './CostEstimator';
+import { checkCalls, DEFAULT_DEVICE, findDevice, SBPROG_SYSCODE } from './DeviceList';
+import { grammarRegistry } from './GrammarRegistry';
+import { LEDBasicParserFactory } from './LEDBasicParserFactory';
+// SerialPort and Uploader are loaded by flashAll only, the native serial addon cannot be loaded by the worker threads
+
+const USAGE = `Usage: led-basic [options] <file.bas | directory>...
+       led-basic run [options] <file.bas>
+
+Compiles LED Basic programs to .lbo code images, the files of a directory are compiled in parallel.
+The run command executes a program on the host interpreter instead, e.g. to test shows in CI. It
+exits with 1 on compile and runtime errors.
+
+Options:
+  --device <sysCode>   system code of the target device, e.g. 0x3130
+  --out <dir>          directory of the code images, default is the directory of each program
+  --optimize           optimize the code like the setting led_basic.optimizeCode
+  --case-insensitive-calls
+                       accept library calls in any case like the setting led_basic.caseInsensitiveCalls
+  --jobs <n>           number of parallel compilations, default is the number of CPU cores
+  --flash <ports>      comma separated serial ports to upload the images to. A single image is
+                       uploaded to all ports, otherwise the images are uploaded in file name order
+                       to the ports in the listed order.
+  --full               write all pages on upload, also the unchanged ones
+
+Options of run:
+  --frames <n>         stop after n frames, default is 100
+  --steps <n>          stop after n statements, default is 10000000
+  --time <ms>          stop after the device time in milliseconds
+  --seed <n>           seed of the random numbers, default is 1
+  --dump-frames        print the LED colours of each frame as RRGGBB(WW) values
+`;
+
+// default limits of run, programs without delays or frames are stopped by the statement limit
+const RUN_FRAMES = 100;
+const RUN_STEPS = 10000000;
+
+interface ICliOptions {
+    run: boolean;
+    files: string[];
+    device: Device;
+    out: string | null;
+    optimize: boolean;
+    caseInsensitiveCalls: boolean;
+    jobs: number;
+    ports: string[];
+    fullFlash: boolean;
+    // limits and output of run
+    frames: number;
+    steps: number;
+    time?: number;
+    seed: number;
+    dumpFrames: boolean;
+}
+
+interface ICompileJob {
+    file: string;
+    output: string;
+    sysCode: number;
+    optimize: boolean;
+    caseInsensitiveCalls: boolean;
+}
+
+interface ICompileResult {
+    file: string;
+    output: string;
+    success: boolean;
+    // compile time in milliseconds
+    time: number;
+    image?: Uint8Array;
+    messages: string[];
+}
+
+/**
+ * Compiles a program for the device. Returns the code image or null and the messages of the compiler.
+ */
+function compileProgram(file: string, device: Device, optimize: boolean, caseInsensitiveCalls: boolean)
+    : { image: Uint8Array | null, messages: string[] } {
+    const text = fs.readFileSync(file).toString();
+    const parser = LEDBasicParserFactory.getParser();
+
+    // check the library calls against the device like the validator of the editor
+    const matchResult = parser.match(text);
+    const callErrors = checkCalls(matchResult.calls || [], device, caseInsensitiveCalls)
+        .map((error) => file + ':' + location(text, error.call.start) + ': ' + error.message);
+    if (callErrors.length) {
+        return { image: null, messages: callErrors };
+    }
+
+    const result = parser.build(text, {
+        optimize,
+        removeDeadCode: optimize,
+        verify: true
+    });
+    if (!result.success) {
+        return {
+            image: null,
+            messages: ((result as IMatchResult).errors || []).map((error) =>
+                file + ':' + (error.range.start.line + 1) + ':' + error.range.start.character + ': ' + error.message)
+        };
+    }
+
+    const parseResult = result as IParseResult;
+    return {
+        image: parseResultToArray(parseResult, device.meta),
+        messages: (parseResult.warnings || []).map((warning) => file + ': ' + warning)
+    };
+}
+
+/**
+ * Compiles a single program and writes the code image. Runs in the worker threads.
+ */
+function compile(job: ICompileJob): ICompileResult {
+    const device = findDevice(job.sysCode) || DEFAULT_DEVICE;
+    const start = performance.now();
+    const compiled = compileProgram(job.file, device, job.optimize, job.caseInsensitiveCalls);
+    const time = performance.now() - start;
+    if (compiled.image) {
+        fs.writeFileSync(job.output, compiled.image);
+    }
+    return {
+        file: job.file,
+        output: job.output,
+        success: !!compiled.image,
+        time,
+        image: compiled.image || undefined,
+        messages: compiled.messages
+    };
+}
+
+/**
+ * Returns the colours of the LEDs set by the program as hex values
+ */
+function frameColours(framebuffer: LedFramebuffer): string {
+    const colours: string[] = [];
+    for (let led = 0; led < framebuffer.ledcnt; led++) {
+        colours.push(framebuffer.rgb(led).map((value) => value.toString(16).padStart(2, '0')).join(''));
+    }
+    return colours.join(' ');
+}
+
+/**
+ * Runs a program on the host interpreter until it ends, fails or reaches one of the limits. Print
+ * output and the dumped frames go to stdout, the summary to stderr. Returns the exit code.
+ */
+function runProgram(options: ICliOptions): number {
+    const file = options.files[0];
+    const compiled = compileProgram(file, options.device, options.optimize, options.caseInsensitiveCalls);
+    compiled.messages.forEach((message) => console.error(message));
+    if (!compiled.image) {
+        return 1;
+    }
+
+    const vm = new CodeInterpreter(compiled.image, {
+        costs: options.device.costs,
+        seed: options.seed,
+        onPrint: (text) => console.log(text),
+        onFrame: options.dumpFrames ? (framebuffer) => {
+            console.log('frame ' + vm.frames + ' ' + (vm.time / 1000).toFixed(1) + ' ms: ' + frameColours(framebuffer));
+        } : undefined
+    });
+    const result = vm.run({
+        maxFrames: options.frames,
+        maxSteps: options.steps,
+        maxTime: options.time === undefined ? undefined : options.time * 1000
+    });
+
+    const stopped = {
+        end: 'Program ended',
+        error: 'Program failed',
+        frames: 'Stopped at the frame limit',
+        steps: 'Stopped at the statement limit',
+        time: 'Stopped at the time limit'
+    };
+    console.error(stopped[result.reason] + ' after ' + result.steps + ' statements, ' + result.frames + ' frames, '
+        + formatCost(result.time) + ' device time');
+    if (result.error) {
+        const deviceError = decodeErrorMessage(result.error.message);
+        console.error(deviceError ? deviceError.msg : result.error.message);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Returns line and column of an offset in the format of the compile errors
+ */
+function location(text: string, offset: number): string {
+    const lines = text.substring(0, offset).split(/\r?\n/);
+    return lines.length + ':' + (lines[lines.length - 1].length + 1);
+}
+
+function parseArguments(args: string[]): ICliOptions | null {
+    const options: ICliOptions = {
+        run: args[0] === 'run',
+        files: [],
+        device: DEFAULT_DEVICE,
+        out: null,
+        optimize: false,
+        caseInsensitiveCalls: false,
+        // cpus() is empty if the CPUs can't be read, e.g. in some containers
+        jobs: Math.max(1, os.cpus().length),
+        ports: [],
+        fullFlash: false,
+        frames: RUN_FRAMES,
+        steps: RUN_STEPS,
+        seed: 1,
+        dumpFrames: false
+    };
+    const count = (arg: string, text: string) => {
+        const result = parseInt(text, 10);
+        if (isNaN(result) || result < 0) {
+            throw new Error('Invalid value of ' + arg);
+        }
+        return result;
+    };
+
+    for (let i = options.run ? 1 : 0; i < args.length; i++) {
+        const arg = args[i];
+        const value = () => {
+            if (i + 1 >= args.length) {
+                throw new Error('Missing value of ' + arg);
+            }
+            return args[++i];
+        };
+        switch (arg) {
+            case '--device': {
+                const sysCode = parseInt(value(), 16);
+                const device = findDevice(sysCode);
+                if (!device) {
+                    throw new Error('Unknown device 0x' + sysCode.toString(16));
+                }
+                options.device = device;
+                break;
+            }
+            case '--out':
+                options.out = value();
+                break;
+            case '--optimize':
+                options.optimize = true;
+                break;
+            case '--case-insensitive-calls':
+                options.caseInsensitiveCalls = true;
+                break;
+            case '--jobs':
+                options.jobs = Math.max(1, parseInt(value(), 10) || 1);
+                break;
+            case '--flash':
+                options.ports = value().split(',').filter((port) => port);
+                break;
+            case '--full':
+                options.fullFlash = true;
+                break;
+            case '--frames':
+                options.frames = count(arg, value());
+                break;
+            case '--steps':
+                options.steps = count(arg, value());
+                break;
+            case '--time':
+                options.time = count(arg, value());
+                break;
+            case '--seed':
+                options.seed = count(arg, value());
+                break;
+            case '--dump-frames':
+                options.dumpFrames = true;
+                break;
+            case '--help':
+                return null;
+            default:
+                if (arg.startsWith('--')) {
+                    throw new Error('Unknown option ' + arg);
+                }
+                options.files.push(...programFiles(arg));
+        }
+    }
+    if (options.run && options.files.length !== 1) {
+        throw new Error('run needs a single program');
+    }
+    return options.files.length ? options : null;
+}
+
+/**
+ * Returns the program files of a directory or the file itself
+ */
+function programFiles(file: string): string[] {
+    if (!fs.statSync(file).isDirectory()) {
+        return [file];
+    }
+    return fs.readdirSync(file)
+        .filter((name) => name.toLowerCase().endsWith('.bas'))
+        .sort()
+        .map((name) => path.join(file, name));
+}
+
+/**
+ * Compiles the programs on a pool of worker threads, each worker takes the next program when done
+ */
+function compileAll(options: ICliOptions): Promise<ICompileResult[]> {
+    const jobs: ICompileJob[] = options.files.map((file) => ({
+        file,
+        output: path.join(options.out || path.dirname(file), path.basename(file, path.extname(file)) + '.lbo'),
+        sysCode: options.device.meta.sysCode,
+        optimize: options.optimize,
+        caseInsensitiveCalls: options.caseInsensitiveCalls
+    }));
+    const results: ICompileResult[] = new Array(jobs.length);
+    let next = 0;
+
+    const runWorker = () => new Promise<void>((resolve, reject) => {
+        const worker = new Worker(__filename);
+        const post = () => {
+            if (next < jobs.length) {
+                worker.postMessage({ index: next, job: jobs[next++] });
+            } else {
+                worker.terminate().then(() => resolve());
+            }
+        };
+        worker.on('message', (message: { index: number, result: ICompileResult }) => {
+            results[message.index] = message.result;
+            post();
+        });
+        worker.on('error', reject);
+        post();
+    });
+
+    const workers: Array<Promise<void>> = [];
+    for (let i = 0; i < Math.min(options.jobs, jobs.length); i++) {
+        workers.push(runWorker());
+    }
+    return Promise.all(workers).then(() => results);
+}
+
+/**
+ * Uploads the images to the ports, different ports are written at the same time
+ */
+function flashAll(options: ICliOptions, images: ICompileResult[]): Promise<boolean> {
+    if (images.length !== 1 && images.length !== options.ports.length) {
+        console.error('Cannot assign ' + images.length + ' images to ' + options.ports.length + ' ports');
+        return Promise.resolve(false);
+    }
+    const device = options.device;
+
+    return Promise.all([import('./SerialPort'), import('./Uploader')])
+        .catch((error: Error) => {
+            // the addon loads only if blp-serial/build.js built it for this Node version
+            throw new Error('Cannot load the serial addon for Node ' + process.versions.node + ' (' + error.message
+                + '). Run "npm run build" in blp-serial to upload from the command line.');
+        })
+        .then(([{ SerialPort }, { Uploader }]) => {
+            const portFactory: ISerialPortFactory = {
+                createSerialPort: (name, portOptions) => new SerialPort(name, portOptions)
+            };
+            return SerialPort.list().then((found) => ({ found, portFactory, Uploader }));
+        })
+        .then(({ found, portFactory, Uploader }) => Promise.all(options.ports.map((name, index) => {
+            const image = images.length === 1 ? images[0] : images[index];
+            const port = found.find((info) => info.name === name);
+            if (!port) {
+                console.error(name + ': serial port not found');
+                return false;
+            }
+            // SB-Prog checks the device during the upload
+            if (port.sysCode !== SBPROG_SYSCODE && port.sysCode !== device.meta.sysCode) {
+                console.error(name + ': connected device ' + port.deviceName + ' does not match ' + device.label);
+                return false;
+            }
+            const uploader = new Uploader(port, device, portFactory);
+            return uploader.upload(image.image as Uint8Array, options.fullFlash)
+                .then((error) => {
+                    const report = uploader.telemetry.report();
+                    console.log(name + ': ' + path.basename(image.output) + ', ' + uploader.writtenPages + ' of '
+                        + uploader.totalPages + ' pages in ' + Math.round(report.duration) + ' ms');
+                    const deviceError = error ? decodeErrorMessage(error) : null;
+                    if (deviceError) {
+                        console.error(name + ': device message ' + deviceError.msg);
+                        return false;
+                    }
+                    return true;
+                })
+                .catch((error: Error) => {
+                    const report = uploader.telemetry.report();
+                    console.error(name + ': ' + error.message);
+                    console.error(name + ': failed after ' + Math.round(report.duration) + ' ms, ' + Object.keys(report.phases)
+                        .map((phase) => phase + ' ' + Math.round(report.phases[phase]) + ' ms').join(', '));
+                    return false;
+                });
+        })))
+        .then((results) => results.every((ok) => ok));
+}
+
+function main(args: string[]): Promise<number> {
+    let options: ICliOptions | null;
+    try {
+        options = parseArguments(args);
+    } catch (error) {
+        console.error((error as Error).message);
+        return Promise.resolve(2);
+    }
+    if (!options) {
+        console.log(USAGE);
+        return Promise.resolve(2);
+    }
+    const cliOptions = options;
+    if (cliOptions.run) {
+        return Promise.resolve(runProgram(cliOptions));
+    }
+    if (cliOptions.out) {
+        fs.mkdirSync(cliOptions.out, { recursive: true });
+    }
+
+    const start = performance.now();
+    return compileAll(cliOptions)
+        .then((results) => {
+            const width = Math.max(4, ...results.map((result) => path.basename(result.file).length));
+            console.log('file'.padEnd(width) + 'time [ms]'.padStart(12) + 'size [bytes]'.padStart(14));
+            results.forEach((result) => {
+                console.log(path.basename(result.file).padEnd(width) + result.time.toFixed(1).padStart(12)
+                    + (result.image ? String(result.image.length) : 'failed').padStart(14));
+                result.messages.forEach((message) => console.log('  ' + message));
+            });
+            const compiled = results.filter((result) => result.success);
+            console.log('Compiled ' + compiled.length + ' of ' + results.length + ' programs in '
+                + Math.round(performance.now() - start) + ' ms');
+
+            if (compiled.length !== results.length) {
+                return 1;
+            }
+            if (!cliOptions.ports.length) {
+                return 0;
+            }
+            return flashAll(cliOptions, compiled).then((ok) => ok ? 0 : 1);
+        });
+}
+
+if (isMainThread) {
+    main(process.argv.slice(2))
+        .then((code) => process.exit(code))
+        .catch((error: Error) => {
+            console.error(error.message);
+            process.exit(1);
+        });
+} else if (parentPort) {
+    const port = parentPort;
+    // compile the grammar before the first program, so the times show the compilation only
+    grammarRegistry.get();
+    port.on('message', (message: { index: number, job: ICompileJob }) => {
+        let result: ICompileResult;
+        try {
+            result = compile(message.job);
+        } catch (error) {
+            result = {
+                file: message.job.file,
+                output: message.job.output,
+                success: false,
+                time: 0,
+                messages: [message.job.file + ': ' + (error as Error).message]
+            };
+        }
+        port.postMessage({ index: message.index, result });
+    });
+}
@@ -1,32 +1,51 @@
+import * as fs from 'fs';
+import * as path from 'path';
+import { performance } from 'perf_hooks';
 import * as vscode from 'vscode';
 
 import { decodeErrorMessage, IParseResult, parseResultToArray } from './Common';
+import { compileCache } from './CompileCache';
+import { formatCost } from './CostEstimator';
 import { Device } from './Device';
+import { SBPROG_SYSCODE } from './DeviceList';
 import { deviceSelector } from './DeviceSelector';
+import { grammarRegistry } from './GrammarRegistry';
 import { LEDBasicCodeValidator } from './LEDBasicCodeValidator';
 import { LEDBasicCompletionItemProvider } from './LEDBasicCompletionItemProvider';
+import { costAnalyzer } from './LEDBasicCostAnalyzer';
 import { LEDBasicDefinitionProvider } from './LEDBasicDefinitionProvider';
 import { LEDBasicDocumentFormatter } from './LEDBasicDocumentFormatter';
 import { LEDBasicDocumentSymbolProvider } from './LEDBasicDocumentSymbolProvider';
 import { LEDBasicHoverProvider } from './LEDBasicHoverProvider';
 import { LEDBasicParserFactory } from './LEDBasicParserFactory';
+import { profiler } from './LEDBasicProfiler';
 import { LEDBasicReferenceProvider } from './LEDBasicReferenceProvider';
 import { LEDBasicSignatureHelpProvider } from './LEDBasicSignatureHelpProvider';
 import { output } from './OutputChannel';
+import { portManager } from './PortManager';
 import { portSelector } from './PortSelector';
 import { SerialPort } from './SerialPort';
 import { TERM_STATE, terminal } from './Terminal';
+import { CAPTURE_FILE, CaptureLogReader, ICaptureLine } from './TerminalCapture';
+import { tokenIndex } from './TokenIndex';
 import { Uploader } from './Uploader';
+import { IUploadReport } from './UploadTelemetry';
 // import { dumpToFile } from './utils';
 
 // const LED_BASIC: vscode.DocumentFilter = { language: 'led_basic', scheme: 'file' };
 const LED_BASIC = 'led_basic'; // allow all documents, from disk and unsaved. extension code does not rely on file existence
+const RECORDINGS_DIR = 'recordings';
 
 let diagnosticCollection: vscode.DiagnosticCollection;
 
 let isUploading = false;
+let lastUploadReport: IUploadReport | null = null;
+
+// duration of the activation in milliseconds, reported by the benchmark
+export let activationTime = 0;
 
 export function activate(ctx: vscode.ExtensionContext) {
+    const activationStart = performance.now();
     const completionProvider = new LEDBasicCompletionItemProvider();
     diagnosticCollection = vscode.languages.createDiagnosticCollection('led_basic');
     const codeValidator = new LEDBasicCodeValidator(diagnosticCollection);
@@ -67,7 +86,7 @@ export function activate(ctx: vscode.ExtensionContext) {
                     let portMatched;
                     if (selectedDevice.meta.needsSbProg) {
                         portMatched = ports.find((port) => {
-                            return port.sysCode === 0x4470;
+                            return port.sysCode === SBPROG_SYSCODE;
                         });
                     } else {
                         portMatched = ports.find((port) => {
@@ -113,21 +132,104 @@ export function activate(ctx: vscode.ExtensionContext) {
         }
     });
 
+    // capture of the terminal output to a rolling log in the extension storage
+    const configureCapture = () => {
+        const config = vscode.workspace.getConfiguration('led_basic');
+        if (config.terminalCapture) {
+            fs.mkdirSync(ctx.globalStorageUri.fsPath, { recursive: true });
+            terminal.setCapture(path.join(ctx.globalStorageUri.fsPath, CAPTURE_FILE), config.terminalCaptureSize * 1024 * 1024);
+        } else {
+            terminal.setCapture(null);
+        }
+    };
+    configureCapture();
+
+    // recording of the serial traffic for a later replay, see blp-serial ReplayBinding
+    const configureRecording = () => {
+        const config = vscode.workspace.getConfiguration('led_basic');
+        if (config.recordSerialTraffic) {
+            const dir = path.join(ctx.globalStorageUri.fsPath, RECORDINGS_DIR);
+            fs.mkdirSync(dir, { recursive: true });
+            SerialPort.setRecordDirectory(dir);
+        } else {
+            SerialPort.setRecordDirectory(null);
+        }
+    };
+    configureRecording();
+
+    vscode.workspace.onDidChangeConfiguration((e) => {
+        if (e.affectsConfiguration('led_basic.terminalCapture') || e.affectsConfiguration('led_basic.terminalCaptureSize')) {
+            configureCapture();
+        }
+        if (e.affectsConfiguration('led_basic.recordSerialTraffic')) {
+            configureRecording();
+        }
+    }, null, ctx.subscriptions);
+
+    // ?ERROR lines of the terminal capture, the selected one is shown with the surrounding output
+    const terminalErrorsCmd = vscode.commands.registerCommand('led_basic.terminalErrors', () => {
+        const file = terminal.getCaptureFile();
+        if (!file || !fs.existsSync(file)) {
+            output.logInfo('No terminal capture available. Enable the setting led_basic.terminalCapture and connect the terminal.');
+            return;
+        }
+        const reader = new CaptureLogReader(file);
+        let errors: ICaptureLine[];
+        try {
+            errors = reader.errors();
+        } catch (error) {
+            output.logError((error as Error).message);
+            return;
+        }
+        if (!errors.length) {
+            output.logInfo('No ?ERROR lines in the terminal capture.');
+            return;
+        }
+        const items = errors.reverse().map((line) => ({ label: line.text, description: line.time, position: line.position }));
+        vscode.window.showQuickPick(items, { placeHolder: 'Device errors in the terminal capture, latest first' })
+            .then((item) => {
+                if (!item) {
+                    return;
+                }
+                const content = reader.around(item.position, 20, 20).map((line) => line.time + ' ' + line.text).join('\n');
+                return vscode.workspace.openTextDocument({ content })
+                    .then((doc) => vscode.window.showTextDocument(doc, vscode.ViewColumn.Beside));
+            });
+    });
+
     // upload code handler
     const statusBarItem = vscode.window.createStatusBarItem(vscode.StatusBarAlignment.Left, 0);
     statusBarItem.command = 'led_basic.upload';
     statusBarItem.text = '$(triangle-right) Upload';
     statusBarItem.show();
 
-    const uploadCmd = vscode.commands.registerCommand('led_basic.upload', () => {
+    const logUploadReport = (uploader: Uploader) => {
+        const report = uploader.telemetry.report();
+        lastUploadReport = report;
+        output.logInfo('Written ' + uploader.writtenPages + ' of ' + uploader.totalPages + ' pages');
+        output.logInfo('Upload took ' + Math.round(report.duration) + ' ms, ' + Object.keys(report.phases)
+            .map((phase) => phase + ' ' + Math.round(report.phases[phase]) + ' ms').join(', '));
+    };
+
+    const upload = (fullFlash: boolean) => {
         const editor = vscode.window.activeTextEditor;
         if (!editor || editor.document.languageId !== 'led_basic') {
             return;
         }
         const doc = editor.document;
 
-        const isValid = codeValidator.validateForUpload(doc);
-        if (!isValid) {
+        // an unchanged program was already validated and compiled for the device
+        const config = vscode.workspace.getConfiguration('led_basic');
+        compileCache.setStoragePath(config.persistentCompileCache ? ctx.globalStorageUri.fsPath : null);
+        const cacheKey = compileCache.key(doc.getText(), deviceSelector.selectedDevice().meta, {
+            version: ctx.extension.packageJSON.version,
+            caseInsensitiveCalls: config.caseInsensitiveCalls,
+            useStrictMode: config.useStrictMode,
+            optimizeCode: config.optimizeCode
+        });
+        const cachedFile = compileCache.get(cacheKey);
+
+        if (!cachedFile && !codeValidator.validateForUpload(doc)) {
             vscode.commands.executeCommand('workbench.action.problems.focus');
             return;
         }
@@ -153,7 +255,7 @@ export function activate(ctx: vscode.ExtensionContext) {
         }
 
         // check if selected target device does match the connected device. In the case of SB-Prog this check is done during upload
-        if (selectedPort.sysCode !== 0x4470 && targetDevice.meta.sysCode !== selectedPort.sysCode) {
+        if (selectedPort.sysCode !== SBPROG_SYSCODE && targetDevice.meta.sysCode !== selectedPort.sysCode) {
             output.logError('Selected device does not match the connected device.');
             output.logInfo('Target device: ' + targetDevice.label);
             output.logInfo('Connected device: ' + selectedPort.deviceName);
@@ -162,8 +264,7 @@ export function activate(ctx: vscode.ExtensionContext) {
 
         isUploading = true;
 
-        // async chain since VSC output channel logs seem to be blocking operations. Output appears only at the end of upload as whole text block.
-        terminal.stop()
+        const compile = () => Promise.resolve()
             .then(() => output.logInfo('Starting code validation...'))
             .then(() => {
                 if (!codeValidator.validateNow(doc)) {
@@ -174,28 +275,73 @@ export function activate(ctx: vscode.ExtensionContext) {
             })
             .then(() => output.logInfo('Starting code tokenizer...'))
             .then(() => {
-                const result = LEDBasicParserFactory.getParser().build(doc.getText());
+                const result = LEDBasicParserFactory.getParser().build(doc.getText(), {
+                    optimize: config.optimizeCode,
+                    removeDeadCode: config.optimizeCode,
+                    verify: true
+                });
                 if (!result.success) {
                     vscode.commands.executeCommand('workbench.action.problems.focus');
                     throw new Error('Invalid code detected');
                 }
-                return result as IParseResult;
+                const parseResult = result as IParseResult;
+                if (parseResult.warnings) {
+                    parseResult.warnings.forEach((warning) => output.logInfo(warning));
+                }
+                if (parseResult.removed && parseResult.removed.length) {
+                    output.logInfo('Removed ' + parseResult.removed.length + ' unused lines from the upload:');
+                    parseResult.removed.forEach((entry) => output.logInfo('  line ' + entry.line + ': ' + entry.reason));
+                }
+                const file = parseResultToArray(parseResult, targetDevice.meta);
+                compileCache.set(cacheKey, file);
+                return file;
+            });
+
+        // async chain since VSC output channel logs seem to be blocking operations. Output appears only at the end of upload as whole text block.
+        // the terminal keeps the port open and is paused until the upload is done
+        const portName = selectedPort.name;
+        portManager.suspend(portName)
+            .then(() => {
+                if (cachedFile) {
+                    output.logInfo('Code unchanged, using the cached code image');
+                    return cachedFile;
+                }
+                return compile();
             })
-            .then((result) => {
+            .then((file) => {
                 output.logInfo('Starting code upload...');
                 if (!selectedPort) {
                     throw new Error('Serial port not selected');
                 }
-                const uploader = new Uploader(selectedPort, targetDevice, {
-                    createSerialPort: (name, options) => {
-                        return new SerialPort(name, options);
-                    }
-                });
-                const file = parseResultToArray(result, targetDevice.meta);
-                return uploader.upload(file);
+                const uploader = new Uploader(selectedPort, targetDevice, portManager);
+                const progressOptions = {
+                    location: vscode.ProgressLocation.Notification,
+                    title: 'Uploading to ' + targetDevice.label
+                };
+                return vscode.window.withProgress(progressOptions, (progress) => {
+                    let reported = 0;
+                    uploader.telemetry.onProgress = (state) => {
+                        const percent = state.totalBytes ? Math.min(100, state.sentBytes * 100 / state.totalBytes) : 100;
+                        progress.report({
+                            increment: percent - reported,
+                            message: (state.bytesPerSecond / 1024).toFixed(1) + ' KB/s, ' + Math.ceil(state.eta / 1000) + ' s left'
+                        });
+                        reported = percent;
+                    };
+                    return uploader.upload(file, fullFlash);
+                })
+                    .then((error) => {
+                        logUploadReport(uploader);
+                        return error;
+                    }, (error) => {
+                        // the timing of a failed upload shows where it got stuck
+                        logUploadReport(uploader);
+                        throw error;
+                    });
             })
             .then((error) => {
                 isUploading = false;
+                portManager.resume(portName);
                 output.logInfo('Upload done');
                 if (error) {
                     const deviceError = decodeErrorMessage(error);
@@ -207,20 +353,113 @@ export function activate(ctx: vscode.ExtensionContext) {
                         diagnosticCollection.set(doc.uri, [diagnostic]);
                     }
                 }
-                const config = vscode.workspace.getConfiguration('led_basic');
                 if (config && config.openTerminalAfterUpload) {
                     terminal.start();
                 }
             })
             .catch((err) => {
                 isUploading = false;
+                portManager.resume(portName);
                 output.logError(err.message);
             });
+    };
+
+    const uploadCmd = vscode.commands.registerCommand('led_basic.upload', () => upload(false));
+    // writes all pages, also the ones which did not change since the last upload
+    const uploadFullCmd = vscode.commands.registerCommand('led_basic.uploadFull', () => upload(true));
+
+    // timing report of the last upload as JSON
+    const uploadReportCmd = vscode.commands.registerCommand('led_basic.uploadReport', () => {
+        if (!lastUploadReport) {
+            output.logInfo('No upload timing available. Upload code to a device first.');
+            return;
+        }
+        const content = JSON.stringify(lastUploadReport, null, 4);
+        vscode.workspace.openTextDocument({ language: 'json', content })
+            .then((doc) => vscode.window.showTextDocument(doc, vscode.ViewColumn.Beside));
+    });
+
+    // estimated execution costs as JSON report
+    const costReportCmd = vscode.commands.registerCommand('led_basic.costReport', () => {
+        const editor = vscode.window.activeTextEditor;
+        if (!editor || editor.document.languageId !== 'led_basic') {
+            return;
+        }
+        const report = costAnalyzer.analyze(editor.document);
+        if (!report) {
+            output.logError('Cost estimation not possible. Check the code for errors.');
+            return;
+        }
+        const content = JSON.stringify({
+            device: deviceSelector.selectedDevice().label,
+            file: editor.document.fileName,
+            ...report
+        }, null, 4);
+        vscode.workspace.openTextDocument({ language: 'json', content })
+            .then((doc) => vscode.window.showTextDocument(doc, vscode.ViewColumn.Beside));
+    });
+
+    // runs the code on the host interpreter and shows the time per line
+    const profileCmd = vscode.commands.registerCommand('led_basic.profile', () => {
+        const editor = vscode.window.activeTextEditor;
+        if (!editor || editor.document.languageId !== 'led_basic') {
+            return;
+        }
+        profiler.profile(editor).then((report) => {
+            if (report === undefined) {
+                output.logInfo('Profiling cancelled');
+                return;
+            }
+            if (!report) {
+                output.logError('Profiling not possible. Check the code for errors.');
+                return;
+            }
+            const result = report.result;
+            output.logInfo('Profiled ' + formatCost(result.time) + ' device time, ' + result.steps + ' statements, '
+                + report.instructions + ' tokens');
+            if (report.frames) {
+                output.logInfo(report.frames + ' frames, ' + report.fps.toFixed(1) + ' of ' + report.frameRate + ' fps, '
+                    + report.lateFrames + ' late, longest frame ' + formatCost(report.maxFrameTime));
+            }
+            report.calls.slice(0, 5).forEach((call) => {
+                output.logInfo(call.name + ': ' + call.calls + ' calls, ' + formatCost(call.time));
+            });
+            if (result.error) {
+                const deviceError = decodeErrorMessage(result.error.message);
+                output.logError('Program stopped: ' + (deviceError ? deviceError.msg : result.error.message));
+            } else if (result.reason === 'steps') {
+                output.logInfo('Program stopped after ' + result.steps + ' statements without delay or frame');
+            }
+        }, (error: Error) => output.logError('Profiling failed: ' + error.message));
+    });
+
+    // call stacks of the last profile for flamegraph tools
+    const profileExportCmd = vscode.commands.registerCommand('led_basic.profileExport', () => {
+        const stacks = profiler.foldedStacks();
+        if (!stacks) {
+            output.logInfo('No profile available. Profile the code first.');
+            return;
+        }
+        vscode.window.showSaveDialog({ filters: { 'Folded stacks': ['folded'] } })
+            .then((uri) => {
+                if (uri) {
+                    fs.writeFileSync(uri.fsPath, stacks);
+                }
+            });
     });
 
+    const formatter = new LEDBasicDocumentFormatter();
     ctx.subscriptions.push(
         vscode.languages.registerDocumentFormattingEditProvider(
-            LED_BASIC, new LEDBasicDocumentFormatter()));
+            LED_BASIC, formatter));
+
+    ctx.subscriptions.push(
+        vscode.languages.registerDocumentRangeFormattingEditProvider(
+            LED_BASIC, formatter));
+
+    ctx.subscriptions.push(
+        vscode.languages.registerOnTypeFormattingEditProvider(
+            LED_BASIC, formatter, '\n'));
 
     ctx.subscriptions.push(
         vscode.languages.registerCompletionItemProvider(
@@ -243,28 +482,51 @@ export function activate(ctx: vscode.ExtensionContext) {
         vscode.languages.registerDocumentSymbolProvider(
             LED_BASIC, dsp));
 
+    const hoverProvider = new LEDBasicHoverProvider();
     ctx.subscriptions.push(
         vscode.languages.registerHoverProvider(
-            LED_BASIC, new LEDBasicHoverProvider(dsp)));
+            LED_BASIC, hoverProvider));
 
     ctx.subscriptions.push(diagnosticCollection);
     ctx.subscriptions.push(codeValidator);
     ctx.subscriptions.push(deviceSelector);
     ctx.subscriptions.push(deviceSelectCmd);
     ctx.subscriptions.push(portSelector);
+    ctx.subscriptions.push(portManager);
     ctx.subscriptions.push(portSelectCmd);
     ctx.subscriptions.push(uploadCmd);
+    ctx.subscriptions.push(uploadFullCmd);
+    ctx.subscriptions.push(costReportCmd);
+    ctx.subscriptions.push(uploadReportCmd);
+    ctx.subscriptions.push(profileCmd);
+    ctx.subscriptions.push(profileExportCmd);
+    ctx.subscriptions.push(profiler);
     ctx.subscriptions.push(terminal);
     ctx.subscriptions.push(terminalCmd);
+    ctx.subscriptions.push(terminalErrorsCmd);
     ctx.subscriptions.push(statusBarItem);
 
     vscode.workspace.onDidChangeTextDocument((e) => {
         codeValidator.validate(e.document);
+        profiler.clear(e.document);
+        tokenIndex.update(e.document, e.contentChanges);
     }, null, ctx.subscriptions);
 
     vscode.workspace.onDidOpenTextDocument((doc) => {
         codeValidator.validate(doc);
     }, null, ctx.subscriptions);
+
+    vscode.workspace.onDidCloseTextDocument((doc) => {
+        costAnalyzer.forget(doc);
+        formatter.forget(doc);
+        hoverProvider.forget(doc);
+        tokenIndex.forget(doc);
+    }, null, ctx.subscriptions);
+
+    // the grammar is compiled after the activation, before the first validation needs it
+    grammarRegistry.preload();
+
+    activationTime = performance.now() - activationStart;
 }
 
 export function deactivate() {}
\ No newline at end of file
@@ -0,0 +1,150 @@
+'use strict';
+
+const MAX_LABEL = 32766;
+const LOOP_VARS = ['i', 'j', 'k'];
+const VARS = 'abcdefghlmnopqrstuvwxyz'.split('');
+
+const LED_CALLS = [
+    'led.lrgb(%v, %n, %n, %n)',
+    'led.lhsv(%v, %n, 255, %n)',
+    'led.irgb(2, %n, %n, %n)',
+    'led.iled(2, %v)',
+    'led.irange(2, 0, %v)',
+    'led.rainbow(%n, 255, 128, 0, 59, 6)',
+    'led.shift(0, %v, 1)',
+    'led.show()'
+];
+const IO_CALLS = [
+    '%v = io.getkey()',
+    '%v = io.getrtc(%d)',
+    '%v = io.getldr()',
+    '%v = io.eeread(%d)',
+    'io.eewrite(%d, %v)',
+    'io.beep(%d)'
+];
+const MATRIX_CALLS = [
+    'matrix.setxy(%d, %d, 2)',
+    'matrix.line(0, 0, %d, %d, 2)',
+    'matrix.rect(0, 0, %d, %d, 2, 1)',
+    'matrix.char(0, 0, %v, 2)'
+];
+
+/**
+ * Small deterministic random generator (mulberry32), the same seed generates the same program
+ */
+function random(seed: number) {
+    let state = seed >>> 0;
+    return () => {
+        state = (state + 0x6D2B79F5) >>> 0;
+        let t = state;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+/**
+ * Generates a valid LED Basic program for benchmarks. The program uses strict mode syntax (numeric labels,
+ * single letter variables) and has a mix of data lines, subroutines with nested loops, conditions,
+ * jumps and LED, IO and MATRIX calls.
+ * @param lineCount - approximate number of lines to generate
+ * @param seed - seed of the random generator
+ */
+export function generateProgram(lineCount: number, seed = 1): string {
+    const rnd = random(seed);
+    const int = (max: number) => Math.floor(rnd() * max);
+    const pick = <T>(list: T[]) => list[int(list.length)];
+    const variable = () => pick(VARS);
+    const fill = (template: string) => template
+        .replace(/%v/g, variable)
+        .replace(/%n/g, () => String(int(256)))
+        .replace(/%d/g, () => String(int(16)));
+
+    const lines: string[] = [];
+    const dataLabels: number[] = [];
+    const subroutines: number[] = [];
+    let label = 10;
+
+    lines.push('\' generated benchmark program, ' + lineCount + ' lines, seed ' + seed);
+    lines.push('### L64 CGRB M100 F25');
+    lines.push('');
+
+    // data tables
+    const dataTables = Math.max(1, Math.floor(lineCount / 500));
+    for (let t = 0; t < dataTables && label < 100; t++) {
+        lines.push('\' table ' + t);
+        dataLabels.push(label);
+        const values: string[] = [];
+        for (let v = 0; v < 12; v++) {
+            values.push(String(int(1000)));
+        }
+        lines.push(label + ': data ' + values.join(', '));
+        lines.push('data ' + values.reverse().join(', '));
+        label += 1;
+    }
+    label = 100;
+    const main = label;
+    lines.push(main + ':');
+    lines.push('gosub ' + (main + 1));
+    lines.push('goto ' + main);
+
+    function statement(indent: string): string {
+        const kind = int(10);
+        if (kind < 3) {
+            return indent + fill(pick(LED_CALLS));
+        } else if (kind < 4) {
+            return indent + fill(pick(IO_CALLS));
+        } else if (kind < 5) {
+            return indent + fill(pick(MATRIX_CALLS));
+        } else if (kind < 6) {
+            return indent + variable() + ' = read ' + pick(dataLabels) + ', ' + variable() + ' % 12';
+        } else if (kind < 7) {
+            return indent + 'if ' + variable() + ' > ' + int(100) + ' then ' + variable() + ' = 0 else ' + variable() + ' = ' + variable() + ' + 1';
+        } else if (kind < 8 && subroutines.length) {
+            return indent + 'gosub ' + pick(subroutines);
+        } else if (kind < 9) {
+            return indent + 'print "value: "; ' + variable();
+        }
+        return indent + variable() + ' = (' + variable() + ' * ' + (int(15) + 1) + ' + ' + int(100) + ') / 2';
+    }
+
+    // subroutines with nested loops until the program reaches the requested size
+    while (lines.length < lineCount && label < MAX_LABEL) {
+        label += 1;
+        lines.push('');
+        lines.push('\' subroutine ' + label);
+        lines.push(label + ':');
+
+        const depth = int(LOOP_VARS.length + 1);
+        let indent = '    ';
+        for (let d = 0; d < depth; d++) {
+            lines.push(indent + 'for ' + LOOP_VARS[d] + ' = 0 to ' + (int(30) + 1));
+            indent += '    ';
+            const count = int(4) + 1;
+            for (let s = 0; s < count; s++) {
+                lines.push(statement(indent));
+            }
+        }
+        for (let d = depth - 1; d >= 0; d--) {
+            indent = indent.substring(4);
+            lines.push(indent + 'next ' + LOOP_VARS[d] + ' \' end of loop ' + LOOP_VARS[d]);
+        }
+        const count = int(6) + 2;
+        for (let s = 0; s < count; s++) {
+            lines.push(statement('    '));
+        }
+        if (int(4) === 0) {
+            lines.push('    delay ' + (int(50) + 1));
+        }
+        lines.push('    return');
+        subroutines.push(label);
+    }
+
+    // the main loop calls the first subroutine which must exist
+    if (!subroutines.length) {
+        lines.push((main + 1) + ':');
+        lines.push('    return');
+    }
+    lines.push('end');
+    return lines.join('\n') + '\n';
+}
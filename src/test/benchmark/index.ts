@@ -0,0 +1,212 @@
+import * as fs from 'fs';
+import * as ohm from 'ohm-js';
+import * as path from 'path';
+import { performance } from 'perf_hooks';
+import * as v8 from 'v8';
+import * as vm from 'vm';
+import * as vscode from 'vscode';
+
+import { activationTime } from '../../extension';
+import { LEDBasicCodeValidator } from '../../LEDBasicCodeValidator';
+import { LEDBasicCompletionItemProvider } from '../../LEDBasicCompletionItemProvider';
+import { LEDBasicDefinitionProvider } from '../../LEDBasicDefinitionProvider';
+import { LEDBasicDocumentFormatter } from '../../LEDBasicDocumentFormatter';
+import { LEDBasicDocumentSymbolProvider } from '../../LEDBasicDocumentSymbolProvider';
+import { LEDBasicHoverProvider } from '../../LEDBasicHoverProvider';
+import { LEDBasicParserFactory } from '../../LEDBasicParserFactory';
+import { LEDBasicReferenceProvider } from '../../LEDBasicReferenceProvider';
+import { LEDBasicSignatureHelpProvider } from '../../LEDBasicSignatureHelpProvider';
+import { SerialPort } from '../../SerialPort';
+import { tokenIndex } from '../../TokenIndex';
+import { generateProgram } from './corpus';
+
+const recording = require('../../../blp-serial/lib/bindings/recording');
+
+const DEFAULT_SIZES = [1000, 10000, 50000, 200000];
+const EXTENSION_ID = 'Gamadril.led-basic';
+
+// the extension host runs without --expose-gc, enable the gc function at runtime
+v8.setFlagsFromString('--expose-gc');
+const collectGarbage: () => void = vm.runInNewContext('gc');
+
+interface IMeasurement {
+    lines: number;
+    operation: string;
+    // best time of all runs in milliseconds
+    time: number;
+    linesPerSecond: number;
+    // highest heap usage right after a run in bytes, the garbage of earlier runs is collected before
+    // each run. Garbage collected during a run is not included, this is not the peak heap usage.
+    heapAfterRun: number;
+}
+
+/**
+ * Runs the operation several times and returns the best time and the highest heap usage after a run
+ */
+async function measure(lines: number, operation: string, fn: () => any): Promise<IMeasurement> {
+    const runs = lines > 10000 ? 1 : 5;
+    let time = Number.MAX_VALUE;
+    let heapAfterRun = 0;
+    for (let i = 0; i < runs; i++) {
+        collectGarbage();
+        const start = performance.now();
+        await fn();
+        time = Math.min(time, performance.now() - start);
+        heapAfterRun = Math.max(heapAfterRun, process.memoryUsage().heapUsed);
+    }
+    return {
+        lines,
+        operation,
+        time,
+        linesPerSecond: Math.round(lines * 1000 / time),
+        heapAfterRun
+    };
+}
+
+/**
+ * Returns the position of the first occurrence of the text in the document, shifted by offset characters
+ */
+function positionOf(doc: vscode.TextDocument, text: string, offset = 0): vscode.Position {
+    const index = doc.getText().indexOf(text);
+    return doc.positionAt(Math.max(0, index) + offset);
+}
+
+/**
+ * Replays each session of a serial port recording without delays through SerialPort and
+ * prints the throughput of the received data
+ * @param file - recording of the blp-serial RecordingBinding
+ */
+async function replay(file: string): Promise<void> {
+    const events: Array<{ type: number, data: Buffer }> = recording.readRecording(file);
+    const sessions = events.filter((event) => event.type === recording.EVENTS.OPEN);
+    if (!sessions.length) {
+        return;
+    }
+    // the same port object replays the next session on each open
+    const port = new SerialPort(JSON.parse(sessions[0].data.toString()).path, {
+        baudRate: 115200,
+        replay: file,
+        replaySpeed: 0
+    });
+
+    console.log('session'.padStart(8) + 'rx bytes'.padStart(12) + 'time [ms]'.padStart(12) + 'KB/s'.padStart(12));
+    let index = events.indexOf(sessions[0]);
+    for (let session = 0; session < sessions.length; session++) {
+        const next = events.indexOf(sessions[session + 1]);
+        const sessionEvents = events.slice(index + 1, next === -1 ? events.length : next);
+        index = next;
+        const expected = sessionEvents
+            .filter((event) => event.type === recording.EVENTS.RX)
+            .reduce((sum, event) => sum + event.data.length, 0);
+
+        let received = 0;
+        const finished = new Promise<void>((resolve) => {
+            port.setReadListener((data) => {
+                received += data.length;
+                if (received >= expected) {
+                    resolve();
+                }
+            });
+        });
+        const start = performance.now();
+        await port.open();
+        // the replay serves the received data only after the data written before it in the recording
+        for (const event of sessionEvents) {
+            if (event.type === recording.EVENTS.TX) {
+                await port.write(new Uint8Array(event.data));
+            }
+        }
+        if (expected) {
+            await finished;
+        }
+        const time = performance.now() - start;
+        await port.close();
+        console.log(String(session).padStart(8) + String(received).padStart(12) + time.toFixed(1).padStart(12)
+            + (received / 1.024 / time).toFixed(1).padStart(12));
+    }
+}
+
+/**
+ * Benchmark of the parser, code builder, formatter and language providers on generated programs.
+ * Program sizes can be set as comma separated list in LED_BASIC_BENCH_SIZES, results are written
+ * as JSON to the file in LED_BASIC_BENCH_REPORT. A serial port recording in LED_BASIC_BENCH_REPLAY
+ * is replayed after the language benchmarks.
+ */
+export async function run(): Promise<void> {
+    const sizes = process.env.LED_BASIC_BENCH_SIZES ?
+        process.env.LED_BASIC_BENCH_SIZES.split(',').map((size) => parseInt(size, 10)) : DEFAULT_SIZES;
+    const results: IMeasurement[] = [];
+    const token = new vscode.CancellationTokenSource().token;
+    const diagnostics = vscode.languages.createDiagnosticCollection('led_basic_benchmark');
+
+    const parser = LEDBasicParserFactory.getParser();
+    const validator = new LEDBasicCodeValidator(diagnostics);
+    const formatter = new LEDBasicDocumentFormatter();
+    const symbolProvider = new LEDBasicDocumentSymbolProvider();
+    const hoverProvider = new LEDBasicHoverProvider();
+    const completionProvider = new LEDBasicCompletionItemProvider();
+    const definitionProvider = new LEDBasicDefinitionProvider();
+    const referenceProvider = new LEDBasicReferenceProvider();
+    const signatureProvider = new LEDBasicSignatureHelpProvider();
+
+    // the activation does not compile the grammar, before the shared grammar it took the time of both
+    const extension = vscode.extensions.getExtension(EXTENSION_ID);
+    if (extension) {
+        await extension.activate();
+        results.push({ lines: 0, operation: 'activate', time: activationTime, linesPerSecond: 0, heapAfterRun: process.memoryUsage().heapUsed });
+    }
+    const grammarSource = fs.readFileSync(path.join(__dirname, '..', '..', '..', 'res', 'grammar_ex.ohm')).toString();
+    results.push(await measure(0, 'grammar compile', () => ohm.grammar(grammarSource)));
+
+    for (const size of sizes) {
+        const text = generateProgram(size);
+        const lines = text.split('\n').length;
+        const doc = await vscode.workspace.openTextDocument({ language: 'led_basic', content: text });
+        const gosub = positionOf(doc, 'gosub ', 'gosub '.length);
+        const call = positionOf(doc, 'led.', 'led.'.length);
+        const args = positionOf(doc, 'led.lrgb(', 'led.lrgb('.length);
+        const completionContext = { triggerKind: vscode.CompletionTriggerKind.TriggerCharacter, triggerCharacter: '.' };
+
+        results.push(await measure(lines, 'match', () => parser.match(text)));
+        results.push(await measure(lines, 'build', () => parser.build(text)));
+        results.push(await measure(lines, 'build optimized', () => parser.build(text, { optimize: true, removeDeadCode: true, verify: true })));
+        results.push(await measure(lines, 'validate', () => validator.validateNow(doc)));
+        results.push(await measure(lines, 'format', () => {
+            // drop the cached parse, otherwise only the first run formats the document
+            formatter.forget(doc);
+            return formatter.provideDocumentFormattingEdits(doc, { tabSize: 4, insertSpaces: true }, token);
+        }));
+        results.push(await measure(lines, 'symbols', () => symbolProvider.provideDocumentSymbols(doc, token)));
+        results.push(await measure(lines, 'hover', () => {
+            // drop the cached labels, otherwise only the first run collects them
+            hoverProvider.forget(doc);
+            return hoverProvider.provideHover(doc, gosub, token);
+        }));
+        results.push(await measure(lines, 'hover cached', () => hoverProvider.provideHover(doc, gosub, token)));
+        results.push(await measure(lines, 'completion', () => completionProvider.provideCompletionItems(doc, call, token, completionContext)));
+        results.push(await measure(lines, 'definition', () => definitionProvider.provideDefinition(doc, gosub, token)));
+        results.push(await measure(lines, 'references', () => {
+            // drop the token index, otherwise only the first run indexes the document
+            tokenIndex.forget(doc);
+            return referenceProvider.provideReferences(doc, gosub, { includeDeclaration: true }, token);
+        }));
+        results.push(await measure(lines, 'references cached', () => referenceProvider.provideReferences(doc, gosub, { includeDeclaration: true }, token)));
+        results.push(await measure(lines, 'signature', () => signatureProvider.provideSignatureHelp(doc, args, token)));
+    }
+
+    console.log('lines'.padStart(8) + 'operation'.padStart(18) + 'time [ms]'.padStart(12) + 'lines/s'.padStart(12) + 'heap after [MB]'.padStart(16));
+    results.forEach((result) => {
+        console.log(String(result.lines).padStart(8) + result.operation.padStart(18) + result.time.toFixed(1).padStart(12)
+            + String(result.linesPerSecond).padStart(12) + (result.heapAfterRun / 1048576).toFixed(1).padStart(16));
+    });
+
+    if (process.env.LED_BASIC_BENCH_REPORT) {
+        fs.writeFileSync(process.env.LED_BASIC_BENCH_REPORT, JSON.stringify(results, null, 4));
+    }
+    diagnostics.dispose();
+    validator.dispose();
+
+    if (process.env.LED_BASIC_BENCH_REPLAY) {
+        await replay(process.env.LED_BASIC_BENCH_REPLAY);
+    }
+}
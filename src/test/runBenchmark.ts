@@ -0,0 +1,30 @@
+import * as path from 'path';
+
+import { runTests } from '@vscode/test-electron';
+
+async function main() {
+    try {
+        // The folder containing the Extension Manifest package.json
+        const extensionDevelopmentPath = path.resolve(__dirname, '../../');
+
+        // The benchmark runner, executed inside of the extension host like the tests
+        const extensionTestsPath = path.resolve(__dirname, './benchmark/index');
+
+        // pass sizes, report file and serial recording (LED_BASIC_BENCH_SIZES, LED_BASIC_BENCH_REPORT,
+        // LED_BASIC_BENCH_REPLAY) to the extension host
+        await runTests({
+            extensionDevelopmentPath,
+            extensionTestsPath,
+            extensionTestsEnv: {
+                LED_BASIC_BENCH_SIZES: process.env.LED_BASIC_BENCH_SIZES,
+                LED_BASIC_BENCH_REPORT: process.env.LED_BASIC_BENCH_REPORT,
+                LED_BASIC_BENCH_REPLAY: process.env.LED_BASIC_BENCH_REPLAY
+            }
+        });
+    } catch (err) {
+        console.error('Failed to run benchmark');
+        process.exit(1);
+    }
+}
+
+main();
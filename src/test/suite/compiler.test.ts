@@ -0,0 +1,267 @@
+import * as assert from 'assert';
+import * as fs from 'fs';
+import * as path from 'path';
+
+import { decodeEntries, decodeTokens, ENTRY, ICodeEntry, readOperand, TOKEN } from '../../CodeImage';
+import { verifyOptimizedImage } from '../../CodeVerifier';
+import { ICompileOptions, IMatchResult, IParseResult } from '../../Common';
+import { LEDBasicParserFactory } from '../../LEDBasicParserFactory';
+
+const TESTS_DIR = path.resolve(__dirname, '../../../tests');
+const GOLDEN_DIR = path.join(TESTS_DIR, 'golden');
+
+// compile options of the golden images, the file names end with the variant
+const VARIANTS: { [variant: string]: ICompileOptions } = {
+    plain: {},
+    optimized: { optimize: true },
+    deadcode: { removeDeadCode: true }
+};
+
+function build(text: string, options: ICompileOptions = {}): IParseResult {
+    const result = LEDBasicParserFactory.getParser().build(text, options);
+    assert.ok(result.success, JSON.stringify((result as IMatchResult).errors));
+    return result as IParseResult;
+}
+
+function statement(code: Uint8Array, line: number): string {
+    const entry = lineOf(code, line);
+    return hex(code, entry.start, entry.end);
+}
+
+function source(...lines: string[]): string {
+    return lines.join('\n') + '\n';
+}
+
+function hex(code: Uint8Array, start: number, end: number): string {
+    return Array.from(code.subarray(start, end)).map((b) => ('0' + b.toString(16)).slice(-2)).join(' ');
+}
+
+/**
+ * Returns a readable listing of a code image, one entry per line
+ */
+function listing(code: Uint8Array): string {
+    return decodeEntries(code).map((entry) => {
+        const head = ('000' + entry.offset.toString(16)).slice(-4) + ' ';
+        switch (entry.kind) {
+            case ENTRY.LABEL:
+                return head + 'label ' + entry.number;
+            case ENTRY.DATA:
+                return head + 'data  ' + entry.number + ': ' + hex(code, entry.start, entry.end);
+            default:
+                return head + 'line  ' + entry.number + ': ' + hex(code, entry.start, entry.end);
+        }
+    }).join('\n') + '\n';
+}
+
+/**
+ * Returns the goto, gosub and read operands of all statement lines as 'goto 10', a target without a
+ * label at that address is written as offset
+ */
+function references(code: Uint8Array): string[] {
+    const entries = decodeEntries(code);
+    const labelAt = (address: number) => {
+        const label = entries.find((entry) => entry.kind === ENTRY.LABEL && entry.offset === address);
+        return label ? label.number : '@' + address;
+    };
+    const result: string[] = [];
+    entries.filter((entry) => entry.kind === ENTRY.LINE).forEach((entry) => {
+        decodeTokens(code, entry).forEach((token) => {
+            const operand = readOperand(code, token.offset);
+            if (token.token === TOKEN.GOTO) {
+                result.push('goto ' + labelAt(operand));
+            } else if (token.token === TOKEN.GOSUB) {
+                result.push('gosub ' + labelAt(operand));
+            } else if (token.token === TOKEN.READ) {
+                // read operands address the first data value behind the label and the line header
+                result.push('read ' + labelAt(operand - 5));
+            }
+        });
+    });
+    return result;
+}
+
+function lineOf(code: Uint8Array, line: number): ICodeEntry {
+    const entry = decodeEntries(code).find((e) => e.kind !== ENTRY.LABEL && e.number === line);
+    assert.ok(entry, 'line ' + line + ' is missing');
+    return entry!;
+}
+
+/**
+ * Compares the listing with the recorded golden image. Missing golden images are recorded, except on
+ * the build server.
+ */
+function checkGolden(context: Mocha.Context, name: string, actual: string) {
+    const file = path.join(GOLDEN_DIR, name);
+    if (!fs.existsSync(file)) {
+        if (process.env.CI) {
+            assert.fail('Golden image ' + name + ' is missing');
+        }
+        fs.mkdirSync(GOLDEN_DIR, { recursive: true });
+        fs.writeFileSync(file, actual);
+        context.skip();
+    }
+    assert.strictEqual(actual, fs.readFileSync(file).toString(), 'code image differs from ' + name);
+}
+
+suite('Compiler', () => {
+
+    ['demo.bas', 'test.bas'].forEach((program) => {
+        Object.keys(VARIANTS).forEach((variant) => {
+            test('Golden image of ' + program + ' (' + variant + ')', function () {
+                const text = fs.readFileSync(path.join(TESTS_DIR, program)).toString();
+                checkGolden(this, program + '.' + variant + '.txt', listing(build(text, VARIANTS[variant]).code));
+            });
+        });
+    });
+
+    test('Forward and backward label references', () => {
+        const result = build(source(
+            '10:',
+            'a = 1',
+            'goto 20',
+            '30:',
+            'b = read 40, 1',
+            'return',
+            '20:',
+            'gosub 30',
+            'if a = 1 then goto 10',
+            'end',
+            '40: data 1, 2, 3'
+        ));
+        assert.deepStrictEqual(references(result.code), ['goto 20', 'read 40', 'gosub 30', 'goto 10']);
+    });
+
+    test('Token values in operand position', () => {
+        // 0x95 goto, 0x96 gosub and 0xAF read as values and label numbers
+        const result = build(source(
+            'a = 149',
+            'b = 0x96AF',
+            'c = read 175, 150',
+            'goto 149',
+            '150:',
+            'return',
+            '149:',
+            'gosub 150',
+            'goto 149',
+            '175: data 149, 150, 175'
+        ));
+        assert.deepStrictEqual(references(result.code), ['read 175', 'goto 149', 'gosub 150', 'goto 149']);
+
+        const a = lineOf(result.code, 1);
+        assert.strictEqual(hex(result.code, a.start, a.end), '8b 00 88 95 00');
+        const b = lineOf(result.code, 2);
+        assert.strictEqual(hex(result.code, b.start, b.end), '8b 01 88 af 96');
+        const data = lineOf(result.code, 10);
+        assert.strictEqual(hex(result.code, data.start, data.end), '95 00 96 00 af 00');
+    });
+
+    test('Undefined and duplicate labels', () => {
+        const result = LEDBasicParserFactory.getParser().build(source(
+            '10:',
+            'goto 20',
+            '10:',
+            'end'
+        )) as IMatchResult;
+        assert.strictEqual(result.success, false);
+        assert.deepStrictEqual(result.errors!.map((error) => [error.range.start.line, error.message]), [
+            [2, 'Label 10 is already defined'],
+            [1, 'Label 20 is not defined']
+        ]);
+    });
+
+    test('Constant folding at the 16 bit limits', () => {
+        const result = build(source(
+            'a = 2 * 16 + 1',
+            'b = 16383 * 2',
+            'c = 32767 + 1',
+            'd = 0 - 32767 - 1',
+            'e = 0 - 32767 - 2',
+            'f = 1 / 0',
+            'g = 7 % 0',
+            'h = a * 1 + 0'
+        ), { optimize: true });
+        assert.strictEqual(statement(result.code, 1), '8b 00 88 21 00');
+        assert.strictEqual(statement(result.code, 2), '8b 01 88 fe 7f');
+        // the overflow and the division by zero are left for the device
+        assert.strictEqual(statement(result.code, 3), '8b 02 88 ff 7f 9d 88 01 00');
+        assert.strictEqual(statement(result.code, 4), '8b 03 88 00 80');
+        assert.strictEqual(statement(result.code, 5), '8b 04 88 01 80 9e 88 02 00');
+        assert.strictEqual(statement(result.code, 6), '8b 05 88 01 00 a2 88 00 00');
+        assert.strictEqual(statement(result.code, 7), '8b 06 88 07 00 a3 88 00 00');
+        assert.strictEqual(statement(result.code, 8), '8b 07 8a 00');
+
+        const plain = build(source('a = 2 * 16 + 1'));
+        assert.strictEqual(statement(plain.code, 1), '8b 00 88 02 00 a1 88 10 00 9d 88 01 00');
+    });
+
+    test('Goto chains', () => {
+        const text = source(
+            'goto 10',
+            '10:',
+            'goto 20',
+            '20:',
+            'goto 30',
+            '30:',
+            'gosub 40',
+            'end',
+            '40:',
+            'goto 50',
+            '50:',
+            'goto 40'
+        );
+        assert.deepStrictEqual(references(build(text).code),
+            ['goto 10', 'goto 20', 'goto 30', 'gosub 40', 'goto 50', 'goto 40']);
+        // the endless loop between 40 and 50 keeps its targets
+        assert.deepStrictEqual(references(build(text, { optimize: true }).code),
+            ['goto 30', 'goto 30', 'goto 30', 'gosub 40', 'goto 50', 'goto 40']);
+    });
+
+    test('Verification of the optimized images', () => {
+        ['demo.bas', 'test.bas'].forEach((program) => {
+            const text = fs.readFileSync(path.join(TESTS_DIR, program)).toString();
+            assert.strictEqual(verifyOptimizedImage(build(text), build(text, { optimize: true })), null, program);
+            assert.strictEqual(build(text, { optimize: true, verify: true }).warnings, undefined, program);
+        });
+
+        const text = source('a = 2 * 16 + 1', 'print a');
+        const broken = build(text, { optimize: true });
+        broken.code[lineOf(broken.code, 1).start + 3] = 34;
+        assert.strictEqual(verifyOptimizedImage(build(text), broken), 'The optimized code differs without inputs at print 1');
+    });
+
+    test('Unreachable code, unused labels and unread data', () => {
+        const text = source(
+            'a = 1',
+            '15:',
+            'data 7, 8',
+            'gosub 30',
+            'goto 20',
+            'b = 2',
+            '10:',
+            'c = 3',
+            '20:',
+            'd = read 40, 0',
+            'end',
+            '30:',
+            'return',
+            '40: data 1, 2',
+            '50: data 3, 4'
+        );
+        const result = build(text, { removeDeadCode: true });
+        assert.deepStrictEqual(result.removed, [
+            { line: 2, reason: 'unused label' },
+            { line: 3, reason: 'unused data' },
+            { line: 6, reason: 'unreachable code' },
+            { line: 7, reason: 'unreachable code' },
+            { line: 8, reason: 'unreachable code' },
+            { line: 15, reason: 'unreachable code' }
+        ]);
+        const labels = decodeEntries(result.code).filter((entry) => entry.kind === ENTRY.LABEL).map((entry) => entry.number);
+        assert.deepStrictEqual(labels, [20, 30, 40]);
+        // the addresses are recomputed for the remaining code
+        assert.deepStrictEqual(references(result.code), ['gosub 30', 'goto 20', 'read 40']);
+        assert.strictEqual(verifyOptimizedImage(build(text), result), null);
+
+        assert.strictEqual(build(text).removed, undefined);
+    });
+});
@@ -0,0 +1,153 @@
+import * as assert from 'assert';
+import * as fs from 'fs';
+import * as path from 'path';
+
+import { CodeInterpreter, IRunLimits, IRunResult, LedFramebuffer } from '../../CodeInterpreter';
+import { decodeErrorMessage, IParseResult, parseResultToArray } from '../../Common';
+import { DEFAULT_DEVICE } from '../../DeviceList';
+import { LEDBasicParserFactory } from '../../LEDBasicParserFactory';
+
+// tslint:disable: no-bitwise
+
+const TESTS_DIR = path.resolve(__dirname, '../../../tests');
+
+// tokens of the hand written code images
+const END = 0x83;
+const VALUE = 0x88;
+const VAR = 0x8A;
+const ASSIGN = 0x8B;
+const PRINT = 0x8C;
+const GOTO = 0x95;
+const DELAY = 0x98;
+const COMMA = 0x99;
+const DIV = 0xA2;
+const LED = 0xAC;
+const LED_LRGB = 0x44;
+const LED_SHOW = 0x08;
+
+interface IHeadlessRun {
+    result: IRunResult;
+    prints: string[];
+    // colours of all LEDs at each frame
+    frames: number[][][];
+    vm: CodeInterpreter;
+}
+
+function value(n: number): number[] {
+    return [VALUE, n & 0xFF, (n >> 8) & 0xFF];
+}
+
+/**
+ * Returns a code image of statement lines, each line is the line number and the tokens
+ */
+function assemble(lines: Array<[number, number[]]>, ledcnt: number): Uint8Array {
+    const code: number[] = [];
+    lines.forEach(([line, tokens]) => code.push(line & 0xFF, line >> 8, tokens.length, ...tokens));
+    code.push(0xFF, 0xFF);
+    const result: IParseResult = { success: true, code: new Uint8Array(code), config: { ledcnt } };
+    return parseResultToArray(result, DEFAULT_DEVICE.meta);
+}
+
+function compileFile(name: string): Uint8Array {
+    const text = fs.readFileSync(path.join(TESTS_DIR, name)).toString();
+    const result = LEDBasicParserFactory.getParser().build(text, {});
+    assert.ok(result.success, name + ' does not compile');
+    return parseResultToArray(result as IParseResult, DEFAULT_DEVICE.meta);
+}
+
+function colours(framebuffer: LedFramebuffer): number[][] {
+    const leds: number[][] = [];
+    for (let led = 0; led < framebuffer.ledcnt; led++) {
+        leds.push(framebuffer.rgb(led));
+    }
+    return leds;
+}
+
+function runImage(image: Uint8Array, limits: IRunLimits): IHeadlessRun {
+    const prints: string[] = [];
+    const frames: number[][][] = [];
+    const vm = new CodeInterpreter(image, {
+        costs: DEFAULT_DEVICE.costs,
+        seed: 1,
+        onPrint: (text) => prints.push(text),
+        onFrame: (framebuffer) => frames.push(colours(framebuffer))
+    });
+    const result = vm.run(limits);
+    return { result, prints, frames, vm };
+}
+
+function litLeds(frame: number[][]): number[] {
+    return frame.map((rgb, led) => rgb.some((c) => c !== 0) ? led : -1).filter((led) => led >= 0);
+}
+
+suite('Interpreter', () => {
+
+    test('Frames of LED calls', () => {
+        const run = runImage(assemble([
+            [10, [LED, LED_LRGB, ...value(0), COMMA, ...value(255), COMMA, ...value(1), COMMA, ...value(2)]],
+            [20, [LED, LED_LRGB, ...value(3), COMMA, ...value(0), COMMA, ...value(64), COMMA, ...value(0)]],
+            [30, [LED, LED_SHOW]],
+            [40, [DELAY, ...value(100)]],
+            [50, [LED, LED_LRGB, ...value(0), COMMA, ...value(0), COMMA, ...value(0), COMMA, ...value(0)]],
+            [60, [LED, LED_SHOW]],
+            [70, [END]]
+        ], 4), { maxFrames: 10 });
+
+        assert.strictEqual(run.result.reason, 'end');
+        assert.strictEqual(run.result.error, undefined);
+        assert.strictEqual(run.frames.length, 2);
+        assert.deepStrictEqual(run.frames[0], [[255, 1, 2], [0, 0, 0], [0, 0, 0], [0, 64, 0]]);
+        assert.deepStrictEqual(run.frames[1], [[0, 0, 0], [0, 0, 0], [0, 0, 0], [0, 64, 0]]);
+    });
+
+    test('Runtime error of a division by zero', () => {
+        const run = runImage(assemble([
+            [10, [ASSIGN, 1, ...value(0)]],
+            [20, [PRINT, ...value(7)]],
+            [30, [PRINT, ...value(1), DIV, VAR, 1]],
+            [40, [PRINT, ...value(8)]],
+            [50, [END]]
+        ], 4), { maxSteps: 100 });
+
+        assert.strictEqual(run.result.reason, 'error');
+        assert.ok(run.result.error);
+        assert.strictEqual(run.result.error!.code, 15);
+        assert.strictEqual(run.result.error!.line, 30);
+        assert.deepStrictEqual(run.prints, ['7', '?ERROR 15 IN LINE 30']);
+        assert.strictEqual(decodeErrorMessage(run.prints[1])!.code, 15);
+    });
+
+    test('Step limit of an endless loop', () => {
+        const run = runImage(assemble([
+            [10, [ASSIGN, 1, ...value(1)]],
+            [20, [GOTO, 0x00, 0x00]]
+        ], 4), { maxSteps: 1000 });
+
+        assert.strictEqual(run.result.reason, 'steps');
+        assert.strictEqual(run.result.steps, 1000);
+        assert.strictEqual(run.vm.variables[1], 1);
+    });
+
+    test('tests/demo.bas', () => {
+        const run = runImage(compileFile('demo.bas'), { maxFrames: 50, maxSteps: 1000000 });
+
+        assert.notStrictEqual(run.result.reason, 'error', run.result.error && run.result.error.message);
+        assert.ok(run.frames.length > 0, 'no frame displayed');
+        // the startup shows the digits 0, 1, 4 and 5 in white
+        assert.deepStrictEqual(litLeds(run.frames[0]), [5, 10, 27, 32]);
+        litLeds(run.frames[0]).forEach((led) => assert.deepStrictEqual(run.frames[0][led], [128, 128, 128]));
+        assert.deepStrictEqual(run.prints.slice(0, 2), ['CRONIOS1 NIXIE', '  by Vanessa']);
+        assert.ok(run.prints.every((text) => !decodeErrorMessage(text)), 'runtime error printed');
+        // the EEPROM initialisation of the first start
+        assert.strictEqual(run.vm.eeprom.get(4), 12);
+        assert.strictEqual(run.vm.eeprom.get(13), 1);
+    });
+
+    test('tests/test.bas', () => {
+        const run = runImage(compileFile('test.bas'), { maxFrames: 50, maxSteps: 1000000 });
+
+        assert.notStrictEqual(run.result.reason, 'error', run.result.error && run.result.error.message);
+        assert.ok(run.frames.length > 0, 'no frame displayed');
+        assert.ok(run.prints.every((text) => !decodeErrorMessage(text)), 'runtime error printed');
+    });
+});
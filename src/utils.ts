@@ -3,25 +3,23 @@ import { extensions } from 'vscode';
 import { workspace } from 'vscode';
 import { API, IEntry } from './LEDBasicAPI';
 
+// signatures of all API entries by name, the first library defining a name wins
+const SIGNATURES = new Map<string, IEntry>();
+Object.keys(API).forEach((lib) => {
+    Object.keys(API[lib]).forEach((func) => {
+        if (!SIGNATURES.has(func)) {
+            SIGNATURES.set(func, API[lib][func]);
+        }
+    });
+});
+
 /**
  * Finds the function signature information
  *
  * @param funcName - Function name to serach for
  */
 export function findLibSignature(funcName: string): IEntry | null {
-    const libNames = Object.keys(API);
-    let result = null;
-
-    libNames.some((lib) => {
-        const func = Object.keys(API[lib]).find((apiFunc) => apiFunc === funcName);
-        if (func) {
-            result = API[lib][func];
-            return true;
-        }
-        return false;
-    });
-
-    return result;
+    return SIGNATURES.get(funcName) || null;
 }
 
 /**